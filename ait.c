@@ -0,0 +1,201 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "ait.h"
+#include "dvbstring.h"
+#include "si.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CRC_SIZE 4
+#define AIT_HEADER_SIZE 10
+#define AIT_APPLICATION_HEADER_SIZE 9
+
+#define APPLICATION_NAME_DR_TAG 0x01
+#define TRANSPORT_PROTOCOL_DR_TAG 0x02
+#define SIMPLE_APPLICATION_LOCATION_DR_TAG 0x15
+
+#define HTTP_PROTOCOL_ID 0x0003
+
+void ait_batch_init(ait_batch *batch) {
+  vec_ait_section_init(&batch->sections);
+  vec_ait_application_init(&batch->applications);
+  batch->mem_used = 0;
+}
+
+void ait_batch_clear(ait_batch *batch) {
+  for (size_t i = 0; i < batch->applications.size; ++i) {
+    free(batch->applications.data[i].name);
+    free(batch->applications.data[i].url);
+  }
+  batch->sections.size = 0;
+  batch->applications.size = 0;
+  batch->mem_used = 0;
+}
+
+void ait_batch_destroy(ait_batch *batch) {
+  ait_batch_clear(batch);
+  vec_ait_section_destroy(&batch->sections);
+  vec_ait_application_destroy(&batch->applications);
+}
+
+/* the location of the application, gathered from its descriptors. */
+typedef struct ait_url_parts_ {
+  const uint8_t *base;
+  uint8_t base_length;
+  const uint8_t *path;
+  uint8_t path_length;
+} ait_url_parts;
+
+static void decode_transport_protocol_dr(ait_url_parts *url,
+                                         const uint8_t *data, uint8_t length) {
+  /* protocol_id, transport_protocol_label, URL_base_length, URL_base, ... */
+  if (length < 4 || ((data[0] << 8) | data[1]) != HTTP_PROTOCOL_ID) {
+    return;
+  }
+  if (4 + data[3] > length) {
+    return;
+  }
+  url->base = data + 4;
+  url->base_length = data[3];
+}
+
+static void decode_application_name_dr(ait_application *app,
+                                       const uint8_t *data, uint8_t length) {
+  /* ISO_639_language_code, application_name_length, name. only the first
+   * language is kept. */
+  if (length < 4 || app->name || 4 + data[3] > length) {
+    return;
+  }
+  app->name = dvbstring_to_utf8(data + 4, data[3], &app->name_length);
+}
+
+static void decode_ait_descriptors(ait_application *app, ait_url_parts *url,
+                                   const uint8_t *pos, const uint8_t *end) {
+  uint8_t tag, length;
+  const uint8_t *data;
+  while (si_descriptor_next(&pos, end, &tag, &data, &length)) {
+    switch (tag) {
+    case APPLICATION_NAME_DR_TAG:
+      if (app) {
+        decode_application_name_dr(app, data, length);
+      }
+      break;
+
+    case TRANSPORT_PROTOCOL_DR_TAG:
+      decode_transport_protocol_dr(url, data, length);
+      break;
+
+    case SIMPLE_APPLICATION_LOCATION_DR_TAG:
+      url->path = data;
+      url->path_length = length;
+      break;
+    }
+  }
+}
+
+static char *concat_url(const ait_url_parts *url, size_t *outlen) {
+  const size_t len = url->base_length + url->path_length;
+  if (!url->base || len == 0) {
+    return 0;
+  }
+  char *rv = malloc(len);
+  if (!rv) {
+    return 0;
+  }
+  memcpy(rv, url->base, url->base_length);
+  if (url->path) {
+    memcpy(rv + url->base_length, url->path, url->path_length);
+  }
+  *outlen = len;
+  return rv;
+}
+
+static void rollback_applications(ait_batch *batch, size_t first) {
+  for (size_t i = first; i < batch->applications.size; ++i) {
+    ait_application *app = batch->applications.data + i;
+    batch->mem_used -= sizeof(*app) + app->name_length + app->url_length;
+    free(app->name);
+    free(app->url);
+  }
+  batch->applications.size = first;
+}
+
+int ait_batch_add_section(ait_batch *batch, const uint8_t *section,
+                          size_t size, uint16_t pid) {
+  if (section[0] != AIT_TABLE_ID || size < AIT_HEADER_SIZE + CRC_SIZE) {
+    return 0;
+  }
+
+  const uint8_t *pos = section + AIT_HEADER_SIZE;
+  const uint8_t *const end = section + size - CRC_SIZE;
+  const uint16_t common_length = ((section[8] & 0x0f) << 8) | section[9];
+  if (end - pos < common_length + 2) {
+    return 0;
+  }
+  /* transport protocols declared in the common loop apply to all the
+   * applications which don't declare their own. */
+  ait_url_parts common_url = {0, 0, 0, 0};
+  decode_ait_descriptors(0, &common_url, pos, pos + common_length);
+  pos += common_length;
+  const uint16_t loop_length = ((pos[0] & 0x0f) << 8) | pos[1];
+  pos += 2;
+  if (end - pos != loop_length) {
+    return 0;
+  }
+
+  const size_t first_app = batch->applications.size;
+  while (end - pos >= AIT_APPLICATION_HEADER_SIZE) {
+    const uint16_t dr_length = ((pos[7] & 0x0f) << 8) | pos[8];
+    if (end - pos - AIT_APPLICATION_HEADER_SIZE < dr_length) {
+      break;
+    }
+    ait_application *app = vec_ait_application_write(&batch->applications);
+    if (!app) {
+      break;
+    }
+    memset(app, 0, sizeof(*app));
+    app->organisation_id = ((uint32_t)pos[0] << 24) | (pos[1] << 16) |
+                           (pos[2] << 8) | pos[3];
+    app->application_id = (pos[4] << 8) | pos[5];
+    app->control_code = pos[6];
+    ait_url_parts url = common_url;
+    decode_ait_descriptors(app, &url, pos + AIT_APPLICATION_HEADER_SIZE,
+                           pos + AIT_APPLICATION_HEADER_SIZE + dr_length);
+    app->url = concat_url(&url, &app->url_length);
+    batch->mem_used += sizeof(*app) + app->name_length + app->url_length;
+    pos += AIT_APPLICATION_HEADER_SIZE + dr_length;
+  }
+
+  if (pos != end) {
+    rollback_applications(batch, first_app);
+    return 0;
+  }
+
+  ait_section *s = vec_ait_section_write(&batch->sections);
+  if (!s) {
+    rollback_applications(batch, first_app);
+    return 0;
+  }
+  s->pid = pid;
+  s->application_type = ((section[3] & 0x7f) << 8) | section[4];
+  s->version = (section[5] >> 1) & 0x1f;
+  s->num_applications = batch->applications.size - first_app;
+  batch->mem_used += sizeof(*s);
+  return 1;
+}
@@ -0,0 +1,68 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef DVBINDEX_AIT_H
+#define DVBINDEX_AIT_H
+
+#include "vec.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* decoding of the application information tables of TS 102 809, as used by
+ * HbbTV. AITs are carried on the PIDs with stream_type 0x05. */
+
+#define AIT_STREAM_TYPE 0x05
+#define AIT_TABLE_ID 0x74
+
+typedef struct ait_application_ {
+  uint32_t organisation_id;
+  uint16_t application_id;
+  uint8_t control_code;
+  char *name;
+  size_t name_length;
+  /* the HTTP URL base followed by the initial path, if any. */
+  char *url;
+  size_t url_length;
+} ait_application;
+VEC_DEFINE(ait_application)
+
+typedef struct ait_section_ {
+  uint16_t pid;
+  uint16_t application_type;
+  uint8_t version;
+  size_t num_applications;
+} ait_section;
+VEC_DEFINE(ait_section)
+
+/* AIT sections waiting to be written to the database. the applications of
+ * each of the sections are stored one after another in applications. */
+typedef struct ait_batch_ {
+  vec_ait_section sections;
+  vec_ait_application applications;
+  size_t mem_used;
+} ait_batch;
+
+void ait_batch_init(ait_batch *batch);
+void ait_batch_clear(ait_batch *batch);
+void ait_batch_destroy(ait_batch *batch);
+/* decodes an AIT section with a valid CRC_32 and appends it to the batch.
+ * returns 0 if the section is malformed. */
+int ait_batch_add_section(ait_batch *batch, const uint8_t *section,
+                          size_t size, uint16_t pid);
+
+#endif
@@ -0,0 +1,176 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include "archive.h"
+#include "pidstats.h"
+#include "section.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define CRC_SIZE 4
+
+void section_archive_init(section_archive *archive) {
+  vec_archived_section_init(&archive->sections);
+  archive->mem_used = 0;
+}
+
+void section_archive_clear(section_archive *archive) {
+  for (size_t i = 0; i < archive->sections.size; ++i) {
+    free(archive->sections.data[i].data);
+  }
+  archive->sections.size = 0;
+  archive->mem_used = 0;
+}
+
+void section_archive_destroy(section_archive *archive) {
+  section_archive_clear(archive);
+  vec_archived_section_destroy(&archive->sections);
+}
+
+uint32_t section_identity_crc(const uint8_t *section, size_t size) {
+  if (section_has_syntax(section) && size >= CRC_SIZE) {
+    const uint8_t *crc = section + size - CRC_SIZE;
+    return ((uint32_t)crc[0] << 24) | (crc[1] << 16) | (crc[2] << 8) | crc[3];
+  }
+  /* some sections without the indicator still end with a CRC_32, like the TOT
+   * and SCTE-35 ones, and the CRC over all of such a section is always 0. */
+  const uint32_t crc = section_crc32(section, size);
+  if (crc == 0 && size >= CRC_SIZE) {
+    const uint8_t *own = section + size - CRC_SIZE;
+    return ((uint32_t)own[0] << 24) | (own[1] << 16) | (own[2] << 8) | own[3];
+  }
+  return crc;
+}
+
+static void archived_section_parse_header(archived_section *s,
+                                          const uint8_t *section,
+                                          size_t size) {
+  s->table_id = section[0];
+  if (section_has_syntax(section) && size >= 8) {
+    s->table_id_ext = (section[3] << 8) | section[4];
+    s->version = (section[5] >> 1) & 0x1f;
+    s->section_number = section[6];
+  } else {
+    s->table_id_ext = -1;
+    s->version = -1;
+    s->section_number = -1;
+  }
+}
+
+static int section_archive_push(section_archive *archive,
+                                const archived_section *s) {
+  archived_section *dst = vec_archived_section_write(&archive->sections);
+  if (!dst) {
+    return 0;
+  }
+  *dst = *s;
+  archive->mem_used += sizeof(*dst) + s->compressed_size;
+  return 1;
+}
+
+int section_archive_add(section_archive *archive, const uint8_t *section,
+                        size_t size, uint16_t pid, uint32_t crc,
+                        int64_t file_offset) {
+  uLongf compressed_size = compressBound(size);
+  uint8_t *data = malloc(compressed_size);
+  if (!data) {
+    return 0;
+  }
+  if (compress(data, &compressed_size, section, size) != Z_OK) {
+    free(data);
+    return 0;
+  }
+
+  archived_section s;
+  s.file_offset = file_offset;
+  s.data = data;
+  s.compressed_size = compressed_size;
+  s.crc = crc;
+  s.size = size;
+  s.pid = pid;
+  archived_section_parse_header(&s, section, size);
+  if (!section_archive_push(archive, &s)) {
+    free(data);
+    return 0;
+  }
+  return 1;
+}
+
+int section_archive_add_compressed(section_archive *archive, uint8_t *data,
+                                   size_t compressed_size, size_t size,
+                                   uint16_t pid, int64_t file_offset) {
+  archived_section s;
+  s.file_offset = file_offset;
+  s.data = data;
+  s.compressed_size = compressed_size;
+  s.size = size;
+  s.pid = pid;
+  /* the header fields are only needed when writing to the database. */
+  s.crc = 0;
+  s.table_id = 0;
+  s.table_id_ext = -1;
+  s.version = -1;
+  s.section_number = -1;
+  if (!section_archive_push(archive, &s)) {
+    free(data);
+    return 0;
+  }
+  return 1;
+}
+
+size_t archived_section_uncompress(const archived_section *s, uint8_t *buf) {
+  uLongf size = SECTION_MAX_SIZE;
+  if (s->size > SECTION_MAX_SIZE ||
+      uncompress(buf, &size, s->data, s->compressed_size) != Z_OK ||
+      size != s->size) {
+    return 0;
+  }
+  return size;
+}
+
+#define TS_HEADER_SIZE 4
+
+void section_packetize(const uint8_t *section, size_t size, uint16_t pid,
+                       uint8_t *cc, ts_packet_cbk cbk, void *cbk_data) {
+  uint8_t packet[TS_PACKET_SIZE];
+  int first = 1;
+  while (size) {
+    packet[0] = 0x47;
+    packet[1] = (first ? 0x40 : 0x00) | (pid >> 8);
+    packet[2] = pid & 0xff;
+    packet[3] = 0x10 | *cc;
+    *cc = (*cc + 1) & 0x0f;
+    size_t pos = TS_HEADER_SIZE;
+    if (first) {
+      /* pointer_field */
+      packet[pos++] = 0;
+      first = 0;
+    }
+    size_t copied = TS_PACKET_SIZE - pos;
+    if (copied > size) {
+      copied = size;
+    }
+    memcpy(packet + pos, section, copied);
+    memset(packet + pos + copied, 0xff, TS_PACKET_SIZE - pos - copied);
+    section += copied;
+    size -= copied;
+    cbk(cbk_data, packet);
+  }
+}
@@ -0,0 +1,86 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#ifndef DVBINDEX_ARCHIVE_H
+#define DVBINDEX_ARCHIVE_H
+
+#include "vec.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/* every distinct PSI section of a file is kept, compressed, so that the tables
+ * derived from them can be rebuilt without reading the file again. */
+
+typedef struct archived_section_ {
+  int64_t file_offset;
+  /* the section compressed with zlib. */
+  uint8_t *data;
+  size_t compressed_size;
+  uint32_t crc;
+  /* -1 for sections without the section_syntax_indicator. */
+  int32_t table_id_ext;
+  int16_t version;
+  int16_t section_number;
+  uint16_t size;
+  uint16_t pid;
+  uint8_t table_id;
+} archived_section;
+VEC_DEFINE(archived_section)
+
+typedef struct section_archive_ {
+  vec_archived_section sections;
+  size_t mem_used;
+} section_archive;
+
+void section_archive_init(section_archive *archive);
+void section_archive_clear(section_archive *archive);
+void section_archive_destroy(section_archive *archive);
+/* returns 0 if the section could not be compressed. */
+int section_archive_add(section_archive *archive, const uint8_t *section,
+                        size_t size, uint16_t pid, uint32_t crc,
+                        int64_t file_offset);
+/* adds a section read back from the database, taking ownership of data. */
+int section_archive_add_compressed(section_archive *archive, uint8_t *data,
+                                   size_t compressed_size, size_t size,
+                                   uint16_t pid, int64_t file_offset);
+/* buf must hold SECTION_MAX_SIZE bytes. returns the size of the section, or 0
+ * if the data is corrupt. */
+size_t archived_section_uncompress(const archived_section *s, uint8_t *buf);
+
+/* the identifier of a section, used for finding the distinct ones : the CRC_32
+ * covers the version and the contents, and is computed for the sections which
+ * don't carry one. */
+uint32_t section_identity_crc(const uint8_t *section, size_t size);
+
+typedef void (*ts_packet_cbk)(void *cbk_data, uint8_t *packet);
+
+/* splits a section into TS packets on the given PID. cc is the continuity
+ * counter of the PID, updated for every packet. */
+void section_packetize(const uint8_t *section, size_t size, uint16_t pid,
+                       uint8_t *cc, ts_packet_cbk cbk, void *cbk_data);
+
+typedef struct archived_file_ {
+  int64_t rowid;
+  char *name;
+  off_t size;
+} archived_file;
+VEC_DEFINE(archived_file)
+
+#endif
@@ -25,6 +25,7 @@ typedef enum vid_stream_col_id_ {
   VID_STREAM_COLUMN_HEIGHT,
   VID_STREAM_COLUMN_FPS,
   VID_STREAM_COLUMN_BITRATE,
+  VID_STREAM_COLUMN_SCRAMBLED,
   VID_STREAM_COLUMN__LAST
 } vid_stream_col_id;
 
@@ -35,6 +36,7 @@ typedef enum aud_stream_col_id_ {
   AUD_STREAM_COLUMN_CHANNELS,
   AUD_STREAM_COLUMN_SAMPLE_RATE,
   AUD_STREAM_COLUMN_BITRATE,
+  AUD_STREAM_COLUMN_SCRAMBLED,
   AUD_STREAM_COLUMN__LAST
 } aud_stream_col_id;
 
@@ -50,6 +52,8 @@ typedef enum pmt_col_id_ {
   PMT_COLUMN_PROGRAM_NUMBER,
   PMT_COLUMN_VERSION,
   PMT_COLUMN_PCR_PID,
+  PMT_COLUMN_DURATION,
+  PMT_COLUMN_PCR_DISCONTINUITIES,
   PMT_COLUMN__LAST
 } pmt_col_id;
 
@@ -64,6 +68,8 @@ typedef enum sdt_col_id {
   SDT_COLUMN_PAT_ROWID = 1,
   SDT_COLUMN_VERSION,
   SDT_COLUMN_ORIGINAL_NETWORK_ID,
+  SDT_COLUMN_TSID,
+  SDT_COLUMN_ACTUAL,
   SDT_COLUMN__LAST
 } sdt_col_id;
 
@@ -80,6 +86,9 @@ typedef enum service_col_id_ {
 typedef enum file_col_id_ {
   FILE_COLUMN_NAME = 1,
   FILE_COLUMN_SIZE,
+  FILE_COLUMN_DURATION,
+  FILE_COLUMN_BITRATE,
+  FILE_COLUMN_PROBE_PROFILE,
   FILE_COLUMN__LAST
 } file_col_id;
 
@@ -112,6 +121,7 @@ typedef enum network_col_id_ {
   NETWORK_COLUMN_FILE_ROWID = 1,
   NETWORK_COLUMN_NETWORK_ID,
   NETWORK_COLUMN_NETWORK_NAME,
+  NETWORK_COLUMN_ACTUAL,
   NETWORK_COLUMN__LAST
 } network_col_id;
 
@@ -129,4 +139,199 @@ typedef enum ts_service_col_id_ {
   TS_SERVICE_COLUMN__LAST
 } ts_service_col_id;
 
+typedef enum eit_col_id_ {
+  EIT_COLUMN_FILE_ROWID = 1,
+  EIT_COLUMN_TABLE_ID,
+  EIT_COLUMN_SERVICE_ID,
+  EIT_COLUMN_TSID,
+  EIT_COLUMN_ONID,
+  EIT_COLUMN_VERSION,
+  EIT_COLUMN_SECTION_NUMBER,
+  EIT_COLUMN__LAST
+} eit_col_id;
+
+typedef enum event_col_id_ {
+  EVENT_COLUMN_EIT_ROWID = 1,
+  EVENT_COLUMN_EVENT_ID,
+  EVENT_COLUMN_START_TIME,
+  EVENT_COLUMN_DURATION,
+  EVENT_COLUMN_RUNNING_STATUS,
+  EVENT_COLUMN_SCRAMBLED,
+  EVENT_COLUMN_LANGUAGE,
+  EVENT_COLUMN_NAME,
+  EVENT_COLUMN_TEXT,
+  EVENT_COLUMN__LAST
+} event_col_id;
+
+typedef enum utc_time_col_id_ {
+  UTC_TIME_COLUMN_FILE_ROWID = 1,
+  UTC_TIME_COLUMN_BYTE_OFFSET,
+  UTC_TIME_COLUMN_UTC_TIME,
+  UTC_TIME_COLUMN_TABLE_ID,
+  UTC_TIME_COLUMN__LAST
+} utc_time_col_id;
+
+typedef enum local_time_offset_col_id_ {
+  LOCAL_TIME_OFFSET_COLUMN_UTC_TIME_ROWID = 1,
+  LOCAL_TIME_OFFSET_COLUMN_COUNTRY_CODE,
+  LOCAL_TIME_OFFSET_COLUMN_REGION_ID,
+  LOCAL_TIME_OFFSET_COLUMN_LOCAL_TIME_OFFSET,
+  LOCAL_TIME_OFFSET_COLUMN_TIME_OF_CHANGE,
+  LOCAL_TIME_OFFSET_COLUMN_NEXT_TIME_OFFSET,
+  LOCAL_TIME_OFFSET_COLUMN__LAST
+} local_time_offset_col_id;
+
+typedef enum cat_col_id_ {
+  CAT_COLUMN_FILE_ROWID = 1,
+  CAT_COLUMN_VERSION,
+  CAT_COLUMN__LAST
+} cat_col_id;
+
+typedef enum ca_system_col_id_ {
+  CA_SYSTEM_COLUMN_FILE_ROWID = 1,
+  CA_SYSTEM_COLUMN_CAT_ROWID,
+  CA_SYSTEM_COLUMN_PMT_ROWID,
+  CA_SYSTEM_COLUMN_ELEM_STREAM_ROWID,
+  CA_SYSTEM_COLUMN_CA_SYSTEM_ID,
+  CA_SYSTEM_COLUMN_CA_PID,
+  CA_SYSTEM_COLUMN__LAST
+} ca_system_col_id;
+
+typedef enum bouquet_col_id_ {
+  BOUQUET_COLUMN_FILE_ROWID = 1,
+  BOUQUET_COLUMN_BOUQUET_ID,
+  BOUQUET_COLUMN_VERSION,
+  BOUQUET_COLUMN_BOUQUET_NAME,
+  BOUQUET_COLUMN__LAST
+} bouquet_col_id;
+
+typedef enum bouquet_transport_stream_col_id_ {
+  BOUQUET_TRANSPORT_STREAM_COLUMN_BOUQUET_ROWID = 1,
+  BOUQUET_TRANSPORT_STREAM_COLUMN_TSID,
+  BOUQUET_TRANSPORT_STREAM_COLUMN_ONID,
+  BOUQUET_TRANSPORT_STREAM_COLUMN__LAST
+} bouquet_transport_stream_col_id;
+
+typedef enum bouquet_service_col_id_ {
+  BOUQUET_SERVICE_COLUMN_BOUQUET_TS_ROWID = 1,
+  BOUQUET_SERVICE_COLUMN_SERVICE_ID,
+  BOUQUET_SERVICE_COLUMN_SERVICE_TYPE,
+  BOUQUET_SERVICE_COLUMN__LAST
+} bouquet_service_col_id;
+
+typedef enum table_version_col_id_ {
+  TABLE_VERSION_COLUMN_FILE_ROWID = 1,
+  TABLE_VERSION_COLUMN_TABLE_ID,
+  TABLE_VERSION_COLUMN_TABLE_ID_EXT,
+  TABLE_VERSION_COLUMN_VERSION,
+  TABLE_VERSION_COLUMN_CURRENT_NEXT,
+  TABLE_VERSION_COLUMN_FIRST_BYTE_OFFSET,
+  TABLE_VERSION_COLUMN_FIRST_PCR,
+  TABLE_VERSION_COLUMN_END_BYTE_OFFSET,
+  TABLE_VERSION_COLUMN_END_PCR,
+  TABLE_VERSION_COLUMN_SUPERSEDED,
+  TABLE_VERSION_COLUMN__LAST
+} table_version_col_id;
+
+typedef enum pid_stat_col_id_ {
+  PID_STAT_COLUMN_FILE_ROWID = 1,
+  PID_STAT_COLUMN_PID,
+  PID_STAT_COLUMN_PACKETS,
+  PID_STAT_COLUMN_PAYLOAD_PACKETS,
+  PID_STAT_COLUMN_ADAPTATION_PACKETS,
+  PID_STAT_COLUMN_CC_ERRORS,
+  PID_STAT_COLUMN_SCRAMBLED_PACKETS,
+  PID_STAT_COLUMN_SHARE,
+  PID_STAT_COLUMN_BITRATE,
+  PID_STAT_COLUMN_FIRST_BYTE_OFFSET,
+  PID_STAT_COLUMN_LAST_BYTE_OFFSET,
+  PID_STAT_COLUMN__LAST
+} pid_stat_col_id;
+
+typedef enum tr101290_error_col_id_ {
+  TR101290_ERROR_COLUMN_FILE_ROWID = 1,
+  TR101290_ERROR_COLUMN_PRIORITY,
+  TR101290_ERROR_COLUMN_INDICATOR,
+  TR101290_ERROR_COLUMN_COUNT,
+  TR101290_ERROR_COLUMN_FIRST_BYTE_OFFSET,
+  TR101290_ERROR_COLUMN__LAST
+} tr101290_error_col_id;
+
+typedef enum splice_event_col_id_ {
+  SPLICE_EVENT_COLUMN_FILE_ROWID = 1,
+  SPLICE_EVENT_COLUMN_PID,
+  SPLICE_EVENT_COLUMN_BYTE_OFFSET,
+  SPLICE_EVENT_COLUMN_COMMAND_TYPE,
+  SPLICE_EVENT_COLUMN_SPLICE_EVENT_ID,
+  SPLICE_EVENT_COLUMN_CANCEL,
+  SPLICE_EVENT_COLUMN_OUT_OF_NETWORK,
+  SPLICE_EVENT_COLUMN_IMMEDIATE,
+  SPLICE_EVENT_COLUMN_PTS,
+  SPLICE_EVENT_COLUMN_BREAK_DURATION,
+  SPLICE_EVENT_COLUMN_AUTO_RETURN,
+  SPLICE_EVENT_COLUMN_UNIQUE_PROGRAM_ID,
+  SPLICE_EVENT_COLUMN__LAST
+} splice_event_col_id;
+
+typedef enum application_col_id_ {
+  APPLICATION_COLUMN_FILE_ROWID = 1,
+  APPLICATION_COLUMN_PID,
+  APPLICATION_COLUMN_APPLICATION_TYPE,
+  APPLICATION_COLUMN_VERSION,
+  APPLICATION_COLUMN_ORGANISATION_ID,
+  APPLICATION_COLUMN_APPLICATION_ID,
+  APPLICATION_COLUMN_CONTROL_CODE,
+  APPLICATION_COLUMN_NAME,
+  APPLICATION_COLUMN_URL,
+  APPLICATION_COLUMN__LAST
+} application_col_id;
+
+typedef enum carousel_col_id_ {
+  CAROUSEL_COLUMN_FILE_ROWID = 1,
+  CAROUSEL_COLUMN_ELEM_STREAM_ROWID,
+  CAROUSEL_COLUMN_PID,
+  CAROUSEL_COLUMN_CAROUSEL_ID,
+  CAROUSEL_COLUMN_DATA_BROADCAST_ID,
+  CAROUSEL_COLUMN__LAST
+} carousel_col_id;
+
+typedef enum random_access_point_col_id_ {
+  RANDOM_ACCESS_POINT_COLUMN_FILE_ROWID = 1,
+  RANDOM_ACCESS_POINT_COLUMN_PID,
+  RANDOM_ACCESS_POINT_COLUMN_BYTE_OFFSET,
+  RANDOM_ACCESS_POINT_COLUMN_PTS,
+  RANDOM_ACCESS_POINT_COLUMN_RANDOM_ACCESS_INDICATOR,
+  RANDOM_ACCESS_POINT_COLUMN_KEYFRAME,
+  RANDOM_ACCESS_POINT_COLUMN_PICTURES,
+  RANDOM_ACCESS_POINT_COLUMN__LAST
+} random_access_point_col_id;
+
+typedef enum pid_second_col_id_ {
+  PID_SECOND_COLUMN_FILE_ROWID = 1,
+  PID_SECOND_COLUMN_PID,
+  PID_SECOND_COLUMN_SECOND,
+  PID_SECOND_COLUMN_PACKETS,
+  PID_SECOND_COLUMN__LAST
+} pid_second_col_id;
+
+typedef enum archived_file_col_id_ {
+  ARCHIVED_FILE_COLUMN_NAME = 1,
+  ARCHIVED_FILE_COLUMN_SIZE,
+  ARCHIVED_FILE_COLUMN__LAST
+} archived_file_col_id;
+
+typedef enum section_col_id_ {
+  SECTION_COLUMN_ARCHIVED_FILE_ROWID = 1,
+  SECTION_COLUMN_PID,
+  SECTION_COLUMN_TABLE_ID,
+  SECTION_COLUMN_TABLE_ID_EXT,
+  SECTION_COLUMN_VERSION,
+  SECTION_COLUMN_SECTION_NUMBER,
+  SECTION_COLUMN_CRC,
+  SECTION_COLUMN_FIRST_BYTE_OFFSET,
+  SECTION_COLUMN_SIZE,
+  SECTION_COLUMN_DATA,
+  SECTION_COLUMN__LAST
+} section_col_id;
+
 #endif
@@ -0,0 +1,993 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include "esparse.h"
+#include "pidstats.h"
+#include "util.h"
+
+#include <string.h>
+
+#define PES_HEADER_SIZE 9
+
+typedef enum es_parser_state_ {
+  /* waiting for the next PES packet. */
+  ES_PARSE_IDLE,
+  ES_PARSE_GATHER,
+  ES_PARSE_DONE
+} es_parser_state;
+
+int es_codec_from_stream_type(uint8_t stream_type, uint8_t dvb_audio_tag) {
+  switch (stream_type) {
+  case 0x01:
+  case 0x02:
+    return ES_CODEC_MPEG2_VIDEO;
+  case 0x1b:
+    return ES_CODEC_H264;
+  case 0x24:
+    return ES_CODEC_HEVC;
+  case 0x03:
+  case 0x04:
+    return ES_CODEC_MPEG_AUDIO;
+  case 0x0f:
+    return ES_CODEC_AAC;
+  case 0x11:
+    return ES_CODEC_AAC_LATM;
+  case 0x81:
+    return ES_CODEC_AC3;
+  case 0x87:
+    return ES_CODEC_EAC3;
+  case 0x06:
+    switch (dvb_audio_tag) {
+    case 0x6a:
+      return ES_CODEC_AC3;
+    case 0x7a:
+      return ES_CODEC_EAC3;
+    case 0x7b:
+      return ES_CODEC_DTS;
+    case 0x7c:
+      return ES_CODEC_AAC;
+    }
+  }
+  return -1;
+}
+
+int es_codec_is_audio(es_codec codec) { return codec >= ES_CODEC_MPEG_AUDIO; }
+
+const char *es_codec_fmt(es_codec codec) {
+  /* what the mpegts demuxer of ffmpeg says before decoding anything. */
+  static const char *names[] = {"mpeg2video", "h264", "hevc", "mp3", "ac3",
+                                "eac3",       "aac",  "aac_latm", "dts"};
+  return names[codec];
+}
+
+int es_stream_type_is_data(uint8_t stream_type) {
+  switch (stream_type) {
+  case 0x05: /* private sections */
+  case 0x06: /* PES private data without an audio descriptor */
+  case 0x0a: /* DSM-CC */
+  case 0x0b:
+  case 0x0c:
+  case 0x0d:
+  case 0x13:
+  case 0x14:
+  case 0x15: /* metadata */
+  case 0x16:
+  case 0x86: /* SCTE-35 */
+    return 1;
+  }
+  return 0;
+}
+
+void es_parser_init(es_parser *p, uint16_t pid, es_codec codec) {
+  p->params.fmt = 0;
+  p->params.fps = 0;
+  p->params.bitrate = 0;
+  p->params.width = 0;
+  p->params.height = 0;
+  p->params.channels = 0;
+  p->params.sample_rate = 0;
+  p->size = 0;
+  p->pid = pid;
+  p->codec = codec;
+  p->state = ES_PARSE_IDLE;
+  p->scrambled = 0;
+}
+
+int es_parser_done(const es_parser *p) { return p->state == ES_PARSE_DONE; }
+
+int es_parser_resolved(const es_parser *p) {
+  return es_parser_done(p) || p->scrambled;
+}
+
+typedef struct bit_reader_ {
+  const uint8_t *buf;
+  size_t size;
+  size_t bit;
+  int overrun;
+} bit_reader;
+
+static void br_init(bit_reader *br, const uint8_t *buf, size_t size) {
+  br->buf = buf;
+  br->size = size;
+  br->bit = 0;
+  br->overrun = 0;
+}
+
+static uint32_t br_u(bit_reader *br, int bits) {
+  if (br->bit + bits > br->size * 8) {
+    br->bit = br->size * 8;
+    br->overrun = 1;
+    return 0;
+  }
+  uint32_t value = 0;
+  for (int i = 0; i < bits; ++i, ++br->bit) {
+    value = (value << 1) | ((br->buf[br->bit / 8] >> (7 - br->bit % 8)) & 1);
+  }
+  return value;
+}
+
+static void br_skip(bit_reader *br, size_t bits) {
+  if (br->bit + bits > br->size * 8) {
+    br->bit = br->size * 8;
+    br->overrun = 1;
+  } else {
+    br->bit += bits;
+  }
+}
+
+/* Exp-Golomb codes. */
+static uint32_t br_ue(bit_reader *br) {
+  int zeros = 0;
+  while (!br_u(br, 1)) {
+    if (br->overrun || ++zeros > 31) {
+      br->overrun = 1;
+      return 0;
+    }
+  }
+  return (uint32_t)((UINT64_C(1) << zeros) - 1 + br_u(br, zeros));
+}
+
+static int32_t br_se(bit_reader *br) {
+  const uint32_t k = br_ue(br);
+  return (k & 1) ? (int32_t)((k + 1) / 2) : -(int32_t)(k / 2);
+}
+
+/* returns the offset following the next 00 00 01 from the given one, or size
+ * if there's none. */
+static size_t next_start_code(const uint8_t *buf, size_t size, size_t from) {
+  for (size_t i = from; i + 3 <= size; ++i) {
+    if (buf[i] == 0 && buf[i + 1] == 0 && buf[i + 2] == 1) {
+      return i + 3;
+    }
+  }
+  return size;
+}
+
+/* the ISO/IEC 13818-2 sequence header, and the sequence extension following it
+ * in MPEG-2. */
+static const double mpeg2_frame_rates[16] = {
+    0, 24000.0 / 1001, 24, 25, 30000.0 / 1001, 30, 50, 60000.0 / 1001, 60};
+
+static int parse_mpeg2_video(const uint8_t *buf, size_t size,
+                             es_params *params) {
+  for (size_t pos = next_start_code(buf, size, 0); pos < size;
+       pos = next_start_code(buf, size, pos)) {
+    if (buf[pos] != 0xb3) {
+      continue;
+    }
+    bit_reader br;
+    br_init(&br, buf + pos + 1, size - pos - 1);
+    uint32_t width = br_u(&br, 12);
+    uint32_t height = br_u(&br, 12);
+    br_skip(&br, 4); /* aspect_ratio_information */
+    double fps = mpeg2_frame_rates[br_u(&br, 4)];
+    uint32_t bit_rate = br_u(&br, 18);
+    if (br.overrun || !width || !height || fps == 0) {
+      continue;
+    }
+    int vbr = bit_rate == 0x3ffff;
+    const size_t ext = next_start_code(buf, size, pos);
+    if (ext + 1 < size && buf[ext] == 0xb5 && (buf[ext + 1] >> 4) == 1) {
+      br_init(&br, buf + ext + 1, size - ext - 1);
+      /* extension_start_code_identifier, profile_and_level_indication,
+       * progressive_sequence and chroma_format. */
+      br_skip(&br, 4 + 8 + 1 + 2);
+      const uint32_t width_ext = br_u(&br, 2);
+      const uint32_t height_ext = br_u(&br, 2);
+      const uint32_t bit_rate_ext = br_u(&br, 12);
+      br_skip(&br, 1 + 8 + 1); /* marker, vbv_buffer_size, low_delay */
+      const uint32_t fps_n = br_u(&br, 2);
+      const uint32_t fps_d = br_u(&br, 5);
+      if (!br.overrun) {
+        width |= width_ext << 12;
+        height |= height_ext << 12;
+        bit_rate |= bit_rate_ext << 18;
+        vbr = vbr && bit_rate_ext == 0xfff;
+        fps = fps * (fps_n + 1) / (fps_d + 1);
+      }
+    }
+    params->fmt = "mpeg2video";
+    params->width = (int)width;
+    params->height = (int)height;
+    params->fps = fps;
+    params->bitrate = vbr ? 0 : (int64_t)bit_rate * 400;
+    return 1;
+  }
+  return 0;
+}
+
+/* removes the emulation prevention bytes of a NAL unit. */
+static size_t nal_unescape(const uint8_t *src, size_t size, uint8_t *dst) {
+  size_t n = 0;
+  int zeros = 0;
+  for (size_t i = 0; i < size; ++i) {
+    if (zeros >= 2 && src[i] == 0x03) {
+      zeros = 0;
+      continue;
+    }
+    zeros = src[i] == 0 ? zeros + 1 : 0;
+    dst[n++] = src[i];
+  }
+  return n;
+}
+
+static int h264_profile_has_chroma_format(uint32_t profile_idc) {
+  switch (profile_idc) {
+  case 44:
+  case 83:
+  case 86:
+  case 100:
+  case 110:
+  case 118:
+  case 122:
+  case 128:
+  case 134:
+  case 135:
+  case 138:
+  case 139:
+  case 244:
+    return 1;
+  }
+  return 0;
+}
+
+static void skip_h264_scaling_list(bit_reader *br, int size) {
+  int32_t last = 8;
+  int32_t next = 8;
+  for (int i = 0; i < size && !br->overrun; ++i) {
+    if (next != 0) {
+      next = (last + br_se(br) + 256) % 256;
+    }
+    last = next == 0 ? last : next;
+  }
+}
+
+/* the size is cropped the same way as ffmpeg does. the frame rate needs the
+ * timing information of the VUI. */
+static int parse_h264_sps(const uint8_t *nal, size_t size, es_params *params) {
+  bit_reader br;
+  br_init(&br, nal + 1, size - 1);
+  const uint32_t profile_idc = br_u(&br, 8);
+  br_skip(&br, 16); /* constraint flags and level_idc */
+  br_ue(&br);       /* seq_parameter_set_id */
+  uint32_t chroma_format_idc = 1;
+  if (h264_profile_has_chroma_format(profile_idc)) {
+    chroma_format_idc = br_ue(&br);
+    const int lists = chroma_format_idc == 3 ? 12 : 8;
+    if (chroma_format_idc == 3 && br_u(&br, 1)) {
+      /* separate_colour_plane_flag : cropped like monochrome. */
+      chroma_format_idc = 0;
+    }
+    br_ue(&br);       /* bit_depth_luma_minus8 */
+    br_ue(&br);       /* bit_depth_chroma_minus8 */
+    br_skip(&br, 1);  /* qpprime_y_zero_transform_bypass_flag */
+    if (br_u(&br, 1)) { /* seq_scaling_matrix_present_flag */
+      for (int i = 0; i < lists; ++i) {
+        if (br_u(&br, 1)) {
+          skip_h264_scaling_list(&br, i < 6 ? 16 : 64);
+        }
+      }
+    }
+  }
+  br_ue(&br); /* log2_max_frame_num_minus4 */
+  const uint32_t poc_type = br_ue(&br);
+  if (poc_type == 0) {
+    br_ue(&br); /* log2_max_pic_order_cnt_lsb_minus4 */
+  } else if (poc_type == 1) {
+    br_skip(&br, 1); /* delta_pic_order_always_zero_flag */
+    br_se(&br);      /* offset_for_non_ref_pic */
+    br_se(&br);      /* offset_for_top_to_bottom_field */
+    const uint32_t cycle = br_ue(&br);
+    if (cycle > 255) {
+      return 0;
+    }
+    for (uint32_t i = 0; i < cycle; ++i) {
+      br_se(&br);
+    }
+  }
+  br_ue(&br);      /* max_num_ref_frames */
+  br_skip(&br, 1); /* gaps_in_frame_num_value_allowed_flag */
+  const int64_t width_mbs = (int64_t)br_ue(&br) + 1;
+  const int64_t height_map_units = (int64_t)br_ue(&br) + 1;
+  const uint32_t frame_mbs_only = br_u(&br, 1);
+  if (!frame_mbs_only) {
+    br_skip(&br, 1); /* mb_adaptive_frame_field_flag */
+  }
+  br_skip(&br, 1); /* direct_8x8_inference_flag */
+  int64_t crop[4] = {0, 0, 0, 0};
+  if (br_u(&br, 1)) {
+    for (int i = 0; i < 4; ++i) {
+      crop[i] = br_ue(&br);
+    }
+  }
+  const int64_t crop_x = chroma_format_idc == 1 || chroma_format_idc == 2;
+  const int64_t crop_y = (chroma_format_idc == 1 ? 2 : 1) * (2 - frame_mbs_only);
+  const int64_t width = width_mbs * 16 - (crop_x + 1) * (crop[0] + crop[1]);
+  const int64_t height = (2 - frame_mbs_only) * height_map_units * 16 -
+                         crop_y * (crop[2] + crop[3]);
+
+  if (!br_u(&br, 1)) { /* vui_parameters_present_flag */
+    return 0;
+  }
+  if (br_u(&br, 1) && br_u(&br, 8) == 255) { /* aspect_ratio_info */
+    br_skip(&br, 32);
+  }
+  if (br_u(&br, 1)) { /* overscan_info_present_flag */
+    br_skip(&br, 1);
+  }
+  if (br_u(&br, 1)) { /* video_signal_type_present_flag */
+    br_skip(&br, 4);
+    if (br_u(&br, 1)) {
+      br_skip(&br, 24); /* colour description */
+    }
+  }
+  if (br_u(&br, 1)) { /* chroma_loc_info_present_flag */
+    br_ue(&br);
+    br_ue(&br);
+  }
+  if (!br_u(&br, 1)) { /* timing_info_present_flag */
+    return 0;
+  }
+  const uint32_t num_units_in_tick = br_u(&br, 32);
+  const uint32_t time_scale = br_u(&br, 32);
+  if (br.overrun || !num_units_in_tick || !time_scale || width <= 0 ||
+      height <= 0 || width > 16384 || height > 16384) {
+    return 0;
+  }
+  params->fmt = "h264";
+  params->width = (int)width;
+  params->height = (int)height;
+  /* a tick is a field. */
+  params->fps = time_scale / (2.0 * num_units_in_tick);
+  return 1;
+}
+
+static void skip_hevc_profile_tier_level(bit_reader *br,
+                                         uint32_t max_sub_layers_minus1) {
+  uint8_t profile_present[8];
+  uint8_t level_present[8];
+  br_skip(br, 96); /* the general profile, tier and level */
+  for (uint32_t i = 0; i < max_sub_layers_minus1; ++i) {
+    profile_present[i] = br_u(br, 1);
+    level_present[i] = br_u(br, 1);
+  }
+  if (max_sub_layers_minus1 > 0) {
+    br_skip(br, 2 * (8 - max_sub_layers_minus1));
+  }
+  for (uint32_t i = 0; i < max_sub_layers_minus1; ++i) {
+    br_skip(br, (profile_present[i] ? 88 : 0) + (level_present[i] ? 8 : 0));
+  }
+}
+
+static void skip_hevc_sub_layer_ordering(bit_reader *br,
+                                         uint32_t max_sub_layers_minus1) {
+  const uint32_t first = br_u(br, 1) ? 0 : max_sub_layers_minus1;
+  for (uint32_t i = first; i <= max_sub_layers_minus1; ++i) {
+    br_ue(br);
+    br_ue(br);
+    br_ue(br);
+  }
+}
+
+/* the VPS might have the timing information missing from the SPS. */
+static int parse_hevc_vps_fps(const uint8_t *nal, size_t size, double *fps) {
+  bit_reader br;
+  br_init(&br, nal + 2, size - 2);
+  /* vps_video_parameter_set_id, vps_base_layer_internal_flag,
+   * vps_base_layer_available_flag and vps_max_layers_minus1. */
+  br_skip(&br, 4 + 1 + 1 + 6);
+  const uint32_t max_sub_layers_minus1 = br_u(&br, 3);
+  br_skip(&br, 1 + 16); /* vps_temporal_id_nesting_flag, reserved */
+  skip_hevc_profile_tier_level(&br, max_sub_layers_minus1);
+  skip_hevc_sub_layer_ordering(&br, max_sub_layers_minus1);
+  const uint32_t max_layer_id = br_u(&br, 6);
+  const uint32_t num_layer_sets_minus1 = br_ue(&br);
+  if (num_layer_sets_minus1 > 1023) {
+    return 0;
+  }
+  br_skip(&br, (size_t)num_layer_sets_minus1 * (max_layer_id + 1));
+  if (!br_u(&br, 1)) { /* vps_timing_info_present_flag */
+    return 0;
+  }
+  const uint32_t num_units_in_tick = br_u(&br, 32);
+  const uint32_t time_scale = br_u(&br, 32);
+  if (br.overrun || !num_units_in_tick || !time_scale) {
+    return 0;
+  }
+  *fps = time_scale / (double)num_units_in_tick;
+  return 1;
+}
+
+static void skip_hevc_scaling_list_data(bit_reader *br) {
+  for (int size_id = 0; size_id < 4; ++size_id) {
+    for (int matrix_id = 0; matrix_id < 6; matrix_id += size_id == 3 ? 3 : 1) {
+      if (!br_u(br, 1)) { /* scaling_list_pred_mode_flag */
+        br_ue(br);
+        continue;
+      }
+      if (size_id > 1) {
+        br_se(br); /* scaling_list_dc_coef_minus8 */
+      }
+      for (int i = 0; i < (size_id == 0 ? 16 : 64); ++i) {
+        br_se(br);
+      }
+    }
+  }
+}
+
+static int skip_hevc_st_ref_pic_sets(bit_reader *br, uint32_t count) {
+  uint32_t num_delta_pocs[64];
+  for (uint32_t i = 0; i < count && !br->overrun; ++i) {
+    if (i != 0 && br_u(br, 1)) { /* inter_ref_pic_set_prediction_flag */
+      br_skip(br, 1);            /* delta_rps_sign */
+      br_ue(br);                 /* abs_delta_rps_minus1 */
+      uint32_t n = 0;
+      for (uint32_t j = 0; j <= num_delta_pocs[i - 1]; ++j) {
+        /* used_by_curr_pic_flag, or else use_delta_flag. */
+        if (br_u(br, 1) || br_u(br, 1)) {
+          ++n;
+        }
+      }
+      num_delta_pocs[i] = n;
+    } else {
+      const uint32_t negative = br_ue(br);
+      const uint32_t positive = br_ue(br);
+      if (negative > 16 || positive > 16) {
+        return 0;
+      }
+      for (uint32_t j = 0; j < negative + positive; ++j) {
+        br_ue(br);       /* delta_poc_minus1 */
+        br_skip(br, 1); /* used_by_curr_pic_flag */
+      }
+      num_delta_pocs[i] = negative + positive;
+    }
+  }
+  return !br->overrun;
+}
+
+static int parse_hevc_sps(const uint8_t *nal, size_t size, double vps_fps,
+                          es_params *params) {
+  bit_reader br;
+  br_init(&br, nal + 2, size - 2);
+  br_skip(&br, 4); /* sps_video_parameter_set_id */
+  const uint32_t max_sub_layers_minus1 = br_u(&br, 3);
+  br_skip(&br, 1); /* sps_temporal_id_nesting_flag */
+  skip_hevc_profile_tier_level(&br, max_sub_layers_minus1);
+  br_ue(&br); /* sps_seq_parameter_set_id */
+  uint32_t chroma_format_idc = br_ue(&br);
+  if (chroma_format_idc == 3 && br_u(&br, 1)) {
+    chroma_format_idc = 0; /* separate_colour_plane_flag */
+  }
+  int64_t width = br_ue(&br);
+  int64_t height = br_ue(&br);
+  if (br_u(&br, 1)) { /* conformance_window_flag */
+    const int64_t sub_width = chroma_format_idc == 1 || chroma_format_idc == 2;
+    const int64_t sub_height = chroma_format_idc == 1;
+    const int64_t left = br_ue(&br);
+    const int64_t right = br_ue(&br);
+    const int64_t top = br_ue(&br);
+    const int64_t bottom = br_ue(&br);
+    width -= (sub_width + 1) * (left + right);
+    height -= (sub_height + 1) * (top + bottom);
+  }
+  br_ue(&br); /* bit_depth_luma_minus8 */
+  br_ue(&br); /* bit_depth_chroma_minus8 */
+  const uint32_t log2_max_poc_lsb = br_ue(&br) + 4;
+  if (log2_max_poc_lsb > 16) {
+    return 0;
+  }
+  skip_hevc_sub_layer_ordering(&br, max_sub_layers_minus1);
+  /* the coding block and transform sizes. */
+  for (int i = 0; i < 6; ++i) {
+    br_ue(&br);
+  }
+  /* scaling_list_enabled_flag, sps_scaling_list_data_present_flag */
+  if (br_u(&br, 1) && br_u(&br, 1)) {
+    skip_hevc_scaling_list_data(&br);
+  }
+  br_skip(&br, 2); /* amp_enabled_flag, sample_adaptive_offset_enabled_flag */
+  if (br_u(&br, 1)) { /* pcm_enabled_flag */
+    br_skip(&br, 8);
+    br_ue(&br);
+    br_ue(&br);
+    br_skip(&br, 1);
+  }
+  const uint32_t st_ref_pic_sets = br_ue(&br);
+  if (st_ref_pic_sets > 64 ||
+      !skip_hevc_st_ref_pic_sets(&br, st_ref_pic_sets)) {
+    return 0;
+  }
+  if (br_u(&br, 1)) { /* long_term_ref_pics_present_flag */
+    const uint32_t long_term = br_ue(&br);
+    if (long_term > 32) {
+      return 0;
+    }
+    br_skip(&br, (size_t)long_term * (log2_max_poc_lsb + 1));
+  }
+  /* sps_temporal_mvp_enabled_flag, strong_intra_smoothing_enabled_flag */
+  br_skip(&br, 2);
+  double fps = vps_fps;
+  if (br_u(&br, 1)) { /* vui_parameters_present_flag */
+    if (br_u(&br, 1) && br_u(&br, 8) == 255) { /* aspect_ratio_info */
+      br_skip(&br, 32);
+    }
+    if (br_u(&br, 1)) { /* overscan_info_present_flag */
+      br_skip(&br, 1);
+    }
+    if (br_u(&br, 1)) { /* video_signal_type_present_flag */
+      br_skip(&br, 4);
+      if (br_u(&br, 1)) {
+        br_skip(&br, 24);
+      }
+    }
+    if (br_u(&br, 1)) { /* chroma_loc_info_present_flag */
+      br_ue(&br);
+      br_ue(&br);
+    }
+    /* neutral_chroma_indication_flag, field_seq_flag,
+     * frame_field_info_present_flag */
+    br_skip(&br, 3);
+    if (br_u(&br, 1)) { /* default_display_window_flag */
+      for (int i = 0; i < 4; ++i) {
+        br_ue(&br);
+      }
+    }
+    if (br_u(&br, 1)) { /* vui_timing_info_present_flag */
+      const uint32_t num_units_in_tick = br_u(&br, 32);
+      const uint32_t time_scale = br_u(&br, 32);
+      if (num_units_in_tick && time_scale) {
+        fps = time_scale / (double)num_units_in_tick;
+      }
+    }
+  }
+  if (br.overrun || fps == 0 || width <= 0 || height <= 0 || width > 16384 ||
+      height > 16384) {
+    return 0;
+  }
+  params->fmt = "hevc";
+  params->width = (int)width;
+  params->height = (int)height;
+  params->fps = fps;
+  return 1;
+}
+
+static int parse_nal_video(es_parser *p) {
+  uint8_t nal[ES_PARSER_BUF_SIZE];
+  double vps_fps = 0;
+  size_t pos = next_start_code(p->buf, p->size, 0);
+  while (pos < p->size) {
+    const size_t next = next_start_code(p->buf, p->size, pos);
+    const size_t end = next < p->size ? next - 3 : p->size;
+    const size_t size = nal_unescape(p->buf + pos, end - pos, nal);
+    if (p->codec == ES_CODEC_H264) {
+      if (size > 1 && (nal[0] & 0x1f) == 7 &&
+          parse_h264_sps(nal, size, &p->params)) {
+        return 1;
+      }
+    } else if (size > 2) {
+      const int nal_type = (nal[0] >> 1) & 0x3f;
+      if (nal_type == 32) {
+        parse_hevc_vps_fps(nal, size, &vps_fps);
+      } else if (nal_type == 33 &&
+                 parse_hevc_sps(nal, size, vps_fps, &p->params)) {
+        return 1;
+      }
+    }
+    pos = next;
+  }
+  return 0;
+}
+
+/* returns the size of the frame starting with the header, or 0 if this is not
+ * a valid header. */
+typedef size_t (*audio_header_fn)(const uint8_t *h, es_params *params);
+
+/* ISO/IEC 11172-3 and 13818-3 frame headers. */
+static const uint16_t mpa_bitrates[2][3][15] = {
+    {{0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},
+     {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+     {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320}},
+    {{0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+     {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+     {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160}}};
+static const uint16_t mpa_sample_rates[3] = {44100, 48000, 32000};
+
+static size_t mpa_header(const uint8_t *h, es_params *params) {
+  if (h[0] != 0xff || (h[1] & 0xe0) != 0xe0) {
+    return 0;
+  }
+  /* 3 is MPEG-1, 2 MPEG-2 and 0 MPEG-2.5. */
+  const int version = (h[1] >> 3) & 0x03;
+  const int layer = 4 - ((h[1] >> 1) & 0x03);
+  const int bitrate_index = h[2] >> 4;
+  const int sample_rate_index = (h[2] >> 2) & 0x03;
+  if (version == 1 || layer == 4 || bitrate_index == 0 ||
+      bitrate_index == 15 || sample_rate_index == 3) {
+    return 0;
+  }
+  const int lsf = version != 3;
+  const int bitrate = mpa_bitrates[lsf][layer - 1][bitrate_index] * 1000;
+  const int sample_rate =
+      mpa_sample_rates[sample_rate_index] >> (3 - version - (version == 0));
+  const int padding = (h[2] >> 1) & 0x01;
+  size_t size;
+  if (layer == 1) {
+    size = (size_t)(12 * bitrate / sample_rate + padding) * 4;
+  } else if (layer == 2 || !lsf) {
+    size = (size_t)(144 * bitrate / sample_rate + padding);
+  } else {
+    size = (size_t)(72 * bitrate / sample_rate + padding);
+  }
+  static const char *names[] = {"mp1", "mp2", "mp3"};
+  params->fmt = names[layer - 1];
+  params->channels = (h[3] >> 6) == 3 ? 1 : 2;
+  params->sample_rate = sample_rate;
+  params->bitrate = bitrate;
+  return size;
+}
+
+/* ATSC A/52 AC-3 and E-AC-3 sync frames. */
+static const uint16_t ac3_bitrates[19] = {32,  40,  48,  56,  64,  80,  96,
+                                          112, 128, 160, 192, 224, 256, 320,
+                                          384, 448, 512, 576, 640};
+static const uint16_t ac3_sample_rates[3] = {48000, 44100, 32000};
+static const uint8_t ac3_channels[8] = {2, 1, 2, 3, 3, 4, 4, 5};
+
+static size_t ac3_header(const uint8_t *h, es_params *params) {
+  if (h[0] != 0x0b || h[1] != 0x77) {
+    return 0;
+  }
+  const int bsid = h[5] >> 3;
+  bit_reader br;
+  size_t size;
+  uint32_t acmod;
+  if (bsid <= 10) {
+    br_init(&br, h + 4, 4);
+    const uint32_t fscod = br_u(&br, 2);
+    const uint32_t frmsizecod = br_u(&br, 6);
+    if (fscod == 3 || frmsizecod > 37) {
+      return 0;
+    }
+    br_skip(&br, 5 + 3); /* bsid, bsmod */
+    acmod = br_u(&br, 3);
+    if ((acmod & 1) && acmod != 1) {
+      br_skip(&br, 2); /* cmixlev */
+    }
+    if (acmod & 4) {
+      br_skip(&br, 2); /* surmixlev */
+    }
+    if (acmod == 2) {
+      br_skip(&br, 2); /* dsurmod */
+    }
+    const int bitrate = ac3_bitrates[frmsizecod >> 1];
+    const int sample_rate = ac3_sample_rates[fscod];
+    /* in 16-bit words, with an extra word every other frame at 44.1 kHz. */
+    size = 2 * ((size_t)bitrate * 96000 / sample_rate +
+                (fscod == 1 ? (frmsizecod & 1) : 0));
+    params->fmt = "ac3";
+    params->sample_rate = sample_rate;
+    params->bitrate = bitrate * 1000;
+  } else if (bsid <= 16) {
+    br_init(&br, h + 2, 6);
+    br_skip(&br, 2 + 3); /* strmtyp, substreamid */
+    size = (br_u(&br, 11) + 1) * 2;
+    const uint32_t fscod = br_u(&br, 2);
+    int sample_rate;
+    int blocks;
+    if (fscod == 3) {
+      static const uint16_t reduced_sample_rates[3] = {24000, 22050, 16000};
+      const uint32_t fscod2 = br_u(&br, 2);
+      if (fscod2 == 3) {
+        return 0;
+      }
+      sample_rate = reduced_sample_rates[fscod2];
+      blocks = 6;
+    } else {
+      static const uint8_t numblks[4] = {1, 2, 3, 6};
+      sample_rate = ac3_sample_rates[fscod];
+      blocks = numblks[br_u(&br, 2)];
+    }
+    acmod = br_u(&br, 3);
+    params->fmt = "eac3";
+    params->sample_rate = sample_rate;
+    params->bitrate = (int64_t)size * 8 * sample_rate / (blocks * 256);
+  } else {
+    return 0;
+  }
+  const uint32_t lfeon = br_u(&br, 1);
+  params->channels = ac3_channels[acmod] + lfeon;
+  return size;
+}
+
+/* ISO/IEC 13818-7 ADTS frames. */
+static const uint32_t aac_sample_rates[13] = {96000, 88200, 64000, 48000, 44100,
+                                              32000, 24000, 22050, 16000, 12000,
+                                              11025, 8000,  7350};
+
+static size_t adts_header(const uint8_t *h, es_params *params) {
+  /* the syncword, and layer 0. */
+  if (h[0] != 0xff || (h[1] & 0xf6) != 0xf0) {
+    return 0;
+  }
+  const int sample_rate_index = (h[2] >> 2) & 0x0f;
+  const int channel_config = ((h[2] & 0x01) << 2) | (h[3] >> 6);
+  const size_t size = ((size_t)(h[3] & 0x03) << 11) | (h[4] << 3) | (h[5] >> 5);
+  const int raw_data_blocks = (h[6] & 0x03) + 1;
+  if (sample_rate_index >= 13 || channel_config == 0 || size < 7) {
+    return 0;
+  }
+  const uint32_t sample_rate = aac_sample_rates[sample_rate_index];
+  /* implicit SBR only shows when decoding, which is left to ffmpeg. */
+  if (sample_rate <= 24000) {
+    return 0;
+  }
+  params->fmt = "aac";
+  params->channels = channel_config == 7 ? 8 : channel_config;
+  params->sample_rate = (int)sample_rate;
+  params->bitrate = (int64_t)size * 8 * sample_rate / (1024 * raw_data_blocks);
+  return size;
+}
+
+/* ETSI TS 102 114 core frames, in the 16-bit big endian format. */
+static const uint32_t dts_sample_rates[16] = {
+    0, 8000, 16000, 32000, 0, 0, 11025, 22050, 44100, 0, 0, 12000, 24000,
+    48000, 96000, 192000};
+static const uint32_t dts_bitrates[29] = {
+    32000,   56000,   64000,   96000,   112000,  128000,  192000, 224000,
+    256000,  320000,  384000,  448000,  512000,  576000,  640000, 768000,
+    896000,  1024000, 1152000, 1280000, 1344000, 1408000, 1411200, 1472000,
+    1536000, 1920000, 2048000, 3072000, 3840000};
+static const uint8_t dts_channels[16] = {1, 2, 2, 2, 2, 3, 3, 4,
+                                         4, 5, 6, 6, 6, 7, 8, 8};
+
+static size_t dts_header(const uint8_t *h, es_params *params) {
+  if (h[0] != 0x7f || h[1] != 0xfe || h[2] != 0x80 || h[3] != 0x01) {
+    return 0;
+  }
+  bit_reader br;
+  br_init(&br, h + 4, 8);
+  br_skip(&br, 1 + 5 + 1 + 7); /* FTYPE, SHORT, CPF, NBLKS */
+  const size_t size = br_u(&br, 14) + 1;
+  const uint32_t amode = br_u(&br, 6);
+  const uint32_t sfreq = br_u(&br, 4);
+  const uint32_t rate = br_u(&br, 5);
+  /* the reserved bit, DYNF, TIMEF, AUXF, HDCD, EXT_AUDIO_ID, EXT_AUDIO and
+   * ASPF. */
+  br_skip(&br, 1 + 1 + 1 + 1 + 1 + 3 + 1 + 1);
+  const uint32_t lff = br_u(&br, 2);
+  if (size < 96 || amode >= 16 || !dts_sample_rates[sfreq] || lff == 3) {
+    return 0;
+  }
+  params->fmt = "dts";
+  params->channels = dts_channels[amode] + (lff != 0);
+  params->sample_rate = (int)dts_sample_rates[sfreq];
+  params->bitrate = rate < ARRAY_SIZE(dts_bitrates) ? dts_bitrates[rate] : 0;
+  return size;
+}
+
+/* looks for a frame header followed by another one, unless the frame ends the
+ * buffer. the bitrate is averaged over the frames found. */
+static int parse_audio_frames(es_parser *p, audio_header_fn header,
+                              size_t header_size) {
+  for (size_t pos = 0; pos + header_size <= p->size; ++pos) {
+    es_params params = p->params;
+    const size_t size = header(p->buf + pos, &params);
+    if (size == 0) {
+      continue;
+    }
+    int64_t bitrates = params.bitrate;
+    int frames = 1;
+    size_t next = pos + size;
+    while (next + header_size <= p->size) {
+      es_params following = params;
+      const size_t following_size = header(p->buf + next, &following);
+      if (following_size == 0) {
+        break;
+      }
+      bitrates += following.bitrate;
+      ++frames;
+      next += following_size;
+    }
+    if (frames == 1 && next + header_size <= p->size) {
+      /* a false sync. */
+      continue;
+    }
+    params.bitrate = bitrates / frames;
+    p->params = params;
+    return 1;
+  }
+  return 0;
+}
+
+static uint32_t latm_get_value(bit_reader *br) {
+  const uint32_t bytes = br_u(br, 2);
+  uint32_t value = 0;
+  for (uint32_t i = 0; i <= bytes; ++i) {
+    value = (value << 8) | br_u(br, 8);
+  }
+  return value;
+}
+
+/* ISO/IEC 14496-3 AudioSpecificConfig. */
+static int parse_audio_specific_config(bit_reader *br, es_params *params) {
+  uint32_t object_type = br_u(br, 5);
+  if (object_type == 31) {
+    object_type = 32 + br_u(br, 6);
+  }
+  uint32_t index = br_u(br, 4);
+  uint32_t sample_rate =
+      index == 15 ? br_u(br, 24) : index < 13 ? aac_sample_rates[index] : 0;
+  const uint32_t channel_config = br_u(br, 4);
+  const int sbr = object_type == 5 || object_type == 29;
+  if (sbr) {
+    index = br_u(br, 4);
+    sample_rate =
+        index == 15 ? br_u(br, 24) : index < 13 ? aac_sample_rates[index] : 0;
+  }
+  if (br->overrun || !sample_rate || channel_config == 0 ||
+      channel_config > 7) {
+    return 0;
+  }
+  if (!sbr && sample_rate <= 24000) {
+    /* possibly implicit SBR. */
+    return 0;
+  }
+  /* parametric stereo turns mono into stereo. */
+  params->channels = channel_config == 7 ? 8
+                     : object_type == 29 && channel_config == 1
+                         ? 2
+                         : (int)channel_config;
+  params->sample_rate = (int)sample_rate;
+  return 1;
+}
+
+/* ISO/IEC 14496-3 LOAS AudioSyncStream, with the StreamMuxConfig in some of
+ * the AudioMuxElements. */
+static int parse_latm(es_parser *p) {
+  for (size_t pos = 0; pos + 3 <= p->size; ++pos) {
+    const uint8_t *h = p->buf + pos;
+    if (h[0] != 0x56 || (h[1] & 0xe0) != 0xe0) {
+      continue;
+    }
+    const size_t size = ((size_t)(h[1] & 0x1f) << 8 | h[2]) + 3;
+    const size_t avail = p->size - pos < size ? p->size - pos : size;
+    bit_reader br;
+    br_init(&br, h + 3, avail - 3);
+    if (br_u(&br, 1)) { /* useSameStreamMux */
+      continue;
+    }
+    const uint32_t version = br_u(&br, 1);
+    if (version && br_u(&br, 1)) { /* audioMuxVersionA */
+      continue;
+    }
+    if (version) {
+      latm_get_value(&br); /* taraBufferFullness */
+    }
+    br_skip(&br, 1 + 6); /* allStreamsSameTimeFraming, numSubFrames */
+    if (br_u(&br, 4) != 0 || br_u(&br, 3) != 0) {
+      /* more than one program or layer. */
+      continue;
+    }
+    if (version) {
+      latm_get_value(&br); /* ascLen */
+    }
+    es_params params = p->params;
+    if (parse_audio_specific_config(&br, &params)) {
+      params.fmt = "aac_latm";
+      p->params = params;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int es_parser_parse(es_parser *p) {
+  switch (p->codec) {
+  case ES_CODEC_MPEG2_VIDEO:
+    return parse_mpeg2_video(p->buf, p->size, &p->params);
+  case ES_CODEC_H264:
+  case ES_CODEC_HEVC:
+    return parse_nal_video(p);
+  case ES_CODEC_MPEG_AUDIO:
+    return parse_audio_frames(p, mpa_header, 4);
+  case ES_CODEC_AC3:
+  case ES_CODEC_EAC3:
+    return parse_audio_frames(p, ac3_header, 8);
+  case ES_CODEC_AAC:
+    return parse_audio_frames(p, adts_header, 7) || parse_latm(p);
+  case ES_CODEC_AAC_LATM:
+    return parse_latm(p);
+  case ES_CODEC_DTS:
+    return parse_audio_frames(p, dts_header, 12);
+  }
+  return 0;
+}
+
+/* the gathered start of a PES packet is parsed when the next one starts, or
+ * once the buffer is full. */
+static int es_parser_end_pes(es_parser *p) {
+  p->state = es_parser_parse(p) ? ES_PARSE_DONE : ES_PARSE_IDLE;
+  p->size = 0;
+  return p->state == ES_PARSE_DONE;
+}
+
+int es_parser_push(es_parser *p, const uint8_t *packet) {
+  if (p->state == ES_PARSE_DONE) {
+    return 1;
+  }
+  const int adaptation_field_control = (packet[3] >> 4) & 0x03;
+  if (!(adaptation_field_control & 0x01) || (packet[3] & 0xc0)) {
+    /* no payload, or a scrambled one. */
+    return 0;
+  }
+  const uint8_t *pos = packet + 4;
+  const uint8_t *end = packet + TS_PACKET_SIZE;
+  if (adaptation_field_control & 0x02) {
+    if (packet[4] > TS_PACKET_SIZE - 5) {
+      return 0;
+    }
+    pos += 1 + packet[4];
+  }
+
+  if (packet[1] & 0x40) {
+    if (p->state == ES_PARSE_GATHER && es_parser_end_pes(p)) {
+      return 1;
+    }
+    if (end - pos < PES_HEADER_SIZE || pos[0] != 0 || pos[1] != 0 ||
+        pos[2] != 1 || end - pos < PES_HEADER_SIZE + pos[8]) {
+      p->state = ES_PARSE_IDLE;
+      return 0;
+    }
+    pos += PES_HEADER_SIZE + pos[8];
+    p->size = 0;
+    p->state = ES_PARSE_GATHER;
+  }
+  if (p->state != ES_PARSE_GATHER) {
+    return 0;
+  }
+  size_t copied = (size_t)(end - pos);
+  if (copied > ES_PARSER_BUF_SIZE - p->size) {
+    copied = ES_PARSER_BUF_SIZE - p->size;
+  }
+  memcpy(p->buf + p->size, pos, copied);
+  p->size += copied;
+  if (p->size == ES_PARSER_BUF_SIZE) {
+    return es_parser_end_pes(p);
+  }
+  return 0;
+}
@@ -0,0 +1,86 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#ifndef DVBINDEX_ESPARSE_H
+#define DVBINDEX_ESPARSE_H
+
+#include "vec.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum es_codec_ {
+  ES_CODEC_MPEG2_VIDEO,
+  ES_CODEC_H264,
+  ES_CODEC_HEVC,
+  ES_CODEC_MPEG_AUDIO,
+  ES_CODEC_AC3,
+  ES_CODEC_EAC3,
+  /* ADTS, or LATM when the PMT doesn't tell. */
+  ES_CODEC_AAC,
+  ES_CODEC_AAC_LATM,
+  ES_CODEC_DTS
+} es_codec;
+
+/* the parameters of an audio or video ES, meaning the same as the ones found
+ * by ffmpeg. the values which are not known are 0. */
+typedef struct es_params_ {
+  /* the name of the ffmpeg codec. */
+  const char *fmt;
+  double fps;
+  int64_t bitrate;
+  int width;
+  int height;
+  int channels;
+  int sample_rate;
+} es_params;
+
+#define ES_PARSER_BUF_SIZE 4096
+
+/* gathers the start of each PES packet of an ES, until the headers found there
+ * give all the parameters. */
+typedef struct es_parser_ {
+  es_params params;
+  size_t size;
+  uint16_t pid;
+  uint8_t codec;
+  uint8_t state;
+  /* set by the caller once the ES is known to be scrambled. */
+  uint8_t scrambled;
+  uint8_t buf[ES_PARSER_BUF_SIZE];
+} es_parser;
+VEC_DEFINE(es_parser)
+
+/* dvb_audio_tag is the tag of the AC-3, E-AC-3, DTS or AAC descriptor of an ES
+ * of PES private data, 0 if there's none. returns -1 if the ES is not one the
+ * parsers know. */
+int es_codec_from_stream_type(uint8_t stream_type, uint8_t dvb_audio_tag);
+int es_codec_is_audio(es_codec codec);
+/* the name of the ffmpeg codec of the stream type, for the ES whose headers
+ * can't be read. */
+const char *es_codec_fmt(es_codec codec);
+/* returns 1 for the stream types which never carry audio or video. */
+int es_stream_type_is_data(uint8_t stream_type);
+void es_parser_init(es_parser *p, uint16_t pid, es_codec codec);
+/* returns 1 once the parameters are known. */
+int es_parser_push(es_parser *p, const uint8_t *packet);
+int es_parser_done(const es_parser *p);
+/* done, or scrambled : nothing more can be found either way. */
+int es_parser_resolved(const es_parser *p);
+
+#endif
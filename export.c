@@ -29,26 +29,38 @@ Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <dvbpsi/descriptor.h>
 
 #include <dvbpsi/dvbpsi.h>
+#include <dvbpsi/bat.h>
+#include <dvbpsi/cat.h>
 #include <dvbpsi/nit.h>
 #include <dvbpsi/pat.h>
 #include <dvbpsi/pmt.h>
 #include <dvbpsi/sdt.h>
 
+#include <dvbpsi/dr_09.h>
 #include <dvbpsi/dr_0a.h>
 #include <dvbpsi/dr_40.h>
 #include <dvbpsi/dr_41.h>
+#include <dvbpsi/dr_47.h>
 #include <dvbpsi/dr_48.h>
 #include <dvbpsi/dr_56.h>
 #include <dvbpsi/dr_59.h>
 
+#include "ait.h"
+#include "archive.h"
 #include "column_ids.h"
 #include "dvbstring.h"
+#include "esparse.h"
+#include "pidstats.h"
+#include "rap.h"
+#include "scte35.h"
+#include "si.h"
+#include "tr101290.h"
 #include "tables.h"
 
 #define DVBINDEX_SQLITE_APPLICATION_ID 0x12F834B
 
 /* increment this whenever the schema changes */
-#define DVBINDEX_USER_VERSION 5
+#define DVBINDEX_USER_VERSION 21
 
 static void start_transaction(sqlite3 *db) {
   int rc = sqlite3_exec(db, "BEGIN TRANSACTION", 0, 0, 0);
@@ -127,6 +139,24 @@ static int create_table(sqlite3 *db, const dvbindex_table_def *table,
   return sqlite3_exec(db, buf, 0, 0, error);
 }
 
+static int create_indices(sqlite3 *db, const dvbindex_table_def *table,
+                          char **error) {
+  int rv = SQLITE_OK;
+  for (size_t i = 0; i < table->num_columns && rv == SQLITE_OK; ++i) {
+    const dvbindex_table_column_def *c = &table->columns[i];
+    if (!c->indexed) {
+      continue;
+    }
+    char *sql =
+        sqlite3_mprintf("CREATE INDEX IF NOT EXISTS %s_%s ON %s (%s)",
+                        table->name, c->name, table->name, c->name);
+    assert(sql);
+    rv = sqlite3_exec(db, sql, 0, 0, error);
+    sqlite3_free(sql);
+  }
+  return rv;
+}
+
 static int create_insert_statement(sqlite3 *db, sqlite3_stmt **stmt,
                                    const dvbindex_table_def *table) {
   assert(stmt);
@@ -196,7 +226,10 @@ static void drop_table(sqlite3 *db, const dvbindex_table_def *table) {
 
 static void drop_tables(sqlite3 *db) {
   for (dvbindex_table i = 0; i < DVBINDEX_TABLE__LAST; ++i) {
-    drop_table(db, table_get_def(i));
+    const dvbindex_table_def *def = table_get_def(i);
+    if (!def->archive) {
+      drop_table(db, def);
+    }
   }
 }
 
@@ -206,6 +239,40 @@ static void setup_file_select_stmt(sqlite3 *db, sqlite3_stmt **stmt) {
   assert(rv == SQLITE_OK);
 }
 
+static void setup_archive_select_stmts(sqlite3 *db, db_export *exp) {
+  const char file_sql[] =
+      "SELECT rowid FROM archived_files WHERE name = ? AND size = ?";
+  int rv = sqlite3_prepare_v2(db, file_sql, sizeof(file_sql),
+                              &exp->archived_file_select, 0);
+  assert(rv == SQLITE_OK);
+  const char sections_sql[] =
+      "SELECT pid, first_byte_offset, size, data FROM sections "
+      "WHERE archived_file_rowid = ? ORDER BY first_byte_offset, rowid";
+  rv = sqlite3_prepare_v2(db, sections_sql, sizeof(sections_sql),
+                          &exp->archived_sections_select, 0);
+  assert(rv == SQLITE_OK);
+}
+
+static void setup_probe_update_stmt(sqlite3 *db, sqlite3_stmt **stmt) {
+  const char sql[] = "UPDATE files SET probe_profile = ? WHERE rowid = ?";
+  int rv = sqlite3_prepare_v2(db, sql, sizeof(sql), stmt, 0);
+  assert(rv == SQLITE_OK);
+}
+
+static void setup_timing_update_stmts(sqlite3 *db, db_export *exp) {
+  const char file_sql[] =
+      "UPDATE files SET duration = ?, bitrate = ? WHERE rowid = ?";
+  int rv = sqlite3_prepare_v2(db, file_sql, sizeof(file_sql),
+                              &exp->file_timing_update, 0);
+  assert(rv == SQLITE_OK);
+  const char pmt_sql[] =
+      "UPDATE pmts SET duration = ?, pcr_discontinuities = ? WHERE pcr_pid = ? "
+      "AND pat_rowid IN (SELECT rowid FROM pats WHERE file_rowid = ?)";
+  rv = sqlite3_prepare_v2(db, pmt_sql, sizeof(pmt_sql),
+                          &exp->pmt_timing_update, 0);
+  assert(rv == SQLITE_OK);
+}
+
 int db_export_init(db_export *exp, const char *filename, char **error) {
   int rv = sqlite3_open_v2(filename, &exp->db,
                            SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE |
@@ -229,6 +296,10 @@ int db_export_init(db_export *exp, const char *filename, char **error) {
     if (rv != SQLITE_OK) {
       goto beach;
     }
+    rv = create_indices(exp->db, table_get_def(i), error);
+    if (rv != SQLITE_OK) {
+      goto beach;
+    }
     rv = create_insert_statement(exp->db, &exp->insert_stmts[i],
                                  table_get_def(i));
     if (rv != SQLITE_OK) {
@@ -237,6 +308,9 @@ int db_export_init(db_export *exp, const char *filename, char **error) {
   }
 
   setup_file_select_stmt(exp->db, &exp->file_select);
+  setup_timing_update_stmts(exp->db, exp);
+  setup_archive_select_stmts(exp->db, exp);
+  setup_probe_update_stmt(exp->db, &exp->file_probe_update);
   return SQLITE_OK;
 
 beach:
@@ -249,9 +323,192 @@ void db_export_close(db_export *exp) {
     sqlite3_finalize(exp->insert_stmts[i]);
   }
   sqlite3_finalize(exp->file_select);
+  sqlite3_finalize(exp->file_timing_update);
+  sqlite3_finalize(exp->pmt_timing_update);
+  sqlite3_finalize(exp->file_probe_update);
+  sqlite3_finalize(exp->archived_file_select);
+  sqlite3_finalize(exp->archived_sections_select);
   sqlite3_close_v2(exp->db);
 }
 
+void db_export_clear(db_export *exp) {
+  for (dvbindex_table i = 0; i < DVBINDEX_TABLE__LAST; ++i) {
+    char *sql = sqlite3_mprintf("DELETE FROM %s", table_get_def(i)->name);
+    assert(sql);
+    int rv = sqlite3_exec(exp->db, sql, 0, 0, 0);
+    assert(rv == SQLITE_OK);
+    sqlite3_free(sql);
+  }
+  /* the freed pages would otherwise be part of every later image. */
+  int rv = sqlite3_exec(exp->db, "VACUUM", 0, 0, 0);
+  assert(rv == SQLITE_OK);
+}
+
+void *db_export_image(db_export *exp, sqlite3_int64 *size) {
+#if DB_EXPORT_HAS_IMAGES
+  return sqlite3_serialize(exp->db, "main", size, 0);
+#else
+  (void)exp;
+  *size = 0;
+  return 0;
+#endif
+}
+
+int db_export_attach(db_export *exp, const char *filename, const char *schema) {
+  sqlite3_stmt *stmt;
+  int rv = sqlite3_prepare_v2(exp->db, "ATTACH ? AS ?", -1, &stmt, 0);
+  if (rv != SQLITE_OK) {
+    return rv;
+  }
+  sqlite3_bind_text(stmt, 1, filename, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 2, schema, -1, SQLITE_STATIC);
+  rv = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+  return rv == SQLITE_DONE ? SQLITE_OK : rv;
+}
+
+int db_export_detach(db_export *exp, const char *schema) {
+  char *sql = sqlite3_mprintf("DETACH %s", schema);
+  assert(sql);
+  int rv = sqlite3_exec(exp->db, sql, 0, 0, 0);
+  sqlite3_free(sql);
+  return rv;
+}
+
+int db_export_attached_is_current(db_export *exp, const char *schema) {
+  char *appid = sqlite3_mprintf("%s.application_id", schema);
+  char *version = sqlite3_mprintf("%s.user_version", schema);
+  assert(appid && version);
+  const int rv =
+      get_pragma_id(exp->db, appid) == DVBINDEX_SQLITE_APPLICATION_ID &&
+      get_pragma_id(exp->db, version) == DVBINDEX_USER_VERSION;
+  sqlite3_free(version);
+  sqlite3_free(appid);
+  return rv;
+}
+
+static int attached_shares_rows(sqlite3 *db, const char *schema,
+                                const char *table) {
+  char *sql = sqlite3_mprintf("SELECT 1 FROM %s.%s AS a JOIN main.%s AS m "
+                              "ON a.name = m.name AND a.size = m.size LIMIT 1",
+                              schema, table, table);
+  assert(sql);
+  sqlite3_stmt *stmt;
+  int rv = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+  sqlite3_free(sql);
+  if (rv != SQLITE_OK) {
+    return 1;
+  }
+  rv = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+  return rv != SQLITE_DONE;
+}
+
+int db_export_attached_overlaps(db_export *exp, const char *schema) {
+  return attached_shares_rows(exp->db, schema, "files") ||
+         attached_shares_rows(exp->db, schema, "archived_files");
+}
+
+int db_export_load_image(db_export *exp, const char *schema, void *image,
+                         sqlite3_int64 size) {
+#if DB_EXPORT_HAS_IMAGES
+  return sqlite3_deserialize(exp->db, schema, image, size, size,
+                             SQLITE_DESERIALIZE_FREEONCLOSE |
+                                 SQLITE_DESERIALIZE_RESIZEABLE);
+#else
+  (void)exp;
+  (void)schema;
+  (void)size;
+  sqlite3_free(image);
+  return SQLITE_ERROR;
+#endif
+}
+
+static sqlite3_int64 max_rowid(sqlite3 *db, const char *table) {
+  char *sql = sqlite3_mprintf("SELECT ifnull(max(rowid), 0) FROM main.%s",
+                              table);
+  assert(sql);
+  sqlite3_stmt *stmt;
+  sqlite3_int64 rowid = 0;
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+      rowid = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+  }
+  sqlite3_free(sql);
+  return rowid;
+}
+
+/* the rowids of the table are moved by the parameter named after it, and so
+ * are the columns referencing another table. */
+static int merge_table(sqlite3 *db, const char *schema,
+                       const dvbindex_table_def *table,
+                       const sqlite3_int64 *offsets) {
+  char columns[2048];
+  char values[2048];
+  int columns_len = 0;
+  int values_len = 0;
+  for (size_t i = 0; i < table->num_columns; ++i) {
+    const dvbindex_table_column_def *c = &table->columns[i];
+    columns_len += snprintf(columns + columns_len,
+                            sizeof(columns) - columns_len, ",%s", c->name);
+    if (c->references) {
+      values_len +=
+          snprintf(values + values_len, sizeof(values) - values_len,
+                   ",%s + :%s", c->name, c->references);
+    } else {
+      values_len += snprintf(values + values_len, sizeof(values) - values_len,
+                             ",%s", c->name);
+    }
+    assert(columns_len < (int)sizeof(columns) &&
+           values_len < (int)sizeof(values));
+  }
+  char *sql = sqlite3_mprintf(
+      "INSERT INTO main.%s (rowid%s) SELECT rowid + :%s%s FROM %s.%s",
+      table->name, columns, table->name, values, schema, table->name);
+  assert(sql);
+  sqlite3_stmt *stmt;
+  int rv = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+  sqlite3_free(sql);
+  if (rv != SQLITE_OK) {
+    return rv;
+  }
+  for (dvbindex_table i = 0; i < DVBINDEX_TABLE__LAST; ++i) {
+    char name[64];
+    snprintf(name, sizeof(name), ":%s", table_get_def(i)->name);
+    const int pos = sqlite3_bind_parameter_index(stmt, name);
+    if (pos > 0) {
+      sqlite3_bind_int64(stmt, pos, offsets[i]);
+    }
+  }
+  rv = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+  return rv == SQLITE_DONE ? SQLITE_OK : rv;
+}
+
+int db_export_merge(db_export *exp, const char *const *schemas,
+                    size_t count) {
+  int rv = SQLITE_OK;
+  start_transaction(exp->db);
+  for (size_t i = 0; i < count && rv == SQLITE_OK; ++i) {
+    sqlite3_int64 offsets[DVBINDEX_TABLE__LAST];
+    for (dvbindex_table t = 0; t < DVBINDEX_TABLE__LAST; ++t) {
+      offsets[t] = max_rowid(exp->db, table_get_def(t)->name);
+    }
+    for (dvbindex_table t = 0; t < DVBINDEX_TABLE__LAST && rv == SQLITE_OK;
+         ++t) {
+      rv = merge_table(exp->db, schemas[i], table_get_def(t), offsets);
+    }
+  }
+  if (rv == SQLITE_OK) {
+    end_transaction(exp->db);
+  } else {
+    sqlite3_exec(exp->db, "ROLLBACK TRANSACTION", 0, 0, 0);
+  }
+  return rv;
+}
+
 static void codec_name_to_sql(sqlite3_stmt *stmt, int pos,
                               enum AVCodecID codec_id) {
   const AVCodecDescriptor *cd = avcodec_descriptor_get(codec_id);
@@ -270,8 +527,16 @@ static void bind_ffmpeg_int(sqlite3_stmt *stmt, int pos, int64_t val) {
   }
 }
 
+static void bind_nullable_int64(sqlite3_stmt *stmt, int pos, int64_t val) {
+  if (val >= 0) {
+    sqlite3_bind_int64(stmt, pos, val);
+  } else {
+    sqlite3_bind_null(stmt, pos);
+  }
+}
+
 static void export_video_stream(sqlite3_stmt *stmt, sqlite3_int64 file_rowid,
-                                const AVStream *stream) {
+                                const AVStream *stream, int scrambled) {
   sqlite3_reset(stmt);
   sqlite3_bind_int64(stmt, VID_STREAM_COLUMN_FILE_ROWID, file_rowid);
   sqlite3_bind_int(stmt, VID_STREAM_COLUMN_PID, stream->id);
@@ -282,11 +547,12 @@ static void export_video_stream(sqlite3_stmt *stmt, sqlite3_int64 file_rowid,
                       stream->avg_frame_rate.num /
                           (double)stream->avg_frame_rate.den);
   bind_ffmpeg_int(stmt, VID_STREAM_COLUMN_BITRATE, stream->codecpar->bit_rate);
+  sqlite3_bind_int(stmt, VID_STREAM_COLUMN_SCRAMBLED, scrambled);
   sqlite3_step(stmt);
 }
 
 static void export_audio_stream(sqlite3_stmt *stmt, sqlite3_int64 file_rowid,
-                                const AVStream *stream) {
+                                const AVStream *stream, int scrambled) {
   sqlite3_reset(stmt);
   sqlite3_bind_int64(stmt, AUD_STREAM_COLUMN_FILE_ROWID, file_rowid);
   sqlite3_bind_int(stmt, AUD_STREAM_COLUMN_PID, stream->id);
@@ -295,22 +561,24 @@ static void export_audio_stream(sqlite3_stmt *stmt, sqlite3_int64 file_rowid,
   bind_ffmpeg_int(stmt, AUD_STREAM_COLUMN_SAMPLE_RATE,
                   stream->codecpar->sample_rate);
   bind_ffmpeg_int(stmt, AUD_STREAM_COLUMN_BITRATE, stream->codecpar->bit_rate);
+  sqlite3_bind_int(stmt, AUD_STREAM_COLUMN_SCRAMBLED, scrambled);
   sqlite3_step(stmt);
 }
 
 void db_export_av_streams(db_export *exp, sqlite3_int64 file_rowid,
-                          unsigned int num_streams, AVStream *const *streams) {
+                          unsigned int num_streams, AVStream *const *streams,
+                          const uint8_t *scrambled) {
   start_transaction(exp->db);
   for (unsigned int i = 0; i < num_streams; ++i) {
     const AVStream *s = streams[i];
     switch (s->codecpar->codec_type) {
     case AVMEDIA_TYPE_VIDEO:
       export_video_stream(exp->insert_stmts[DVBINDEX_TABLE_VID_STREAMS],
-                          file_rowid, s);
+                          file_rowid, s, scrambled[i]);
       break;
     case AVMEDIA_TYPE_AUDIO:
       export_audio_stream(exp->insert_stmts[DVBINDEX_TABLE_AUD_STREAMS],
-                          file_rowid, s);
+                          file_rowid, s, scrambled[i]);
       break;
     default:
       break;
@@ -319,13 +587,131 @@ void db_export_av_streams(db_export *exp, sqlite3_int64 file_rowid,
   end_transaction(exp->db);
 }
 
-static void export_iso639_descriptor(sqlite3_stmt *stmt,
-                                     dvbpsi_descriptor_t *dr,
-                                     sqlite3_int64 es_rowid) {
+/* the headers of a scrambled ES can't be read, and only its codec is known. */
+static const char *es_parser_fmt(const es_parser *p) {
+  return es_parser_done(p) ? p->params.fmt : es_codec_fmt((es_codec)p->codec);
+}
+
+static void export_es_video_stream(sqlite3_stmt *stmt,
+                                   sqlite3_int64 file_rowid,
+                                   const es_parser *p) {
+  sqlite3_reset(stmt);
+  sqlite3_bind_int64(stmt, VID_STREAM_COLUMN_FILE_ROWID, file_rowid);
+  sqlite3_bind_int(stmt, VID_STREAM_COLUMN_PID, p->pid);
+  sqlite3_bind_text(stmt, VID_STREAM_COLUMN_FMT, es_parser_fmt(p), -1,
+                    SQLITE_STATIC);
+  bind_ffmpeg_int(stmt, VID_STREAM_COLUMN_WIDTH, p->params.width);
+  bind_ffmpeg_int(stmt, VID_STREAM_COLUMN_HEIGHT, p->params.height);
+  if (p->params.fps > 0) {
+    sqlite3_bind_double(stmt, VID_STREAM_COLUMN_FPS, p->params.fps);
+  } else {
+    sqlite3_bind_null(stmt, VID_STREAM_COLUMN_FPS);
+  }
+  bind_ffmpeg_int(stmt, VID_STREAM_COLUMN_BITRATE, p->params.bitrate);
+  sqlite3_bind_int(stmt, VID_STREAM_COLUMN_SCRAMBLED, p->scrambled);
+  sqlite3_step(stmt);
+}
+
+static void export_es_audio_stream(sqlite3_stmt *stmt,
+                                   sqlite3_int64 file_rowid,
+                                   const es_parser *p) {
+  sqlite3_reset(stmt);
+  sqlite3_bind_int64(stmt, AUD_STREAM_COLUMN_FILE_ROWID, file_rowid);
+  sqlite3_bind_int(stmt, AUD_STREAM_COLUMN_PID, p->pid);
+  sqlite3_bind_text(stmt, AUD_STREAM_COLUMN_FMT, es_parser_fmt(p), -1,
+                    SQLITE_STATIC);
+  bind_ffmpeg_int(stmt, AUD_STREAM_COLUMN_CHANNELS, p->params.channels);
+  bind_ffmpeg_int(stmt, AUD_STREAM_COLUMN_SAMPLE_RATE, p->params.sample_rate);
+  bind_ffmpeg_int(stmt, AUD_STREAM_COLUMN_BITRATE, p->params.bitrate);
+  sqlite3_bind_int(stmt, AUD_STREAM_COLUMN_SCRAMBLED, p->scrambled);
+  sqlite3_step(stmt);
+}
+
+void db_export_es_streams(db_export *exp, sqlite3_int64 file_rowid,
+                          const es_parser *parsers, size_t count) {
+  start_transaction(exp->db);
+  for (size_t i = 0; i < count; ++i) {
+    const es_parser *p = parsers + i;
+    if (!es_parser_resolved(p)) {
+      continue;
+    }
+    if (es_codec_is_audio((es_codec)p->codec)) {
+      export_es_audio_stream(exp->insert_stmts[DVBINDEX_TABLE_AUD_STREAMS],
+                             file_rowid, p);
+    } else {
+      export_es_video_stream(exp->insert_stmts[DVBINDEX_TABLE_VID_STREAMS],
+                             file_rowid, p);
+    }
+  }
+  end_transaction(exp->db);
+}
+
+/* descriptor loops are walked once, looking up the handler of each tag in
+ * the table of the loop's context. handlers bind the values they decode
+ * straight to the prepared statements. */
+typedef struct dr_target_ {
+  db_export *exp;
+  /* the statement of the row owning the loop, which is stepped after the
+   * walk. 0 when the row was already inserted. */
+  sqlite3_stmt *owner_stmt;
+  /* rowids which don't apply are negative. */
+  sqlite3_int64 file_rowid;
+  sqlite3_int64 cat_rowid;
+  sqlite3_int64 pmt_rowid;
+  sqlite3_int64 es_rowid;
+  /* the transport stream row of the NIT and BAT loops. */
+  sqlite3_int64 ts_rowid;
+} dr_target;
+
+typedef void (*dr_handler)(const dr_target *t, dvbpsi_descriptor_t *dr);
+
+static void export_descriptors(const dr_handler *handlers, const dr_target *t,
+                               dvbpsi_descriptor_t *dr) {
+  for (; dr; dr = dr->p_next) {
+    const dr_handler h = handlers[dr->i_tag];
+    if (h) {
+      h(t, dr);
+    }
+  }
+}
+
+static void dr_target_init(dr_target *t, db_export *exp,
+                           sqlite3_stmt *owner_stmt,
+                           sqlite3_int64 file_rowid) {
+  t->exp = exp;
+  t->owner_stmt = owner_stmt;
+  t->file_rowid = file_rowid;
+  t->cat_rowid = -1;
+  t->pmt_rowid = -1;
+  t->es_rowid = -1;
+  t->ts_rowid = -1;
+}
+
+static void handle_ca_dr(const dr_target *t, dvbpsi_descriptor_t *dr) {
+  dvbpsi_ca_dr_t *ca_dr = dvbpsi_DecodeCADr(dr);
+  if (!ca_dr) {
+    return;
+  }
+  sqlite3_stmt *stmt = t->exp->insert_stmts[DVBINDEX_TABLE_CA_SYSTEMS];
+  sqlite3_reset(stmt);
+  sqlite3_bind_int64(stmt, CA_SYSTEM_COLUMN_FILE_ROWID, t->file_rowid);
+  bind_nullable_int64(stmt, CA_SYSTEM_COLUMN_CAT_ROWID, t->cat_rowid);
+  bind_nullable_int64(stmt, CA_SYSTEM_COLUMN_PMT_ROWID, t->pmt_rowid);
+  bind_nullable_int64(stmt, CA_SYSTEM_COLUMN_ELEM_STREAM_ROWID, t->es_rowid);
+  sqlite3_bind_int(stmt, CA_SYSTEM_COLUMN_CA_SYSTEM_ID, ca_dr->i_ca_system_id);
+  sqlite3_bind_int(stmt, CA_SYSTEM_COLUMN_CA_PID, ca_dr->i_ca_pid);
+  sqlite3_step(stmt);
+}
+
+static void handle_iso639_dr(const dr_target *t, dvbpsi_descriptor_t *dr) {
   dvbpsi_iso639_dr_t *iso639_dr = dvbpsi_DecodeISO639Dr(dr);
+  if (!iso639_dr) {
+    return;
+  }
+  sqlite3_stmt *stmt = t->exp->insert_stmts[DVBINDEX_TABLE_LANG_SPECS];
   for (uint8_t i = 0; i < iso639_dr->i_code_count; ++i) {
     sqlite3_reset(stmt);
-    sqlite3_bind_int64(stmt, LANG_SPEC_COLUMN_ELEM_STREAM_ROWID, es_rowid);
+    sqlite3_bind_int64(stmt, LANG_SPEC_COLUMN_ELEM_STREAM_ROWID, t->es_rowid);
     const char *code = (const char *)iso639_dr->code[i].iso_639_code;
     sqlite3_bind_text(stmt, LANG_SPEC_COLUMN_LANGUAGE, code,
                       sizeof(iso639_dr->code[i].iso_639_code),
@@ -336,14 +722,18 @@ static void export_iso639_descriptor(sqlite3_stmt *stmt,
   }
 }
 
-static void export_teletext_descriptor(sqlite3_stmt *stmt,
-                                       dvbpsi_descriptor_t *dr,
-                                       sqlite3_int64 es_rowid) {
+/* descriptors 46h and 56h have exactly the same structure, as documented in
+ * EN 300 468 V1.15.1. */
+static void handle_teletext_dr(const dr_target *t, dvbpsi_descriptor_t *dr) {
   dvbpsi_teletext_dr_t *teletext = dvbpsi_DecodeTeletextDr(dr);
+  if (!teletext) {
+    return;
+  }
+  sqlite3_stmt *stmt = t->exp->insert_stmts[DVBINDEX_TABLE_TTX_PAGES];
   for (uint8_t i = 0; i < teletext->i_pages_number; ++i) {
     dvbpsi_teletextpage_t *page = teletext->p_pages + i;
     sqlite3_reset(stmt);
-    sqlite3_bind_int64(stmt, TTX_PAGE_COLUMN_ELEM_STREAM_ROWID, es_rowid);
+    sqlite3_bind_int64(stmt, TTX_PAGE_COLUMN_ELEM_STREAM_ROWID, t->es_rowid);
     const char *code = (const char *)page->i_iso6392_language_code;
     sqlite3_bind_text(stmt, TTX_PAGE_COLUMN_LANGUAGE, code,
                       sizeof(page->i_iso6392_language_code), SQLITE_TRANSIENT);
@@ -357,15 +747,17 @@ static void export_teletext_descriptor(sqlite3_stmt *stmt,
   }
 }
 
-static void export_subtitle_descriptor(sqlite3_stmt *stmt,
-                                       dvbpsi_descriptor_t *dr,
-                                       sqlite3_int64 es_rowid) {
+static void handle_subtitling_dr(const dr_target *t, dvbpsi_descriptor_t *dr) {
   dvbpsi_subtitling_dr_t *subtitling = dvbpsi_DecodeSubtitlingDr(dr);
+  if (!subtitling) {
+    return;
+  }
+  sqlite3_stmt *stmt = t->exp->insert_stmts[DVBINDEX_TABLE_SUBTITLE_CONTENTS];
   for (uint8_t i = 0; i < subtitling->i_subtitles_number; ++i) {
     dvbpsi_subtitle_t *subtitle = subtitling->p_subtitle + i;
     sqlite3_reset(stmt);
     sqlite3_bind_int64(stmt, SUBTITLE_CONTENT_COLUMN_ELEM_STREAM_ROWID,
-                       es_rowid);
+                       t->es_rowid);
     const char *code = (const char *)subtitle->i_iso6392_language_code;
     sqlite3_bind_text(stmt, SUBTITLE_CONTENT_COLUMN_LANGUAGE, code,
                       sizeof(subtitle->i_iso6392_language_code),
@@ -380,35 +772,138 @@ static void export_subtitle_descriptor(sqlite3_stmt *stmt,
   }
 }
 
-static void export_pmt_es_descriptors(db_export *exp, sqlite3_int64 es_rowid,
-                                      dvbpsi_descriptor_t *dr) {
-  while (dr) {
-    switch (dr->i_tag) {
-    case 0x0a:
-      export_iso639_descriptor(exp->insert_stmts[DVBINDEX_TABLE_LANG_SPECS], dr,
-                               es_rowid);
-      break;
+/* the carousel descriptors are only bound when the ES is a carousel, in
+ * which case its carousels row is the owner of the loop. */
+static void handle_carousel_identifier_dr(const dr_target *t,
+                                          dvbpsi_descriptor_t *dr) {
+  const uint8_t *p = dr->p_data;
+  if (t->owner_stmt && dr->i_length >= 4) {
+    sqlite3_bind_int64(t->owner_stmt, CAROUSEL_COLUMN_CAROUSEL_ID,
+                       ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) |
+                           p[3]);
+  }
+}
 
-    /* descriptors 46h and 56h have exactly the same structure, as documented
-     * in EN 300 468 V1.15.1. */
-    case 0x46:
-    case 0x56:
-      export_teletext_descriptor(exp->insert_stmts[DVBINDEX_TABLE_TTX_PAGES],
-                                 dr, es_rowid);
-      break;
+static void handle_data_broadcast_id_dr(const dr_target *t,
+                                        dvbpsi_descriptor_t *dr) {
+  const uint8_t *p = dr->p_data;
+  if (t->owner_stmt && dr->i_length >= 2) {
+    sqlite3_bind_int(t->owner_stmt, CAROUSEL_COLUMN_DATA_BROADCAST_ID,
+                     (p[0] << 8) | p[1]);
+  }
+}
 
-    case 0x59:
-      export_subtitle_descriptor(
-          exp->insert_stmts[DVBINDEX_TABLE_SUBTITLE_CONTENTS], dr, es_rowid);
-      break;
-    }
+static void handle_service_dr(const dr_target *t, dvbpsi_descriptor_t *dr) {
+  dvbpsi_service_dr_t *service_dr = dvbpsi_DecodeServiceDr(dr);
+  if (!service_dr) {
+    return;
+  }
+  size_t outlen;
+  char *str = dvbstring_to_utf8(service_dr->i_service_name,
+                                service_dr->i_service_name_length, &outlen);
+  sqlite3_bind_text64(t->owner_stmt, SERVICE_COLUMN_NAME, str, outlen, free,
+                      SQLITE_UTF8);
+  str = dvbstring_to_utf8(service_dr->i_service_provider_name,
+                          service_dr->i_service_provider_name_length, &outlen);
+  sqlite3_bind_text64(t->owner_stmt, SERVICE_COLUMN_PROVIDER_NAME, str, outlen,
+                      free, SQLITE_UTF8);
+}
 
-    dr = dr->p_next;
+static void handle_network_name_dr(const dr_target *t,
+                                   dvbpsi_descriptor_t *dr) {
+  dvbpsi_network_name_dr_t *netname = dvbpsi_DecodeNetworkNameDr(dr);
+  if (!netname) {
+    return;
   }
+  size_t outlen;
+  char *utf8 = dvbstring_to_utf8(netname->i_name_byte, netname->i_name_length,
+                                 &outlen);
+  sqlite3_bind_text(t->owner_stmt, NETWORK_COLUMN_NETWORK_NAME, utf8, outlen,
+                    free);
+}
+
+static void handle_bouquet_name_dr(const dr_target *t,
+                                   dvbpsi_descriptor_t *dr) {
+  dvbpsi_bouquet_name_dr_t *name = dvbpsi_DecodeBouquetNameDr(dr);
+  if (!name) {
+    return;
+  }
+  size_t outlen;
+  char *utf8 = dvbstring_to_utf8(name->i_char, name->i_name_length, &outlen);
+  sqlite3_bind_text(t->owner_stmt, BOUQUET_COLUMN_BOUQUET_NAME, utf8, outlen,
+                    free);
+}
+
+/* the service list descriptor has the same meaning in NITs and BATs. */
+static void export_service_list(sqlite3_stmt *stmt, int ts_rowid_col,
+                                int service_id_col, int service_type_col,
+                                sqlite3_int64 ts_rowid,
+                                dvbpsi_descriptor_t *dr) {
+  dvbpsi_service_list_dr_t *slist = dvbpsi_DecodeServiceListDr(dr);
+  if (!slist) {
+    return;
+  }
+  for (unsigned int i = 0; i < slist->i_service_count; ++i) {
+    sqlite3_reset(stmt);
+    sqlite3_bind_int64(stmt, ts_rowid_col, ts_rowid);
+    sqlite3_bind_int(stmt, service_id_col, slist->i_service[i].i_service_id);
+    sqlite3_bind_int(stmt, service_type_col,
+                     slist->i_service[i].i_service_type);
+    sqlite3_step(stmt);
+  }
+}
+
+static void handle_nit_service_list_dr(const dr_target *t,
+                                       dvbpsi_descriptor_t *dr) {
+  export_service_list(t->exp->insert_stmts[DVBINDEX_TABLE_TS_SERVICES],
+                      TS_SERVICE_COLUMN_TS_ROWID, TS_SERVICE_COLUMN_SERVICE_ID,
+                      TS_SERVICE_COLUMN_SERVICE_TYPE, t->ts_rowid, dr);
+}
+
+static void handle_bat_service_list_dr(const dr_target *t,
+                                       dvbpsi_descriptor_t *dr) {
+  export_service_list(t->exp->insert_stmts[DVBINDEX_TABLE_BOUQUET_SERVICES],
+                      BOUQUET_SERVICE_COLUMN_BOUQUET_TS_ROWID,
+                      BOUQUET_SERVICE_COLUMN_SERVICE_ID,
+                      BOUQUET_SERVICE_COLUMN_SERVICE_TYPE, t->ts_rowid, dr);
+}
+
+#define DR_HANDLERS_SIZE 256
+
+static const dr_handler ca_handlers[DR_HANDLERS_SIZE] = {
+    [0x09] = handle_ca_dr};
+
+static const dr_handler pmt_es_handlers[DR_HANDLERS_SIZE] = {
+    [0x09] = handle_ca_dr,
+    [0x0a] = handle_iso639_dr,
+    [0x13] = handle_carousel_identifier_dr,
+    [0x46] = handle_teletext_dr,
+    [0x56] = handle_teletext_dr,
+    [0x59] = handle_subtitling_dr,
+    [0x66] = handle_data_broadcast_id_dr};
+
+static const dr_handler service_handlers[DR_HANDLERS_SIZE] = {
+    [0x48] = handle_service_dr};
+
+static const dr_handler network_handlers[DR_HANDLERS_SIZE] = {
+    [0x40] = handle_network_name_dr};
+
+static const dr_handler network_ts_handlers[DR_HANDLERS_SIZE] = {
+    [0x41] = handle_nit_service_list_dr};
+
+static const dr_handler bouquet_handlers[DR_HANDLERS_SIZE] = {
+    [0x47] = handle_bouquet_name_dr};
+
+static const dr_handler bouquet_ts_handlers[DR_HANDLERS_SIZE] = {
+    [0x41] = handle_bat_service_list_dr};
+
+static int es_is_dsmcc_carousel(uint8_t stream_type) {
+  /* ISO 13818-6 types B, C and D. */
+  return stream_type >= 0x0b && stream_type <= 0x0d;
 }
 
-static void export_pmt_es(db_export *exp, sqlite3_int64 pmt_rowid,
-                          const dvbpsi_pmt_es_t *es) {
+static void export_pmt_es(db_export *exp, sqlite3_int64 file_rowid,
+                          sqlite3_int64 pmt_rowid, const dvbpsi_pmt_es_t *es) {
   sqlite3_stmt *stmt = exp->insert_stmts[DVBINDEX_TABLE_ELEM_STREAMS];
   sqlite3_reset(stmt);
   sqlite3_bind_int64(stmt, ELEM_STREAM_COLUMN_PMT_ROWID, pmt_rowid);
@@ -416,7 +911,26 @@ static void export_pmt_es(db_export *exp, sqlite3_int64 pmt_rowid,
   sqlite3_bind_int(stmt, ELEM_STREAM_COLUMN_PID, es->i_pid);
   sqlite3_step(stmt);
   sqlite3_int64 es_rowid = sqlite3_last_insert_rowid(exp->db);
-  export_pmt_es_descriptors(exp, es_rowid, es->p_first_descriptor);
+
+  sqlite3_stmt *carousel_stmt = 0;
+  if (es_is_dsmcc_carousel(es->i_type)) {
+    carousel_stmt = exp->insert_stmts[DVBINDEX_TABLE_CAROUSELS];
+    sqlite3_reset(carousel_stmt);
+    sqlite3_bind_int64(carousel_stmt, CAROUSEL_COLUMN_FILE_ROWID, file_rowid);
+    sqlite3_bind_int64(carousel_stmt, CAROUSEL_COLUMN_ELEM_STREAM_ROWID,
+                       es_rowid);
+    sqlite3_bind_int(carousel_stmt, CAROUSEL_COLUMN_PID, es->i_pid);
+    sqlite3_bind_null(carousel_stmt, CAROUSEL_COLUMN_CAROUSEL_ID);
+    sqlite3_bind_null(carousel_stmt, CAROUSEL_COLUMN_DATA_BROADCAST_ID);
+  }
+  dr_target t;
+  dr_target_init(&t, exp, carousel_stmt, file_rowid);
+  t.pmt_rowid = pmt_rowid;
+  t.es_rowid = es_rowid;
+  export_descriptors(pmt_es_handlers, &t, es->p_first_descriptor);
+  if (carousel_stmt) {
+    sqlite3_step(carousel_stmt);
+  }
 }
 
 sqlite3_int64 db_export_pat(db_export *exp, sqlite3_int64 file_rowid,
@@ -430,8 +944,8 @@ sqlite3_int64 db_export_pat(db_export *exp, sqlite3_int64 file_rowid,
   return sqlite3_last_insert_rowid(exp->db);
 }
 
-void db_export_pmt(db_export *exp, sqlite3_int64 pat_rowid,
-                   const dvbpsi_pmt_t *pmt) {
+void db_export_pmt(db_export *exp, sqlite3_int64 file_rowid,
+                   sqlite3_int64 pat_rowid, const dvbpsi_pmt_t *pmt) {
   start_transaction(exp->db);
   sqlite3_stmt *stmt = exp->insert_stmts[DVBINDEX_TABLE_PMTS];
   sqlite3_reset(stmt);
@@ -441,40 +955,18 @@ void db_export_pmt(db_export *exp, sqlite3_int64 pat_rowid,
   sqlite3_bind_int(stmt, PMT_COLUMN_PCR_PID, pmt->i_pcr_pid);
   sqlite3_step(stmt);
   sqlite3_int64 pmt_rowid = sqlite3_last_insert_rowid(exp->db);
+  dr_target t;
+  dr_target_init(&t, exp, 0, file_rowid);
+  t.pmt_rowid = pmt_rowid;
+  export_descriptors(ca_handlers, &t, pmt->p_first_descriptor);
   dvbpsi_pmt_es_t *es = pmt->p_first_es;
   while (es) {
-    export_pmt_es(exp, pmt_rowid, es);
+    export_pmt_es(exp, file_rowid, pmt_rowid, es);
     es = es->p_next;
   }
   end_transaction(exp->db);
 }
 
-static void export_sdt_descriptors(sqlite3_stmt *stmt,
-                                   dvbpsi_descriptor_t *sdt_dscr) {
-  while (sdt_dscr) {
-    switch (sdt_dscr->i_tag) {
-    case 0x48: {
-      dvbpsi_service_dr_t *service_dr = dvbpsi_DecodeServiceDr(sdt_dscr);
-      if (service_dr) {
-        size_t outlen;
-        char *str =
-            dvbstring_to_utf8(service_dr->i_service_name,
-                              service_dr->i_service_name_length, &outlen);
-        sqlite3_bind_text64(stmt, SERVICE_COLUMN_NAME, str, outlen, free,
-                            SQLITE_UTF8);
-        str = dvbstring_to_utf8(service_dr->i_service_provider_name,
-                                service_dr->i_service_provider_name_length,
-                                &outlen);
-        sqlite3_bind_text64(stmt, SERVICE_COLUMN_PROVIDER_NAME, str, outlen,
-                            free, SQLITE_UTF8);
-      }
-    } break;
-    }
-
-    sdt_dscr = sdt_dscr->p_next;
-  }
-}
-
 static void export_sdt_service(db_export *exp, sqlite3_int64 sdt_rowid,
                                const dvbpsi_sdt_service_t *service) {
   sqlite3_stmt *stmt = exp->insert_stmts[DVBINDEX_TABLE_SERVICES];
@@ -485,10 +977,15 @@ static void export_sdt_service(db_export *exp, sqlite3_int64 sdt_rowid,
                    service->i_running_status);
   sqlite3_bind_int(stmt, SERVICE_COLUMN_SCRAMBLED, service->b_free_ca);
   sqlite3_bind_null(stmt, SERVICE_COLUMN_NAME);
-  export_sdt_descriptors(stmt, service->p_first_descriptor);
+  sqlite3_bind_null(stmt, SERVICE_COLUMN_PROVIDER_NAME);
+  dr_target t;
+  dr_target_init(&t, exp, stmt, -1);
+  export_descriptors(service_handlers, &t, service->p_first_descriptor);
   sqlite3_step(stmt);
 }
 
+#define SDT_ACTUAL_TABLE_ID 0x42
+
 void db_export_sdt(db_export *exp, sqlite3_int64 pat_rowid,
                    const dvbpsi_sdt_t *sdt) {
   sqlite3_stmt *stmt = exp->insert_stmts[DVBINDEX_TABLE_SDTS];
@@ -497,6 +994,9 @@ void db_export_sdt(db_export *exp, sqlite3_int64 pat_rowid,
   sqlite3_bind_int64(stmt, SDT_COLUMN_PAT_ROWID, pat_rowid);
   sqlite3_bind_int(stmt, SDT_COLUMN_VERSION, sdt->i_version);
   sqlite3_bind_int(stmt, SDT_COLUMN_ORIGINAL_NETWORK_ID, sdt->i_network_id);
+  sqlite3_bind_int(stmt, SDT_COLUMN_TSID, sdt->i_extension);
+  sqlite3_bind_int(stmt, SDT_COLUMN_ACTUAL,
+                   sdt->i_table_id == SDT_ACTUAL_TABLE_ID);
   sqlite3_step(stmt);
   sqlite3_int64 sdt_rowid = sqlite3_last_insert_rowid(exp->db);
   dvbpsi_sdt_service_t *service = sdt->p_first_service;
@@ -517,6 +1017,234 @@ sqlite3_int64 db_export_file(db_export *exp, const char *path, off_t size) {
   return sqlite3_last_insert_rowid(exp->db);
 }
 
+void db_export_table_version(db_export *exp, sqlite3_int64 file_rowid,
+                             const table_version_span *span) {
+  sqlite3_stmt *stmt = exp->insert_stmts[DVBINDEX_TABLE_TABLE_VERSIONS];
+  sqlite3_reset(stmt);
+  sqlite3_bind_int64(stmt, TABLE_VERSION_COLUMN_FILE_ROWID, file_rowid);
+  sqlite3_bind_int(stmt, TABLE_VERSION_COLUMN_TABLE_ID, span->table_id);
+  sqlite3_bind_int(stmt, TABLE_VERSION_COLUMN_TABLE_ID_EXT, span->table_id_ext);
+  sqlite3_bind_int(stmt, TABLE_VERSION_COLUMN_VERSION, span->version);
+  sqlite3_bind_int(stmt, TABLE_VERSION_COLUMN_CURRENT_NEXT,
+                   span->current_next);
+  sqlite3_bind_int64(stmt, TABLE_VERSION_COLUMN_FIRST_BYTE_OFFSET,
+                     span->first_byte_offset);
+  bind_nullable_int64(stmt, TABLE_VERSION_COLUMN_FIRST_PCR, span->first_pcr);
+  sqlite3_bind_int64(stmt, TABLE_VERSION_COLUMN_END_BYTE_OFFSET,
+                     span->end_byte_offset);
+  bind_nullable_int64(stmt, TABLE_VERSION_COLUMN_END_PCR, span->end_pcr);
+  sqlite3_bind_int(stmt, TABLE_VERSION_COLUMN_SUPERSEDED, span->superseded);
+  sqlite3_step(stmt);
+}
+
+static void bind_nullable_double(sqlite3_stmt *stmt, int pos, double val) {
+  if (val < 0) {
+    sqlite3_bind_null(stmt, pos);
+  } else {
+    sqlite3_bind_double(stmt, pos, val);
+  }
+}
+
+void db_export_file_probe_profile(db_export *exp, sqlite3_int64 file_rowid,
+                                  const char *profile) {
+  sqlite3_stmt *stmt = exp->file_probe_update;
+  sqlite3_reset(stmt);
+  sqlite3_bind_text(stmt, 1, profile, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 2, file_rowid);
+  sqlite3_step(stmt);
+}
+
+void db_export_file_timing(db_export *exp, sqlite3_int64 file_rowid,
+                           double duration, int64_t bitrate) {
+  sqlite3_stmt *stmt = exp->file_timing_update;
+  sqlite3_reset(stmt);
+  bind_nullable_double(stmt, 1, duration);
+  bind_nullable_int64(stmt, 2, bitrate);
+  sqlite3_bind_int64(stmt, 3, file_rowid);
+  sqlite3_step(stmt);
+}
+
+void db_export_pcr_pid_timing(db_export *exp, sqlite3_int64 file_rowid,
+                              uint16_t pcr_pid, double duration,
+                              uint32_t discontinuities) {
+  sqlite3_stmt *stmt = exp->pmt_timing_update;
+  sqlite3_reset(stmt);
+  bind_nullable_double(stmt, 1, duration);
+  sqlite3_bind_int64(stmt, 2, discontinuities);
+  sqlite3_bind_int(stmt, 3, pcr_pid);
+  sqlite3_bind_int64(stmt, 4, file_rowid);
+  sqlite3_step(stmt);
+}
+
+void db_export_pid_stats(db_export *exp, sqlite3_int64 file_rowid,
+                         const pid_stats_table *stats, double duration) {
+  if (!stats->pids || stats->total_packets == 0) {
+    return;
+  }
+  sqlite3_stmt *stmt = exp->insert_stmts[DVBINDEX_TABLE_PID_STATS];
+  start_transaction(exp->db);
+  for (unsigned int pid = 0; pid < TS_PID_COUNT; ++pid) {
+    const pid_stats *s = &stats->pids[pid];
+    if (s->packets == 0) {
+      continue;
+    }
+    sqlite3_reset(stmt);
+    sqlite3_bind_int64(stmt, PID_STAT_COLUMN_FILE_ROWID, file_rowid);
+    sqlite3_bind_int(stmt, PID_STAT_COLUMN_PID, pid);
+    sqlite3_bind_int64(stmt, PID_STAT_COLUMN_PACKETS, s->packets);
+    sqlite3_bind_int64(stmt, PID_STAT_COLUMN_PAYLOAD_PACKETS,
+                       s->payload_packets);
+    sqlite3_bind_int64(stmt, PID_STAT_COLUMN_ADAPTATION_PACKETS,
+                       s->adaptation_packets);
+    sqlite3_bind_int64(stmt, PID_STAT_COLUMN_CC_ERRORS, s->cc_errors);
+    sqlite3_bind_int64(stmt, PID_STAT_COLUMN_SCRAMBLED_PACKETS,
+                       s->scrambled_packets);
+    sqlite3_bind_double(stmt, PID_STAT_COLUMN_SHARE,
+                        (double)s->packets / stats->total_packets);
+    if (duration > 0) {
+      sqlite3_bind_int64(stmt, PID_STAT_COLUMN_BITRATE,
+                         (sqlite3_int64)(s->packets * TS_PACKET_SIZE * 8 /
+                                         duration));
+    } else {
+      sqlite3_bind_null(stmt, PID_STAT_COLUMN_BITRATE);
+    }
+    sqlite3_bind_int64(stmt, PID_STAT_COLUMN_FIRST_BYTE_OFFSET,
+                       s->first_offset);
+    sqlite3_bind_int64(stmt, PID_STAT_COLUMN_LAST_BYTE_OFFSET, s->last_offset);
+    sqlite3_step(stmt);
+  }
+  end_transaction(exp->db);
+}
+
+void db_export_pid_seconds(db_export *exp, sqlite3_int64 file_rowid,
+                           const pid_bucket_batch *batch) {
+  sqlite3_stmt *stmt = exp->insert_stmts[DVBINDEX_TABLE_PID_SECONDS];
+  start_transaction(exp->db);
+  for (size_t i = 0; i < batch->buckets.size; ++i) {
+    const pid_bucket *b = batch->buckets.data + i;
+    sqlite3_reset(stmt);
+    sqlite3_bind_int64(stmt, PID_SECOND_COLUMN_FILE_ROWID, file_rowid);
+    sqlite3_bind_int(stmt, PID_SECOND_COLUMN_PID, b->pid);
+    sqlite3_bind_int64(stmt, PID_SECOND_COLUMN_SECOND, b->second);
+    sqlite3_bind_int64(stmt, PID_SECOND_COLUMN_PACKETS, b->packets);
+    sqlite3_step(stmt);
+  }
+  end_transaction(exp->db);
+}
+
+void db_export_tr101290(db_export *exp, sqlite3_int64 file_rowid,
+                        const tr101290_state *tr) {
+  sqlite3_stmt *stmt = exp->insert_stmts[DVBINDEX_TABLE_TR101290_ERRORS];
+  start_transaction(exp->db);
+  for (tr101290_error err = 0; err < TR101290__LAST; ++err) {
+    const tr101290_counter *c = &tr->counters[err];
+    if (c->count == 0) {
+      continue;
+    }
+    sqlite3_reset(stmt);
+    sqlite3_bind_int64(stmt, TR101290_ERROR_COLUMN_FILE_ROWID, file_rowid);
+    sqlite3_bind_int(stmt, TR101290_ERROR_COLUMN_PRIORITY,
+                     tr101290_error_priority(err));
+    sqlite3_bind_text(stmt, TR101290_ERROR_COLUMN_INDICATOR,
+                      tr101290_error_name(err), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, TR101290_ERROR_COLUMN_COUNT, c->count);
+    sqlite3_bind_int64(stmt, TR101290_ERROR_COLUMN_FIRST_BYTE_OFFSET,
+                       c->first_offset);
+    sqlite3_step(stmt);
+  }
+  end_transaction(exp->db);
+}
+
+void db_export_splice_batch(db_export *exp, sqlite3_int64 file_rowid,
+                            const splice_batch *batch) {
+  sqlite3_stmt *stmt = exp->insert_stmts[DVBINDEX_TABLE_SPLICE_EVENTS];
+  start_transaction(exp->db);
+  for (size_t i = 0; i < batch->events.size; ++i) {
+    const splice_event *ev = batch->events.data + i;
+    sqlite3_reset(stmt);
+    sqlite3_bind_int64(stmt, SPLICE_EVENT_COLUMN_FILE_ROWID, file_rowid);
+    sqlite3_bind_int(stmt, SPLICE_EVENT_COLUMN_PID, ev->pid);
+    sqlite3_bind_int64(stmt, SPLICE_EVENT_COLUMN_BYTE_OFFSET, ev->file_offset);
+    sqlite3_bind_int(stmt, SPLICE_EVENT_COLUMN_COMMAND_TYPE, ev->command_type);
+    bind_nullable_int64(stmt, SPLICE_EVENT_COLUMN_SPLICE_EVENT_ID,
+                        ev->splice_event_id);
+    bind_nullable_int64(stmt, SPLICE_EVENT_COLUMN_CANCEL, ev->cancel);
+    bind_nullable_int64(stmt, SPLICE_EVENT_COLUMN_OUT_OF_NETWORK,
+                        ev->out_of_network);
+    bind_nullable_int64(stmt, SPLICE_EVENT_COLUMN_IMMEDIATE, ev->immediate);
+    bind_nullable_int64(stmt, SPLICE_EVENT_COLUMN_PTS, ev->pts);
+    bind_nullable_int64(stmt, SPLICE_EVENT_COLUMN_BREAK_DURATION,
+                        ev->break_duration);
+    bind_nullable_int64(stmt, SPLICE_EVENT_COLUMN_AUTO_RETURN,
+                        ev->auto_return);
+    bind_nullable_int64(stmt, SPLICE_EVENT_COLUMN_UNIQUE_PROGRAM_ID,
+                        ev->unique_program_id);
+    sqlite3_step(stmt);
+  }
+  end_transaction(exp->db);
+}
+
+static void bind_text_or_null(sqlite3_stmt *stmt, int pos, const char *text,
+                              size_t length) {
+  if (text) {
+    sqlite3_bind_text(stmt, pos, text, length, SQLITE_STATIC);
+  } else {
+    sqlite3_bind_null(stmt, pos);
+  }
+}
+
+void db_export_ait_batch(db_export *exp, sqlite3_int64 file_rowid,
+                         const ait_batch *batch) {
+  sqlite3_stmt *stmt = exp->insert_stmts[DVBINDEX_TABLE_APPLICATIONS];
+  const ait_application *app = batch->applications.data;
+  start_transaction(exp->db);
+  for (size_t i = 0; i < batch->sections.size; ++i) {
+    const ait_section *s = batch->sections.data + i;
+    for (size_t j = 0; j < s->num_applications; ++j, ++app) {
+      sqlite3_reset(stmt);
+      sqlite3_bind_int64(stmt, APPLICATION_COLUMN_FILE_ROWID, file_rowid);
+      sqlite3_bind_int(stmt, APPLICATION_COLUMN_PID, s->pid);
+      sqlite3_bind_int(stmt, APPLICATION_COLUMN_APPLICATION_TYPE,
+                       s->application_type);
+      sqlite3_bind_int(stmt, APPLICATION_COLUMN_VERSION, s->version);
+      sqlite3_bind_int64(stmt, APPLICATION_COLUMN_ORGANISATION_ID,
+                         app->organisation_id);
+      sqlite3_bind_int(stmt, APPLICATION_COLUMN_APPLICATION_ID,
+                       app->application_id);
+      sqlite3_bind_int(stmt, APPLICATION_COLUMN_CONTROL_CODE,
+                       app->control_code);
+      bind_text_or_null(stmt, APPLICATION_COLUMN_NAME, app->name,
+                        app->name_length);
+      bind_text_or_null(stmt, APPLICATION_COLUMN_URL, app->url,
+                        app->url_length);
+      sqlite3_step(stmt);
+    }
+  }
+  end_transaction(exp->db);
+}
+
+void db_export_rap_batch(db_export *exp, sqlite3_int64 file_rowid,
+                         const rap_batch *batch) {
+  sqlite3_stmt *stmt = exp->insert_stmts[DVBINDEX_TABLE_RANDOM_ACCESS_POINTS];
+  start_transaction(exp->db);
+  for (size_t i = 0; i < batch->points.size; ++i) {
+    const random_access_point *p = batch->points.data + i;
+    sqlite3_reset(stmt);
+    sqlite3_bind_int64(stmt, RANDOM_ACCESS_POINT_COLUMN_FILE_ROWID, file_rowid);
+    sqlite3_bind_int(stmt, RANDOM_ACCESS_POINT_COLUMN_PID, p->pid);
+    sqlite3_bind_int64(stmt, RANDOM_ACCESS_POINT_COLUMN_BYTE_OFFSET,
+                       p->file_offset);
+    bind_nullable_int64(stmt, RANDOM_ACCESS_POINT_COLUMN_PTS, p->pts);
+    sqlite3_bind_int(stmt, RANDOM_ACCESS_POINT_COLUMN_RANDOM_ACCESS_INDICATOR,
+                     p->random_access_indicator);
+    sqlite3_bind_int(stmt, RANDOM_ACCESS_POINT_COLUMN_KEYFRAME, p->keyframe);
+    bind_nullable_int64(stmt, RANDOM_ACCESS_POINT_COLUMN_PICTURES,
+                        p->pictures);
+    sqlite3_step(stmt);
+  }
+  end_transaction(exp->db);
+}
+
 int db_has_file(db_export *exp, const char *path, off_t size) {
   sqlite3_bind_text(exp->file_select, 1, file_name_from_path(path), -1,
                     SQLITE_TRANSIENT);
@@ -527,51 +1255,123 @@ int db_has_file(db_export *exp, const char *path, off_t size) {
   return rv == SQLITE_ROW;
 }
 
-static void export_nit_descriptors(sqlite3_stmt *stmt,
-                                   dvbpsi_descriptor_t *dr) {
-  while (dr) {
-    switch (dr->i_tag) {
-    case 0x40: {
-      dvbpsi_network_name_dr_t *netname = dvbpsi_DecodeNetworkNameDr(dr);
-      if (netname) {
-        size_t outlen;
-        char *utf8 = dvbstring_to_utf8(netname->i_name_byte,
-                                       netname->i_name_length, &outlen);
-        sqlite3_bind_text(stmt, NETWORK_COLUMN_NETWORK_NAME, utf8, outlen,
-                          free);
-      }
+sqlite3_int64 db_archived_file_rowid(db_export *exp, const char *path,
+                                     off_t size) {
+  sqlite3_stmt *stmt = exp->archived_file_select;
+  sqlite3_bind_text(stmt, 1, file_name_from_path(path), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 2, size);
+  sqlite3_int64 rowid = -1;
+  int rv = sqlite3_step(stmt);
+  if (rv == SQLITE_ROW) {
+    rowid = sqlite3_column_int64(stmt, 0);
+  }
+  sqlite3_reset(stmt);
+  assert(rv == SQLITE_ROW || rv == SQLITE_DONE);
+  return rowid;
+}
+
+sqlite3_int64 db_export_archived_file(db_export *exp, const char *path,
+                                      off_t size) {
+  sqlite3_stmt *stmt = exp->insert_stmts[DVBINDEX_TABLE_ARCHIVED_FILES];
+  sqlite3_reset(stmt);
+  sqlite3_bind_text(stmt, ARCHIVED_FILE_COLUMN_NAME, file_name_from_path(path),
+                    -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, ARCHIVED_FILE_COLUMN_SIZE, size);
+  sqlite3_step(stmt);
+  return sqlite3_last_insert_rowid(exp->db);
+}
+
+void db_export_section_archive(db_export *exp,
+                               sqlite3_int64 archived_file_rowid,
+                               const section_archive *archive) {
+  sqlite3_stmt *stmt = exp->insert_stmts[DVBINDEX_TABLE_SECTIONS];
+  start_transaction(exp->db);
+  for (size_t i = 0; i < archive->sections.size; ++i) {
+    const archived_section *s = archive->sections.data + i;
+    sqlite3_reset(stmt);
+    sqlite3_bind_int64(stmt, SECTION_COLUMN_ARCHIVED_FILE_ROWID,
+                       archived_file_rowid);
+    sqlite3_bind_int(stmt, SECTION_COLUMN_PID, s->pid);
+    sqlite3_bind_int(stmt, SECTION_COLUMN_TABLE_ID, s->table_id);
+    bind_nullable_int64(stmt, SECTION_COLUMN_TABLE_ID_EXT, s->table_id_ext);
+    bind_nullable_int64(stmt, SECTION_COLUMN_VERSION, s->version);
+    bind_nullable_int64(stmt, SECTION_COLUMN_SECTION_NUMBER,
+                        s->section_number);
+    sqlite3_bind_int64(stmt, SECTION_COLUMN_CRC, s->crc);
+    sqlite3_bind_int64(stmt, SECTION_COLUMN_FIRST_BYTE_OFFSET, s->file_offset);
+    sqlite3_bind_int(stmt, SECTION_COLUMN_SIZE, s->size);
+    sqlite3_bind_blob(stmt, SECTION_COLUMN_DATA, s->data, s->compressed_size,
+                      SQLITE_STATIC);
+    sqlite3_step(stmt);
+  }
+  end_transaction(exp->db);
+}
+
+int db_load_archived_files(db_export *exp, vec_archived_file *files) {
+  sqlite3_stmt *stmt;
+  const char sql[] = "SELECT rowid, name, size FROM archived_files";
+  int rv = sqlite3_prepare_v2(exp->db, sql, sizeof(sql), &stmt, 0);
+  assert(rv == SQLITE_OK);
+  while ((rv = sqlite3_step(stmt)) == SQLITE_ROW) {
+    archived_file *f = vec_archived_file_write(files);
+    if (!f) {
       break;
     }
+    const unsigned char *name = sqlite3_column_text(stmt, 1);
+    const int name_size = sqlite3_column_bytes(stmt, 1);
+    f->rowid = sqlite3_column_int64(stmt, 0);
+    f->name = malloc(name_size + 1);
+    f->size = sqlite3_column_int64(stmt, 2);
+    if (!f->name) {
+      --files->size;
+      break;
     }
+    memcpy(f->name, name, name_size);
+    f->name[name_size] = 0;
+  }
+  sqlite3_finalize(stmt);
+  return rv == SQLITE_DONE;
+}
 
-    dr = dr->p_next;
-  }
-}
-
-static void export_nit_ts_descriptors(db_export *exp,
-                                      sqlite3_int64 nit_ts_rowid,
-                                      dvbpsi_descriptor_t *dr) {
-  while (dr) {
-    switch (dr->i_tag) {
-    case 0x41: {
-      dvbpsi_service_list_dr_t *slist = dvbpsi_DecodeServiceListDr(dr);
-      if (slist) {
-        sqlite3_stmt *stmt = exp->insert_stmts[DVBINDEX_TABLE_TS_SERVICES];
-        for (unsigned int i = 0; i < slist->i_service_count; ++i) {
-          sqlite3_reset(stmt);
-          sqlite3_bind_int64(stmt, TS_SERVICE_COLUMN_TS_ROWID, nit_ts_rowid);
-          sqlite3_bind_int(stmt, TS_SERVICE_COLUMN_SERVICE_ID,
-                           slist->i_service[i].i_service_id);
-          sqlite3_bind_int(stmt, TS_SERVICE_COLUMN_SERVICE_TYPE,
-                           slist->i_service[i].i_service_type);
-          sqlite3_step(stmt);
-        }
-      }
-    }
+int db_load_files(db_export *exp, int archived, file_set *files) {
+  sqlite3_stmt *stmt;
+  const char *sql = archived ? "SELECT name, size FROM archived_files"
+                             : "SELECT name, size FROM files";
+  int rv = sqlite3_prepare_v2(exp->db, sql, -1, &stmt, 0);
+  assert(rv == SQLITE_OK);
+  while ((rv = sqlite3_step(stmt)) == SQLITE_ROW) {
+    const char *name = (const char *)sqlite3_column_text(stmt, 0);
+    if (file_set_insert(files, name, sqlite3_column_int64(stmt, 1)) < 0) {
+      break;
     }
+  }
+  sqlite3_finalize(stmt);
+  return rv == SQLITE_DONE;
+}
 
-    dr = dr->p_next;
+int db_load_archived_sections(db_export *exp,
+                              sqlite3_int64 archived_file_rowid,
+                              section_archive *archive) {
+  sqlite3_stmt *stmt = exp->archived_sections_select;
+  sqlite3_bind_int64(stmt, 1, archived_file_rowid);
+  int rv;
+  while ((rv = sqlite3_step(stmt)) == SQLITE_ROW) {
+    const void *blob = sqlite3_column_blob(stmt, 3);
+    const int compressed_size = sqlite3_column_bytes(stmt, 3);
+    uint8_t *data = malloc(compressed_size);
+    if (!data) {
+      break;
+    }
+    memcpy(data, blob, compressed_size);
+    if (!section_archive_add_compressed(archive, data, compressed_size,
+                                        sqlite3_column_int(stmt, 2),
+                                        sqlite3_column_int(stmt, 0),
+                                        sqlite3_column_int64(stmt, 1))) {
+      break;
+    }
   }
+  sqlite3_reset(stmt);
+  return rv == SQLITE_DONE;
 }
 
 static void export_nit_transport_streams(db_export *exp,
@@ -584,12 +1384,70 @@ static void export_nit_transport_streams(db_export *exp,
     sqlite3_bind_int(stmt, TRANSPORT_STREAM_COLUMN_TSID, ts->i_ts_id);
     sqlite3_bind_int(stmt, TRANSPORT_STREAM_COLUMN_ONID, ts->i_orig_network_id);
     sqlite3_step(stmt);
-    sqlite3_int64 nit_ts_rowid = sqlite3_last_insert_rowid(exp->db);
-    export_nit_ts_descriptors(exp, nit_ts_rowid, ts->p_first_descriptor);
+    dr_target t;
+    dr_target_init(&t, exp, 0, -1);
+    t.ts_rowid = sqlite3_last_insert_rowid(exp->db);
+    export_descriptors(network_ts_handlers, &t, ts->p_first_descriptor);
+    ts = ts->p_next;
+  }
+}
+
+void db_export_cat(db_export *exp, sqlite3_int64 file_rowid,
+                   const dvbpsi_cat_t *cat) {
+  start_transaction(exp->db);
+  sqlite3_stmt *stmt = exp->insert_stmts[DVBINDEX_TABLE_CATS];
+  sqlite3_reset(stmt);
+  sqlite3_bind_int64(stmt, CAT_COLUMN_FILE_ROWID, file_rowid);
+  sqlite3_bind_int(stmt, CAT_COLUMN_VERSION, cat->i_version);
+  sqlite3_step(stmt);
+  dr_target t;
+  dr_target_init(&t, exp, 0, file_rowid);
+  t.cat_rowid = sqlite3_last_insert_rowid(exp->db);
+  export_descriptors(ca_handlers, &t, cat->p_first_descriptor);
+  end_transaction(exp->db);
+}
+
+static void export_bat_transport_streams(db_export *exp,
+                                         sqlite3_int64 bat_rowid,
+                                         dvbpsi_bat_ts_t *ts) {
+  while (ts) {
+    sqlite3_stmt *stmt =
+        exp->insert_stmts[DVBINDEX_TABLE_BOUQUET_TRANSPORT_STREAMS];
+    sqlite3_reset(stmt);
+    sqlite3_bind_int64(stmt, BOUQUET_TRANSPORT_STREAM_COLUMN_BOUQUET_ROWID,
+                       bat_rowid);
+    sqlite3_bind_int(stmt, BOUQUET_TRANSPORT_STREAM_COLUMN_TSID, ts->i_ts_id);
+    sqlite3_bind_int(stmt, BOUQUET_TRANSPORT_STREAM_COLUMN_ONID,
+                     ts->i_orig_network_id);
+    sqlite3_step(stmt);
+    dr_target t;
+    dr_target_init(&t, exp, 0, -1);
+    t.ts_rowid = sqlite3_last_insert_rowid(exp->db);
+    export_descriptors(bouquet_ts_handlers, &t, ts->p_first_descriptor);
     ts = ts->p_next;
   }
 }
 
+void db_export_bat(db_export *exp, sqlite3_int64 file_rowid,
+                   const dvbpsi_bat_t *bat) {
+  start_transaction(exp->db);
+  sqlite3_stmt *stmt = exp->insert_stmts[DVBINDEX_TABLE_BOUQUETS];
+  sqlite3_reset(stmt);
+  sqlite3_bind_int64(stmt, BOUQUET_COLUMN_FILE_ROWID, file_rowid);
+  sqlite3_bind_int(stmt, BOUQUET_COLUMN_BOUQUET_ID, bat->i_extension);
+  sqlite3_bind_int(stmt, BOUQUET_COLUMN_VERSION, bat->i_version);
+  sqlite3_bind_null(stmt, BOUQUET_COLUMN_BOUQUET_NAME);
+  dr_target t;
+  dr_target_init(&t, exp, stmt, file_rowid);
+  export_descriptors(bouquet_handlers, &t, bat->p_first_descriptor);
+  sqlite3_step(stmt);
+  sqlite3_int64 bat_rowid = sqlite3_last_insert_rowid(exp->db);
+  export_bat_transport_streams(exp, bat_rowid, bat->p_first_ts);
+  end_transaction(exp->db);
+}
+
+#define NIT_ACTUAL_TABLE_ID 0x40
+
 void db_export_nit(db_export *exp, sqlite3_int64 file_rowid,
                    const dvbpsi_nit_t *nit) {
   start_transaction(exp->db);
@@ -597,9 +1455,105 @@ void db_export_nit(db_export *exp, sqlite3_int64 file_rowid,
   sqlite3_reset(stmt);
   sqlite3_bind_int64(stmt, NETWORK_COLUMN_FILE_ROWID, file_rowid);
   sqlite3_bind_int(stmt, NETWORK_COLUMN_NETWORK_ID, nit->i_network_id);
-  export_nit_descriptors(stmt, nit->p_first_descriptor);
+  sqlite3_bind_int(stmt, NETWORK_COLUMN_ACTUAL,
+                   nit->i_table_id == NIT_ACTUAL_TABLE_ID);
+  sqlite3_bind_null(stmt, NETWORK_COLUMN_NETWORK_NAME);
+  dr_target t;
+  dr_target_init(&t, exp, stmt, file_rowid);
+  export_descriptors(network_handlers, &t, nit->p_first_descriptor);
   sqlite3_step(stmt);
   sqlite3_int64 nit_rowid = sqlite3_last_insert_rowid(exp->db);
   export_nit_transport_streams(exp, nit_rowid, nit->p_first_ts);
   end_transaction(exp->db);
 }
+
+static void export_eit_event(sqlite3_stmt *stmt, sqlite3_int64 eit_rowid,
+                             const eit_event *ev) {
+  sqlite3_reset(stmt);
+  sqlite3_bind_int64(stmt, EVENT_COLUMN_EIT_ROWID, eit_rowid);
+  sqlite3_bind_int(stmt, EVENT_COLUMN_EVENT_ID, ev->event_id);
+  bind_nullable_int64(stmt, EVENT_COLUMN_START_TIME, ev->start_time);
+  bind_nullable_int64(stmt, EVENT_COLUMN_DURATION, ev->duration);
+  sqlite3_bind_int(stmt, EVENT_COLUMN_RUNNING_STATUS, ev->running_status);
+  sqlite3_bind_int(stmt, EVENT_COLUMN_SCRAMBLED, ev->free_ca_mode);
+  if (ev->has_language) {
+    sqlite3_bind_text(stmt, EVENT_COLUMN_LANGUAGE, ev->language,
+                      sizeof(ev->language), SQLITE_STATIC);
+  } else {
+    sqlite3_bind_null(stmt, EVENT_COLUMN_LANGUAGE);
+  }
+  /* the strings are owned by the batch, which outlives the statement's
+   * execution. */
+  sqlite3_bind_text64(stmt, EVENT_COLUMN_NAME, ev->name, ev->name_length,
+                      SQLITE_STATIC, SQLITE_UTF8);
+  sqlite3_bind_text64(stmt, EVENT_COLUMN_TEXT, ev->text, ev->text_length,
+                      SQLITE_STATIC, SQLITE_UTF8);
+  sqlite3_step(stmt);
+}
+
+void db_export_eit_batch(db_export *exp, sqlite3_int64 file_rowid,
+                         const eit_batch *batch) {
+  sqlite3_stmt *eit_stmt = exp->insert_stmts[DVBINDEX_TABLE_EITS];
+  sqlite3_stmt *event_stmt = exp->insert_stmts[DVBINDEX_TABLE_EVENTS];
+  const eit_event *ev = batch->events.data;
+  start_transaction(exp->db);
+  for (size_t i = 0; i < batch->sections.size; ++i) {
+    const eit_section *s = batch->sections.data + i;
+    sqlite3_reset(eit_stmt);
+    sqlite3_bind_int64(eit_stmt, EIT_COLUMN_FILE_ROWID, file_rowid);
+    sqlite3_bind_int(eit_stmt, EIT_COLUMN_TABLE_ID, s->table_id);
+    sqlite3_bind_int(eit_stmt, EIT_COLUMN_SERVICE_ID, s->service_id);
+    sqlite3_bind_int(eit_stmt, EIT_COLUMN_TSID, s->tsid);
+    sqlite3_bind_int(eit_stmt, EIT_COLUMN_ONID, s->onid);
+    sqlite3_bind_int(eit_stmt, EIT_COLUMN_VERSION, s->version);
+    sqlite3_bind_int(eit_stmt, EIT_COLUMN_SECTION_NUMBER, s->section_number);
+    sqlite3_step(eit_stmt);
+    sqlite3_int64 eit_rowid = sqlite3_last_insert_rowid(exp->db);
+    for (size_t j = 0; j < s->num_events; ++j, ++ev) {
+      export_eit_event(event_stmt, eit_rowid, ev);
+    }
+  }
+  end_transaction(exp->db);
+}
+
+static void export_local_time_offset(sqlite3_stmt *stmt,
+                                     sqlite3_int64 utc_time_rowid,
+                                     const local_time_offset *lto) {
+  sqlite3_reset(stmt);
+  sqlite3_bind_int64(stmt, LOCAL_TIME_OFFSET_COLUMN_UTC_TIME_ROWID,
+                     utc_time_rowid);
+  sqlite3_bind_text(stmt, LOCAL_TIME_OFFSET_COLUMN_COUNTRY_CODE,
+                    lto->country_code, sizeof(lto->country_code),
+                    SQLITE_STATIC);
+  sqlite3_bind_int(stmt, LOCAL_TIME_OFFSET_COLUMN_REGION_ID, lto->region_id);
+  sqlite3_bind_int(stmt, LOCAL_TIME_OFFSET_COLUMN_LOCAL_TIME_OFFSET,
+                   lto->offset);
+  bind_nullable_int64(stmt, LOCAL_TIME_OFFSET_COLUMN_TIME_OF_CHANGE,
+                      lto->time_of_change);
+  sqlite3_bind_int(stmt, LOCAL_TIME_OFFSET_COLUMN_NEXT_TIME_OFFSET,
+                   lto->next_offset);
+  sqlite3_step(stmt);
+}
+
+void db_export_time_batch(db_export *exp, sqlite3_int64 file_rowid,
+                          const time_batch *batch) {
+  sqlite3_stmt *time_stmt = exp->insert_stmts[DVBINDEX_TABLE_UTC_TIMES];
+  sqlite3_stmt *lto_stmt = exp->insert_stmts[DVBINDEX_TABLE_LOCAL_TIME_OFFSETS];
+  const local_time_offset *lto = batch->offsets.data;
+  start_transaction(exp->db);
+  for (size_t i = 0; i < batch->refs.size; ++i) {
+    const time_ref *ref = batch->refs.data + i;
+    sqlite3_reset(time_stmt);
+    sqlite3_bind_int64(time_stmt, UTC_TIME_COLUMN_FILE_ROWID, file_rowid);
+    sqlite3_bind_int64(time_stmt, UTC_TIME_COLUMN_BYTE_OFFSET,
+                       ref->file_offset);
+    bind_nullable_int64(time_stmt, UTC_TIME_COLUMN_UTC_TIME, ref->utc_time);
+    sqlite3_bind_int(time_stmt, UTC_TIME_COLUMN_TABLE_ID, ref->table_id);
+    sqlite3_step(time_stmt);
+    sqlite3_int64 utc_time_rowid = sqlite3_last_insert_rowid(exp->db);
+    for (size_t j = 0; j < ref->num_offsets; ++j, ++lto) {
+      export_local_time_offset(lto_stmt, utc_time_rowid, lto);
+    }
+  }
+  end_transaction(exp->db);
+}
@@ -18,8 +18,11 @@ Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #ifndef DVBINDEX_EXPORT_H
 #define DVBINDEX_EXPORT_H
 
+#include "archive.h"
+#include "fileset.h"
 #include "tables.h"
 #include <sqlite3.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 typedef struct AVStream AVStream;
@@ -27,26 +30,135 @@ typedef struct dvbpsi_pat_s dvbpsi_pat_t;
 typedef struct dvbpsi_pmt_s dvbpsi_pmt_t;
 typedef struct dvbpsi_sdt_s dvbpsi_sdt_t;
 typedef struct dvbpsi_nit_s dvbpsi_nit_t;
+typedef struct dvbpsi_cat_s dvbpsi_cat_t;
+typedef struct dvbpsi_bat_s dvbpsi_bat_t;
+typedef struct eit_batch_ eit_batch;
+typedef struct time_batch_ time_batch;
+typedef struct splice_batch_ splice_batch;
+typedef struct ait_batch_ ait_batch;
+typedef struct rap_batch_ rap_batch;
+typedef struct pid_stats_table_ pid_stats_table;
+typedef struct pid_bucket_batch_ pid_bucket_batch;
+typedef struct tr101290_state_ tr101290_state;
+typedef struct es_parser_ es_parser;
+
+/* the time a table version stayed on air. the PCRs are -1 when no PCR had been
+ * seen yet at the given offset. */
+typedef struct table_version_span_ {
+  off_t first_byte_offset;
+  off_t end_byte_offset;
+  int64_t first_pcr;
+  int64_t end_pcr;
+  uint16_t table_id_ext;
+  uint8_t table_id;
+  uint8_t version;
+  uint8_t current_next;
+  uint8_t superseded;
+} table_version_span;
 
 typedef struct db_export_ {
   sqlite3 *db;
   sqlite3_stmt *insert_stmts[DVBINDEX_TABLE__LAST];
   sqlite3_stmt *file_select;
+  sqlite3_stmt *file_timing_update;
+  sqlite3_stmt *pmt_timing_update;
+  sqlite3_stmt *file_probe_update;
+  sqlite3_stmt *archived_file_select;
+  sqlite3_stmt *archived_sections_select;
 } db_export;
 
 int db_export_init(db_export *exp, const char *filename, char **error);
+/* scrambled has one flag per stream. */
 void db_export_av_streams(db_export *exp, sqlite3_int64 file_rowid,
-                          unsigned int num_streams, AVStream *const *streams);
+                          unsigned int num_streams, AVStream *const *streams,
+                          const uint8_t *scrambled);
 sqlite3_int64 db_export_pat(db_export *exp, sqlite3_int64 file_rowid,
                             const dvbpsi_pat_t *pat);
-void db_export_pmt(db_export *exp, sqlite3_int64 pat_rowid,
-                   const dvbpsi_pmt_t *pmt);
+void db_export_pmt(db_export *exp, sqlite3_int64 file_rowid,
+                   sqlite3_int64 pat_rowid, const dvbpsi_pmt_t *pmt);
 void db_export_sdt(db_export *exp, sqlite3_int64 pat_rowid,
                    const dvbpsi_sdt_t *sdt);
 void db_export_nit(db_export *exp, sqlite3_int64 file_rowid,
                    const dvbpsi_nit_t *nit);
+void db_export_cat(db_export *exp, sqlite3_int64 file_rowid,
+                   const dvbpsi_cat_t *cat);
+void db_export_bat(db_export *exp, sqlite3_int64 file_rowid,
+                   const dvbpsi_bat_t *bat);
+void db_export_eit_batch(db_export *exp, sqlite3_int64 file_rowid,
+                         const eit_batch *batch);
+void db_export_time_batch(db_export *exp, sqlite3_int64 file_rowid,
+                          const time_batch *batch);
+void db_export_table_version(db_export *exp, sqlite3_int64 file_rowid,
+                             const table_version_span *span);
+/* the timing values measured from the PCRs are stored after the rows they
+ * belong to. a negative duration or bitrate is stored as NULL. */
+void db_export_file_timing(db_export *exp, sqlite3_int64 file_rowid,
+                           double duration, int64_t bitrate);
+/* exports the streams of the parsers which found their parameters, or whose
+ * ES is scrambled. */
+void db_export_es_streams(db_export *exp, sqlite3_int64 file_rowid,
+                          const es_parser *parsers, size_t count);
+/* the probe profile the stream parameters were found with. */
+void db_export_file_probe_profile(db_export *exp, sqlite3_int64 file_rowid,
+                                  const char *profile);
+void db_export_pcr_pid_timing(db_export *exp, sqlite3_int64 file_rowid,
+                              uint16_t pcr_pid, double duration,
+                              uint32_t discontinuities);
+/* the bitrates of the PIDs are left NULL when duration is negative. */
+void db_export_pid_stats(db_export *exp, sqlite3_int64 file_rowid,
+                         const pid_stats_table *stats, double duration);
+void db_export_pid_seconds(db_export *exp, sqlite3_int64 file_rowid,
+                           const pid_bucket_batch *batch);
+void db_export_tr101290(db_export *exp, sqlite3_int64 file_rowid,
+                        const tr101290_state *tr);
+void db_export_splice_batch(db_export *exp, sqlite3_int64 file_rowid,
+                            const splice_batch *batch);
+void db_export_ait_batch(db_export *exp, sqlite3_int64 file_rowid,
+                         const ait_batch *batch);
+void db_export_rap_batch(db_export *exp, sqlite3_int64 file_rowid,
+                         const rap_batch *batch);
 int db_has_file(db_export *exp, const char *path, off_t size);
+/* returns -1 if the sections of the file were never archived. */
+sqlite3_int64 db_archived_file_rowid(db_export *exp, const char *path,
+                                     off_t size);
+sqlite3_int64 db_export_archived_file(db_export *exp, const char *path,
+                                      off_t size);
+void db_export_section_archive(db_export *exp,
+                               sqlite3_int64 archived_file_rowid,
+                               const section_archive *archive);
+/* these return 0 if not everything could be loaded. the names of the files
+ * must be released with free(). */
+int db_load_archived_files(db_export *exp, vec_archived_file *files);
+int db_load_archived_sections(db_export *exp,
+                              sqlite3_int64 archived_file_rowid,
+                              section_archive *archive);
+/* adds every file, or every archived file, to the set. */
+int db_load_files(db_export *exp, int archived, file_set *files);
 sqlite3_int64 db_export_file(db_export *exp, const char *path, off_t size);
+/* sqlite3_serialize() is always built in from sqlite 3.36 on. */
+#define DB_EXPORT_HAS_IMAGES (SQLITE_VERSION_NUMBER >= 3036000)
+
+/* empties every table, archive included. */
+void db_export_clear(db_export *exp);
+/* a copy of the whole database, to be released with sqlite3_free(). */
+void *db_export_image(db_export *exp, sqlite3_int64 *size);
+int db_export_attach(db_export *exp, const char *filename, const char *schema);
+int db_export_detach(db_export *exp, const char *schema);
+/* whether the attached database was written by dvbindex with the same
+ * tables. */
+int db_export_attached_is_current(db_export *exp, const char *schema);
+/* whether the attached database has a file, or an archived file, of the same
+ * name and size as one in the database. it does as well if that can't be
+ * told. */
+int db_export_attached_overlaps(db_export *exp, const char *schema);
+/* replaces the attached database with the image, which is always taken over
+ * by sqlite. */
+int db_export_load_image(db_export *exp, const char *schema, void *image,
+                         sqlite3_int64 size);
+/* copies the rows of the attached databases, which have the same tables, in a
+ * single transaction. their rowids and the rowids they reference are moved
+ * past the ones already in the database. */
+int db_export_merge(db_export *exp, const char *const *schemas, size_t count);
 void db_export_close(db_export *exp);
 
 #endif
@@ -0,0 +1,102 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "fileset.h"
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define FILE_SET_INITIAL_CAP 64
+
+/* the slot of the file, or the empty one where it would go. */
+static size_t file_set_slot(const file_set *set, uint64_t key,
+                            const char *name, int64_t size) {
+  /* Fibonacci hashing, cap is always a power of 2. */
+  const size_t mask = set->cap - 1;
+  size_t slot = (size_t)((key * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & mask;
+  for (;;) {
+    const file_set_entry *e = set->entries + slot;
+    if (!e->name || (e->key == key && e->size == size &&
+                     strcmp(e->name, name) == 0)) {
+      return slot;
+    }
+    slot = (slot + 1) & mask;
+  }
+}
+
+void file_set_init(file_set *set) {
+  set->entries = 0;
+  set->size = 0;
+  set->cap = 0;
+}
+
+void file_set_destroy(file_set *set) {
+  for (size_t i = 0; i < set->cap; ++i) {
+    free(set->entries[i].name);
+  }
+  free(set->entries);
+  file_set_init(set);
+}
+
+static int file_set_rehash(file_set *set, size_t new_cap) {
+  file_set old = *set;
+  set->entries = calloc(new_cap, sizeof(*set->entries));
+  if (!set->entries) {
+    *set = old;
+    return 0;
+  }
+  set->cap = new_cap;
+  for (size_t i = 0; i < old.cap; ++i) {
+    const file_set_entry *e = old.entries + i;
+    if (e->name) {
+      set->entries[file_set_slot(set, e->key, e->name, e->size)] = *e;
+    }
+  }
+  free(old.entries);
+  return 1;
+}
+
+int file_set_insert(file_set *set, const char *name, int64_t size) {
+  if ((set->size + 1) * 2 > set->cap &&
+      !file_set_rehash(set, set->cap ? set->cap * 2 : FILE_SET_INITIAL_CAP)) {
+    return -1;
+  }
+  const uint64_t key = file_key(name, size);
+  file_set_entry *e = set->entries + file_set_slot(set, key, name, size);
+  if (e->name) {
+    return 0;
+  }
+  e->name = strdup(name);
+  if (!e->name) {
+    return -1;
+  }
+  e->key = key;
+  e->size = size;
+  ++set->size;
+  return 1;
+}
+
+int file_set_has(const file_set *set, const char *name, int64_t size) {
+  if (set->cap == 0) {
+    return 0;
+  }
+  const uint64_t key = file_key(name, size);
+  return set->entries[file_set_slot(set, key, name, size)].name != 0;
+}
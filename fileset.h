@@ -0,0 +1,45 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef DVBINDEX_FILESET_H
+#define DVBINDEX_FILESET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* set of files, which are only told apart by their name and size. the
+ * file_key() of a file finds its slot, the name and size confirm it. */
+typedef struct file_set_entry_ {
+  uint64_t key;
+  char *name;
+  int64_t size;
+} file_set_entry;
+
+typedef struct file_set_ {
+  file_set_entry *entries;
+  size_t size;
+  size_t cap;
+} file_set;
+
+void file_set_init(file_set *set);
+void file_set_destroy(file_set *set);
+/* returns 1 if the file was not in the set before, 0 if it was, and -1 if it
+ * could not be added. */
+int file_set_insert(file_set *set, const char *name, int64_t size);
+int file_set_has(const file_set *set, const char *name, int64_t size);
+
+#endif
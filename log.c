@@ -15,6 +15,8 @@ this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
 Street, Fifth Floor, Boston, MA  02110-1301, USA.
 */
 
+#define _POSIX_C_SOURCE 200112L
+
 #include "log.h"
 #include "util.h"
 #include <stdio.h>
@@ -36,17 +38,22 @@ static const char *const sever_names[DVBIDX_LOG_SEVERITY__LAST] = {
 void dvbindex_vlog(dvbindex_log_cat cat, dvbindex_log_severity severity,
                    const char *fmt, va_list args) {
   if (severity <= max_severity[cat]) {
+    /* the files are read by several threads. */
+    flockfile(stderr);
     fprintf(stderr, "[%s] [%s] ", cat_names[cat], sever_names[severity]);
     vfprintf(stderr, fmt, args);
+    funlockfile(stderr);
   }
 }
 
 void dvbindex_vlog_ctx(dvbindex_log_cat cat, dvbindex_log_severity severity,
                        void *ctx, const char *fmt, va_list args) {
   if (severity <= max_severity[cat]) {
+    flockfile(stderr);
     fprintf(stderr, "[%s] [%s] [%p] ", cat_names[cat], sever_names[severity],
             ctx);
     vfprintf(stderr, fmt, args);
+    funlockfile(stderr);
   }
 }
 
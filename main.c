@@ -22,45 +22,216 @@ Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "read.h"
 #include "version.h"
 
+#include <getopt.h>
 #include <sqlite3.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 static void usage(const char *progname) {
   fprintf(stderr, "dvbindex v" DVBINDEX_VERSION_STRING "\n");
-  fprintf(stderr, "Usage : %s dbfile [stream ...]\n", progname);
+  fprintf(stderr, "Usage : %s [options] dbfile [stream ...]\n", progname);
+  fprintf(stderr, "        %s merge [-v verbosity] dbfile shard ...\n",
+          progname);
   /* clang-format off */
   static const char *usagemsg =
 "Read streams and save their metadata and codec information into dbfile. Each of\n"
 "the streams might be a file or a directory.\n"
 "\n"
+"merge copies the rows of the shard databases into dbfile, which might already\n"
+"have some, renumbering the rows they reference. The shards must be written by\n"
+"this version of dvbindex, and must not have any file in common, as is the case\n"
+"with --shard. A shard with a file already in dbfile, going by its name and\n"
+"size, is refused, and so are the ones after it.\n"
+"\n"
 "Additional options :\n"
 "   -v verbosity   Specify the logging verbosity, with 0 being the lowest and 3\n"
 "                  being the highest. This can be a single number, in which case\n"
 "                  all components have the same verbosity, or a comma-delimited\n"
 "                  sequence of component:severity tokens. Valid components are :\n"
-"                  dvbindex, ffmpeg, sqlite, dvbpsi\n";
+"                  dvbindex, ffmpeg, sqlite, dvbpsi\n"
+"   -p, --probe profile\n"
+"                  Choose how much of each file ffmpeg reads to find the stream\n"
+"                  parameters. Valid profiles are :\n"
+"                  native : parse the headers of the audio and video streams\n"
+"                  without ffmpeg, which is only used with the full profile\n"
+"                  for the files having streams the parsers don't know. This\n"
+"                  is the default.\n"
+"                  full : the ffmpeg defaults\n"
+"                  fast : stop once every PMT was received, and every audio\n"
+"                  and video stream had a complete PES packet, or after the\n"
+"                  probe size or analyze duration is reached\n"
+"   --psi-only     Only index the PSI and SI, reading each file once from start\n"
+"                  to end without ffmpeg. The stream parameters are not\n"
+"                  probed, so the vid_streams and aud_streams tables get\n"
+"                  nothing for these files.\n"
+"   --probesize bytes\n"
+"                  The most data read by the fast profile, default 1048576.\n"
+"   --analyzeduration microseconds\n"
+"                  The longest stream duration read by the fast profile,\n"
+"                  default 1000000.\n"
+"   -j jobs        Read this many files at the same time, the default being the\n"
+"                  number of CPUs. Only one thread writes to dbfile.\n"
+"   -w walkers     Explore the directories with this many threads, the default\n"
+"                  being 4. Each has at most one directory open.\n"
+"   --shard i/n    Only read the files of the i-th of n slices, i going from 1\n"
+"                  to n. The slice of a file only depends on its name and size,\n"
+"                  not on where the tree is mounted.\n"
+"   -m megabytes   Limit the memory used for the PSI data of a single file. If\n"
+"                  a file needs more than that, the rest of its PSI data is\n"
+"                  ignored. 0 means no limit, the default is 64.\n"
+"   -r, --rederive Rebuild the PSI and SI tables of the files whose sections\n"
+"                  were archived in dbfile, but which are not in its tables\n"
+"                  anymore, e.g. after a schema upgrade. The files themselves\n"
+"                  are not read : the stream, PID and timing information of\n"
+"                  these files needs a full read.\n";
   /* clang-format on */
   fputs(usagemsg, stderr);
 }
 
-int main(int argc, char *argv[]) {
+/* each shard is merged in its own transaction. */
+static int merge_main(const char *progname, int argc, char *argv[]) {
+  static const char *const schemas[] = {"shard"};
   int opt;
   while ((opt = getopt(argc, argv, "v:")) != -1) {
     switch (opt) {
     case 'v':
       dvbindex_log_parse_severity(optarg);
       break;
+    default:
+      usage(progname);
+      return EXIT_FAILURE;
     }
   }
 
   if ((argc - optind) < 2) {
+    usage(progname);
+    return EXIT_FAILURE;
+  }
+
+  int rv = EXIT_SUCCESS;
+  db_export db;
+  const char *dbfilename = argv[optind];
+  char *db_init_error;
+  int db_init_rv = db_export_init(&db, dbfilename, &db_init_error);
+  if (db_init_rv != SQLITE_OK) {
+    dvbindex_log(DVBIDX_LOG_CAT_SQLITE, DVBIDX_LOG_SEVERITY_CRITICAL,
+                 "Could not init database %s : %s (%s)\n", dbfilename,
+                 sqlite3_errstr(db_init_rv), db_init_error);
+    rv = EXIT_FAILURE;
+    goto beach;
+  }
+
+  for (int i = optind + 1; i < argc && rv == EXIT_SUCCESS; ++i) {
+    const char *shard = argv[i];
+    /* attaching creates missing files. */
+    int merge_rv = access(shard, R_OK) == 0
+                       ? db_export_attach(&db, shard, schemas[0])
+                       : SQLITE_CANTOPEN;
+    if (merge_rv != SQLITE_OK) {
+      dvbindex_log(DVBIDX_LOG_CAT_SQLITE, DVBIDX_LOG_SEVERITY_CRITICAL,
+                   "Could not open %s : %s\n", shard, sqlite3_errstr(merge_rv));
+      rv = EXIT_FAILURE;
+      break;
+    }
+    if (!db_export_attached_is_current(&db, schemas[0])) {
+      dvbindex_log(DVBIDX_LOG_CAT_DVBINDEX, DVBIDX_LOG_SEVERITY_CRITICAL,
+                   "%s was not written by this version of dvbindex\n", shard);
+      rv = EXIT_FAILURE;
+    } else if (db_export_attached_overlaps(&db, schemas[0])) {
+      dvbindex_log(DVBIDX_LOG_CAT_DVBINDEX, DVBIDX_LOG_SEVERITY_CRITICAL,
+                   "%s has files already in %s\n", shard, dbfilename);
+      rv = EXIT_FAILURE;
+    } else if ((merge_rv = db_export_merge(&db, schemas, 1)) != SQLITE_OK) {
+      dvbindex_log(DVBIDX_LOG_CAT_SQLITE, DVBIDX_LOG_SEVERITY_CRITICAL,
+                   "Could not merge %s : %s\n", shard,
+                   sqlite3_errstr(merge_rv));
+      rv = EXIT_FAILURE;
+    }
+    db_export_detach(&db, schemas[0]);
+  }
+
+  db_export_close(&db);
+
+beach:
+  sqlite3_free(db_init_error);
+  return rv;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && strcmp(argv[1], "merge") == 0) {
+    return merge_main(argv[0], argc - 1, argv + 1);
+  }
+
+  enum { OPT_PROBESIZE = 256, OPT_ANALYZEDURATION, OPT_PSI_ONLY, OPT_SHARD };
+  static const struct option longopts[] = {
+      {"rederive", no_argument, 0, 'r'},
+      {"probe", required_argument, 0, 'p'},
+      {"probesize", required_argument, 0, OPT_PROBESIZE},
+      {"analyzeduration", required_argument, 0, OPT_ANALYZEDURATION},
+      {"psi-only", no_argument, 0, OPT_PSI_ONLY},
+      {"shard", required_argument, 0, OPT_SHARD},
+      {0, 0, 0, 0}};
+  int opt;
+  int rederive = 0;
+  read_opts opts;
+  read_opts_init(&opts);
+  while ((opt = getopt_long(argc, argv, "j:m:p:rv:w:", longopts, 0)) != -1) {
+    switch (opt) {
+    case 'j':
+      opts.jobs = (unsigned int)strtoul(optarg, 0, 10);
+      break;
+    case 'm':
+      opts.psi_mem_limit = strtoul(optarg, 0, 10) * 1024 * 1024;
+      break;
+    case 'p': {
+      int profile = probe_profile_from_name(optarg);
+      if (profile < 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      opts.probe = profile;
+      break;
+    }
+    case OPT_PROBESIZE:
+      opts.probe_size = strtoll(optarg, 0, 10);
+      break;
+    case OPT_ANALYZEDURATION:
+      opts.analyze_duration = strtoll(optarg, 0, 10);
+      break;
+    case OPT_PSI_ONLY:
+      opts.psi_only = 1;
+      break;
+    case OPT_SHARD: {
+      unsigned int shard, shards;
+      if (sscanf(optarg, "%u/%u", &shard, &shards) != 2 || shard == 0 ||
+          shard > shards) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      opts.shard = shard - 1;
+      opts.shards = shards;
+      break;
+    }
+    case 'r':
+      rederive = 1;
+      break;
+    case 'v':
+      dvbindex_log_parse_severity(optarg);
+      break;
+    case 'w':
+      opts.walkers = (unsigned int)strtoul(optarg, 0, 10);
+      break;
+    }
+  }
+
+  if ((argc - optind) < (rederive ? 1 : 2)) {
     usage(argv[0]);
     return EXIT_FAILURE;
   }
 
-  if (ffmpeg_init()) {
+  if (!opts.psi_only && ffmpeg_init()) {
     dvbindex_log(
         DVBIDX_LOG_CAT_DVBINDEX, DVBIDX_LOG_SEVERITY_CRITICAL,
         "ffmpeg initialization failed. This is probably caused by your\n"
@@ -83,13 +254,19 @@ int main(int argc, char *argv[]) {
     goto beach;
   }
 
+  if (rederive && read_rederive(&db, &opts) != 0) {
+    rv = EXIT_FAILURE;
+    goto close;
+  }
+
   for (int i = optind + 1; i < argc; ++i) {
-    if (read_path(&db, argv[i]) != 0) {
+    if (read_path(&db, &opts, argv[i]) != 0) {
       rv = EXIT_FAILURE;
       break;
     }
   }
 
+close:
   db_export_close(&db);
 
 beach:
@@ -0,0 +1,147 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "pcr.h"
+
+/* the PCR base is a 33 bits counter. */
+#define PCR_WRAP ((INT64_C(1) << 33) * 300)
+/* TR 101 290 limits : 40ms between PCRs, 100ms between PCRs without a
+ * discontinuity_indicator, and 500ns of jitter. */
+#define PCR_REPETITION_MAX (PCR_CLOCK / 25)
+#define PCR_DISCONTINUITY_MAX (PCR_CLOCK / 10)
+#define PCR_ACCURACY_MAX_NS 500
+/* the PCRs needed for a line fitted through them to be trusted. */
+#define PCR_ACCURACY_MIN_PCRS 8
+
+static int ts_packet_has_adaptation_field(const uint8_t *packet) {
+  return (packet[3] & 0x20) && packet[4] > 0;
+}
+
+static int ts_packet_discontinuity(const uint8_t *packet) {
+  return ts_packet_has_adaptation_field(packet) && (packet[5] & 0x80);
+}
+
+int64_t ts_packet_pcr(const uint8_t *packet) {
+  if (!ts_packet_has_adaptation_field(packet) || packet[4] < 7 ||
+      !(packet[5] & 0x10)) {
+    return -1;
+  }
+  const uint8_t *p = packet + 6;
+  const int64_t base = ((int64_t)p[0] << 25) | (p[1] << 17) | (p[2] << 9) |
+                       (p[3] << 1) | (p[4] >> 7);
+  const int64_t ext = ((p[4] & 0x01) << 8) | p[5];
+  return base * 300 + ext;
+}
+
+int64_t pcr_delta(int64_t from, int64_t to) {
+  const int64_t delta = to - from;
+  return delta < 0 ? delta + PCR_WRAP : delta;
+}
+
+static void pcr_tracker_start_run(pcr_tracker *t) {
+  t->run_ticks = 0;
+  t->run_bytes = 0;
+  t->run_pcrs = 0;
+  t->run_mean_bytes = 0;
+  t->run_mean_ticks = 0;
+  t->run_m2_bytes = 0;
+  t->run_c_bytes_ticks = 0;
+}
+
+void pcr_tracker_init(pcr_tracker *t, uint16_t pid) {
+  t->last_offset = 0;
+  t->last_pcr = -1;
+  t->ticks = 0;
+  t->bytes = 0;
+  pcr_tracker_start_run(t);
+  t->discontinuities = 0;
+  t->pid = pid;
+}
+
+/* adds the PCR at the end of the run to the least squares fit, updated in the
+ * numerically stable way of Welford. */
+static void pcr_tracker_fit(pcr_tracker *t) {
+  ++t->run_pcrs;
+  const double dx = t->run_bytes - t->run_mean_bytes;
+  t->run_mean_bytes += dx / t->run_pcrs;
+  t->run_mean_ticks += (t->run_ticks - t->run_mean_ticks) / t->run_pcrs;
+  t->run_m2_bytes += dx * (t->run_bytes - t->run_mean_bytes);
+  t->run_c_bytes_ticks += dx * (t->run_ticks - t->run_mean_ticks);
+}
+
+/* the PCR is compared with the one expected at its offset on the line fitted
+ * through the previous ones, i.e. at the long-run rate since the last
+ * discontinuity. a rate taken from the last interval alone would carry the
+ * jitter of the PCR it ends with. */
+static int pcr_is_accurate(const pcr_tracker *t, int64_t delta, off_t bytes) {
+  if (t->run_pcrs < PCR_ACCURACY_MIN_PCRS || t->run_m2_bytes <= 0) {
+    return 1;
+  }
+  const double rate = t->run_c_bytes_ticks / t->run_m2_bytes;
+  const double expected =
+      t->run_mean_ticks +
+      rate * ((double)(t->run_bytes + bytes) - t->run_mean_bytes);
+  const double error_ns =
+      ((double)(t->run_ticks + delta) - expected) * 1e9 / PCR_CLOCK;
+  return error_ns <= PCR_ACCURACY_MAX_NS && error_ns >= -PCR_ACCURACY_MAX_NS;
+}
+
+int pcr_tracker_push(pcr_tracker *t, const uint8_t *packet, off_t offset) {
+  const int64_t pcr = ts_packet_pcr(packet);
+  if (pcr < 0) {
+    return 0;
+  }
+  int events = 0;
+  if (t->last_pcr >= 0) {
+    const int64_t delta = pcr_delta(t->last_pcr, pcr);
+    const off_t bytes = offset - t->last_offset;
+    const int signaled = ts_packet_discontinuity(packet);
+    if (!signaled && delta > PCR_DISCONTINUITY_MAX) {
+      events |= PCR_EVENT_UNSIGNALED_DISCONTINUITY;
+    }
+    if (signaled || delta > PCR_MAX_GAP) {
+      ++t->discontinuities;
+      pcr_tracker_start_run(t);
+    } else {
+      if (delta > PCR_REPETITION_MAX) {
+        events |= PCR_EVENT_REPETITION;
+      }
+      if (!pcr_is_accurate(t, delta, bytes)) {
+        events |= PCR_EVENT_INACCURATE;
+      }
+      t->ticks += delta;
+      t->bytes += bytes;
+      t->run_ticks += delta;
+      t->run_bytes += bytes;
+    }
+  }
+  pcr_tracker_fit(t);
+  t->last_pcr = pcr;
+  t->last_offset = offset;
+  return events;
+}
+
+double pcr_tracker_duration(const pcr_tracker *t) {
+  return t->ticks > 0 ? (double)t->ticks / PCR_CLOCK : -1;
+}
+
+int64_t pcr_tracker_bitrate(const pcr_tracker *t) {
+  if (t->ticks <= 0) {
+    return -1;
+  }
+  return (int64_t)((double)t->bytes * 8 * PCR_CLOCK / t->ticks);
+}
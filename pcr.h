@@ -0,0 +1,68 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef DVBINDEX_PCR_H
+#define DVBINDEX_PCR_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/* PCRs are expressed in units of the 27MHz system clock. */
+#define PCR_CLOCK 27000000
+/* ISO 13818-1 requires a PCR at least every 100ms. larger gaps are tolerated,
+ * since packets can be lost while recording, but anything above this is
+ * considered to be a discontinuity. */
+#define PCR_MAX_GAP (PCR_CLOCK)
+
+/* returns the PCR carried by the TS packet, or -1 if there's none. */
+int64_t ts_packet_pcr(const uint8_t *packet);
+/* the time elapsed between two PCRs, accounting for the wrap of the base. */
+int64_t pcr_delta(int64_t from, int64_t to);
+
+/* measures the time and the amount of data covered by the PCRs of a PID.
+ * the intervals around a discontinuity are left out of both. */
+typedef struct pcr_tracker_ {
+  off_t last_offset;
+  /* -1 until the first PCR is seen. */
+  int64_t last_pcr;
+  int64_t ticks;
+  off_t bytes;
+  /* since the last discontinuity : the PCRs are fitted with a line, whose
+   * slope is the long-run rate, and which tells the accuracy of each one. */
+  int64_t run_ticks;
+  off_t run_bytes;
+  uint32_t run_pcrs;
+  double run_mean_bytes;
+  double run_mean_ticks;
+  double run_m2_bytes;
+  double run_c_bytes_ticks;
+  uint32_t discontinuities;
+  uint16_t pid;
+} pcr_tracker;
+
+void pcr_tracker_init(pcr_tracker *t, uint16_t pid);
+/* the TR 101 290 PCR checks, returned by pcr_tracker_push(). */
+#define PCR_EVENT_REPETITION 0x01
+#define PCR_EVENT_UNSIGNALED_DISCONTINUITY 0x02
+#define PCR_EVENT_INACCURATE 0x04
+
+int pcr_tracker_push(pcr_tracker *t, const uint8_t *packet, off_t offset);
+/* returns -1 if the PCRs don't cover any measurable time. */
+double pcr_tracker_duration(const pcr_tracker *t);
+int64_t pcr_tracker_bitrate(const pcr_tracker *t);
+
+#endif
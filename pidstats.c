@@ -0,0 +1,142 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "pidstats.h"
+#include <stdlib.h>
+#include <string.h>
+
+int pid_stats_table_init(pid_stats_table *t) {
+  t->pids = calloc(TS_PID_COUNT, sizeof(*t->pids));
+  t->total_packets = 0;
+  return t->pids != 0;
+}
+
+void pid_stats_table_reset(pid_stats_table *t) {
+  if (t->pids) {
+    memset(t->pids, 0, TS_PID_COUNT * sizeof(*t->pids));
+  }
+  t->total_packets = 0;
+}
+
+void pid_stats_table_destroy(pid_stats_table *t) { free(t->pids); }
+
+static int cc_is_continuous(const pid_stats *s, const uint8_t *packet,
+                            int has_payload) {
+  const uint8_t cc = packet[3] & 0x0f;
+  const int has_adaptation_field = (packet[3] & 0x20) && packet[4] > 0;
+  if (has_adaptation_field && (packet[5] & 0x80)) {
+    /* discontinuity_indicator */
+    return 1;
+  }
+  if (!has_payload) {
+    /* the counter only increments with packets carrying a payload. */
+    return cc == s->last_cc;
+  }
+  /* a packet may be sent twice, with the same counter. */
+  return cc == ((s->last_cc + 1) & 0x0f) || cc == s->last_cc;
+}
+
+int pid_stats_table_push(pid_stats_table *t, const uint8_t *packet,
+                         off_t offset) {
+  if (!t->pids) {
+    return 0;
+  }
+  const uint16_t pid = ((packet[1] << 8) | packet[2]) & 0x1fff;
+  pid_stats *s = &t->pids[pid];
+  const int has_payload = packet[3] & 0x10;
+  int cc_error = 0;
+  ++t->total_packets;
+  if (s->packets == 0) {
+    s->first_offset = offset;
+  } else if (pid != TS_NULL_PID && !cc_is_continuous(s, packet, has_payload)) {
+    ++s->cc_errors;
+    cc_error = 1;
+  }
+  ++s->packets;
+  s->last_offset = offset;
+  s->last_cc = packet[3] & 0x0f;
+  if (has_payload) {
+    ++s->payload_packets;
+  }
+  if (packet[3] & 0x20) {
+    ++s->adaptation_packets;
+  }
+  if (packet[3] & 0xc0) {
+    ++s->scrambled_packets;
+  }
+  if (packet[1] & 0x40) {
+    ++s->unit_starts;
+  }
+  return cc_error;
+}
+
+void pid_bucket_batch_init(pid_bucket_batch *batch) {
+  vec_pid_bucket_init(&batch->buckets);
+  batch->mem_used = 0;
+}
+
+void pid_bucket_batch_clear(pid_bucket_batch *batch) {
+  batch->buckets.size = 0;
+  batch->mem_used = 0;
+}
+
+void pid_bucket_batch_destroy(pid_bucket_batch *batch) {
+  vec_pid_bucket_destroy(&batch->buckets);
+}
+
+static int pid_bucket_batch_add(pid_bucket_batch *batch, uint16_t pid,
+                                const pid_stats *s) {
+  pid_bucket *b = vec_pid_bucket_write(&batch->buckets);
+  if (!b) {
+    return 0;
+  }
+  b->second = s->bucket_second;
+  b->packets = s->bucket_packets;
+  b->pid = pid;
+  batch->mem_used += sizeof(*b);
+  return 1;
+}
+
+int pid_stats_table_count_second(pid_stats_table *t, pid_bucket_batch *batch,
+                                 uint16_t pid, int64_t second) {
+  if (!t->pids) {
+    return 0;
+  }
+  pid_stats *s = &t->pids[pid];
+  int added = 0;
+  if (s->bucket_packets && s->bucket_second != second) {
+    added = pid_bucket_batch_add(batch, pid, s);
+    s->bucket_packets = 0;
+  }
+  s->bucket_second = second;
+  ++s->bucket_packets;
+  return added;
+}
+
+void pid_stats_table_close_seconds(pid_stats_table *t,
+                                   pid_bucket_batch *batch) {
+  if (!t->pids) {
+    return;
+  }
+  for (unsigned int pid = 0; pid < TS_PID_COUNT; ++pid) {
+    pid_stats *s = &t->pids[pid];
+    if (s->bucket_packets) {
+      pid_bucket_batch_add(batch, pid, s);
+      s->bucket_packets = 0;
+    }
+  }
+}
@@ -0,0 +1,84 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef DVBINDEX_PIDSTATS_H
+#define DVBINDEX_PIDSTATS_H
+
+#include "vec.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define TS_PACKET_SIZE 188
+#define TS_PID_COUNT 8192
+#define TS_NULL_PID 0x1fff
+
+typedef struct pid_stats_ {
+  uint64_t packets;
+  uint64_t payload_packets;
+  uint64_t adaptation_packets;
+  uint64_t cc_errors;
+  uint64_t scrambled_packets;
+  uint64_t unit_starts;
+  off_t first_offset;
+  off_t last_offset;
+  /* the packets counted in the current second of the timeline. */
+  int64_t bucket_second;
+  uint32_t bucket_packets;
+  uint8_t last_cc;
+} pid_stats;
+
+/* the number of packets of a PID during one second of the file. */
+typedef struct pid_bucket_ {
+  int64_t second;
+  uint32_t packets;
+  uint16_t pid;
+} pid_bucket;
+VEC_DEFINE(pid_bucket)
+
+typedef struct pid_bucket_batch_ {
+  vec_pid_bucket buckets;
+  size_t mem_used;
+} pid_bucket_batch;
+
+void pid_bucket_batch_init(pid_bucket_batch *batch);
+void pid_bucket_batch_clear(pid_bucket_batch *batch);
+void pid_bucket_batch_destroy(pid_bucket_batch *batch);
+
+/* counters for every PID of a file, updated for each packet. */
+typedef struct pid_stats_table_ {
+  pid_stats *pids;
+  uint64_t total_packets;
+} pid_stats_table;
+
+int pid_stats_table_init(pid_stats_table *t);
+/* zeroes the counters for another file, keeping the allocation. */
+void pid_stats_table_reset(pid_stats_table *t);
+void pid_stats_table_destroy(pid_stats_table *t);
+/* returns 1 if the packet has a continuity counter error. */
+int pid_stats_table_push(pid_stats_table *t, const uint8_t *packet,
+                         off_t offset);
+/* counts a packet of the PID in the given second. returns 1 if this completed
+ * the previous second of the PID, which was added to the batch. */
+int pid_stats_table_count_second(pid_stats_table *t, pid_bucket_batch *batch,
+                                 uint16_t pid, int64_t second);
+/* adds the seconds still being counted to the batch, at the end of the file. */
+void pid_stats_table_close_seconds(pid_stats_table *t,
+                                   pid_bucket_batch *batch);
+
+#endif
@@ -0,0 +1,241 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include "rap.h"
+#include "pidstats.h"
+
+#define PES_HEADER_SIZE 9
+
+typedef enum rap_scanner_state_ {
+  /* waiting for the next PES packet. */
+  RAP_SCAN_IDLE,
+  RAP_SCAN_START_CODE,
+  /* reading the bytes following a picture start code. */
+  RAP_SCAN_PICTURE_HEADER
+} rap_scanner_state;
+
+void rap_batch_init(rap_batch *batch) {
+  vec_random_access_point_init(&batch->points);
+  batch->mem_used = 0;
+}
+
+void rap_batch_clear(rap_batch *batch) {
+  batch->points.size = 0;
+  batch->mem_used = 0;
+}
+
+void rap_batch_destroy(rap_batch *batch) {
+  vec_random_access_point_destroy(&batch->points);
+}
+
+int rap_codec_from_stream_type(uint8_t stream_type) {
+  switch (stream_type) {
+  case 0x01:
+  case 0x02:
+    return VIDEO_CODEC_MPEG2;
+  case 0x1b:
+    return VIDEO_CODEC_H264;
+  case 0x24:
+    return VIDEO_CODEC_HEVC;
+  }
+  return -1;
+}
+
+void rap_scanner_init(rap_scanner *s, uint16_t pid, video_codec codec) {
+  s->pes_offset = 0;
+  s->pes_pts = -1;
+  s->pictures = -1;
+  s->window = 0xffffffff;
+  s->pid = pid;
+  s->codec = codec;
+  s->state = RAP_SCAN_IDLE;
+  s->random_access_indicator = 0;
+}
+
+/* returns the number of bytes following the start code which are needed for
+ * telling the picture type, or -1 if the start code doesn't begin a picture. */
+static int picture_header_size(uint8_t codec, uint8_t start_code) {
+  switch (codec) {
+  case VIDEO_CODEC_MPEG2:
+    /* temporal_reference and picture_coding_type. */
+    return start_code == 0x00 ? 2 : -1;
+  case VIDEO_CODEC_H264: {
+    const int nal_type = start_code & 0x1f;
+    if (nal_type == 5) {
+      return 0;
+    }
+    /* enough for first_mb_in_slice and slice_type in most cases. */
+    return nal_type >= 1 && nal_type <= 4 ? 8 : -1;
+  }
+  case VIDEO_CODEC_HEVC:
+    return ((start_code >> 1) & 0x3f) <= 31 ? 0 : -1;
+  }
+  return -1;
+}
+
+/* reads an Exp-Golomb code, returning -1 if it doesn't fit in the buffer. */
+static int64_t read_ue(const uint8_t *buf, size_t size, size_t *bit) {
+  int zeros = 0;
+  while (*bit < size * 8 && !(buf[*bit / 8] & (0x80 >> (*bit % 8)))) {
+    ++zeros;
+    ++*bit;
+  }
+  if (zeros > 31 || *bit + zeros + 1 > size * 8) {
+    return -1;
+  }
+  int64_t value = 0;
+  for (int i = 0; i <= zeros; ++i, ++*bit) {
+    value = (value << 1) | ((buf[*bit / 8] >> (7 - *bit % 8)) & 1);
+  }
+  return value - 1;
+}
+
+static int picture_is_keyframe(const rap_scanner *s) {
+  switch (s->codec) {
+  case VIDEO_CODEC_MPEG2:
+    return ((s->header[1] >> 3) & 0x07) == 1;
+  case VIDEO_CODEC_H264: {
+    if ((s->start_code & 0x1f) == 5) {
+      return 1;
+    }
+    /* open GOPs start with a non-IDR I slice. */
+    size_t bit = 0;
+    if (read_ue(s->header, s->header_size, &bit) < 0) {
+      return 0;
+    }
+    const int64_t slice_type = read_ue(s->header, s->header_size, &bit);
+    return slice_type >= 0 && (slice_type % 5 == 2 || slice_type % 5 == 4);
+  }
+  case VIDEO_CODEC_HEVC: {
+    const int nal_type = (s->start_code >> 1) & 0x3f;
+    return nal_type >= 16 && nal_type <= 23;
+  }
+  }
+  return 0;
+}
+
+/* ends the scan of the current PES packet. */
+static int rap_scanner_finish(rap_scanner *s, rap_batch *batch, int picture,
+                              int keyframe) {
+  s->state = RAP_SCAN_IDLE;
+  if (!keyframe && !s->random_access_indicator) {
+    if (picture && s->pictures >= 0) {
+      ++s->pictures;
+    }
+    return 0;
+  }
+  random_access_point *p = vec_random_access_point_write(&batch->points);
+  if (!p) {
+    return 0;
+  }
+  p->file_offset = s->pes_offset;
+  p->pts = s->pes_pts;
+  p->pictures = s->pictures;
+  p->pid = s->pid;
+  p->random_access_indicator = s->random_access_indicator;
+  p->keyframe = keyframe;
+  batch->mem_used += sizeof(*p);
+  s->pictures = picture ? 1 : 0;
+  return 1;
+}
+
+static int rap_scanner_scan(rap_scanner *s, rap_batch *batch,
+                            const uint8_t *pos, const uint8_t *end) {
+  for (; pos < end && s->state != RAP_SCAN_IDLE; ++pos) {
+    if (s->state == RAP_SCAN_PICTURE_HEADER) {
+      s->header[s->header_size++] = *pos;
+      if (s->header_size == s->header_needed) {
+        return rap_scanner_finish(s, batch, 1, picture_is_keyframe(s));
+      }
+      continue;
+    }
+    if ((s->window & 0xffffff) == 0x000001) {
+      const int needed = picture_header_size(s->codec, *pos);
+      if (needed == 0) {
+        s->start_code = *pos;
+        s->header_size = 0;
+        return rap_scanner_finish(s, batch, 1, picture_is_keyframe(s));
+      } else if (needed > 0) {
+        s->start_code = *pos;
+        s->header_size = 0;
+        s->header_needed = needed;
+        s->state = RAP_SCAN_PICTURE_HEADER;
+      }
+    }
+    s->window = (s->window << 8) | *pos;
+  }
+  return 0;
+}
+
+static int64_t read_pes_timestamp(const uint8_t *p) {
+  return ((int64_t)((p[0] >> 1) & 0x07) << 30) | (p[1] << 22) |
+         ((p[2] >> 1) << 15) | (p[3] << 7) | (p[4] >> 1);
+}
+
+int rap_scanner_push(rap_scanner *s, rap_batch *batch, const uint8_t *packet,
+                     off_t offset) {
+  const int adaptation_field_control = (packet[3] >> 4) & 0x03;
+  const uint8_t *pos = packet + 4;
+  const uint8_t *end = packet + TS_PACKET_SIZE;
+  int random_access_indicator = 0;
+  if (adaptation_field_control & 0x02) {
+    const uint8_t length = packet[4];
+    if (length > TS_PACKET_SIZE - 5) {
+      return 0;
+    }
+    random_access_indicator = length > 0 && (packet[5] & 0x40);
+    pos += 1 + length;
+  }
+
+  int added = 0;
+  const int payload_unit_start = packet[1] & 0x40;
+  if (payload_unit_start) {
+    if (s->state != RAP_SCAN_IDLE) {
+      /* no picture found in the previous PES packet. */
+      added = rap_scanner_finish(s, batch, 0, 0);
+    }
+    s->pes_offset = offset;
+    s->pes_pts = -1;
+    s->random_access_indicator = random_access_indicator != 0;
+    s->window = 0xffffffff;
+    s->state = RAP_SCAN_START_CODE;
+  }
+  if (s->state == RAP_SCAN_IDLE) {
+    return added;
+  }
+  if (!(adaptation_field_control & 0x01) || (packet[3] & 0xc0)) {
+    /* only the adaptation field of a scrambled packet can be read. */
+    if (packet[3] & 0xc0) {
+      added |= rap_scanner_finish(s, batch, 0, 0);
+    }
+    return added;
+  }
+
+  if (payload_unit_start) {
+    if (end - pos < PES_HEADER_SIZE || pos[0] != 0 || pos[1] != 0 ||
+        pos[2] != 1 || (pos[6] & 0xc0) != 0x80 ||
+        end - pos < PES_HEADER_SIZE + pos[8]) {
+      return added | rap_scanner_finish(s, batch, 0, 0);
+    }
+    if ((pos[7] & 0x80) && pos[8] >= 5) {
+      s->pes_pts = read_pes_timestamp(pos + PES_HEADER_SIZE);
+    }
+    pos += PES_HEADER_SIZE + pos[8];
+  }
+  return added | rap_scanner_scan(s, batch, pos, end);
+}
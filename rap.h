@@ -0,0 +1,84 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#ifndef DVBINDEX_RAP_H
+#define DVBINDEX_RAP_H
+
+#include "vec.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef enum video_codec_ {
+  VIDEO_CODEC_MPEG2,
+  VIDEO_CODEC_H264,
+  VIDEO_CODEC_HEVC
+} video_codec;
+
+/* a PES packet starting a GOP : either its TS packet had the random access
+ * indicator set, or its first picture is an I picture, an IDR or an IRAP. */
+typedef struct random_access_point_ {
+  int64_t file_offset;
+  /* -1 when the PES packet has no PTS. */
+  int64_t pts;
+  /* the number of pictures since the previous point on the PID, -1 if this is
+   * the first one. */
+  int64_t pictures;
+  uint16_t pid;
+  uint8_t random_access_indicator;
+  uint8_t keyframe;
+} random_access_point;
+VEC_DEFINE(random_access_point)
+
+typedef struct rap_batch_ {
+  vec_random_access_point points;
+  size_t mem_used;
+} rap_batch;
+
+void rap_batch_init(rap_batch *batch);
+void rap_batch_clear(rap_batch *batch);
+void rap_batch_destroy(rap_batch *batch);
+
+/* follows the PES packets of a video PID, looking for the start code of the
+ * first picture of each one. */
+typedef struct rap_scanner_ {
+  off_t pes_offset;
+  int64_t pes_pts;
+  int64_t pictures;
+  /* the last bytes of the ES, for finding start codes split across packets. */
+  uint32_t window;
+  uint16_t pid;
+  uint8_t codec;
+  uint8_t state;
+  uint8_t random_access_indicator;
+  uint8_t start_code;
+  uint8_t header[8];
+  uint8_t header_size;
+  uint8_t header_needed;
+} rap_scanner;
+VEC_DEFINE(rap_scanner)
+
+/* returns -1 if the stream type is not a video type known to the scanner. */
+int rap_codec_from_stream_type(uint8_t stream_type);
+void rap_scanner_init(rap_scanner *s, uint16_t pid, video_codec codec);
+/* returns 1 if a random access point was added to the batch. */
+int rap_scanner_push(rap_scanner *s, rap_batch *batch, const uint8_t *packet,
+                     off_t offset);
+
+#endif
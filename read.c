@@ -19,20 +19,39 @@ Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define _XOPEN_SOURCE 500
 
 #include "read.h"
+#include "ait.h"
+#include "archive.h"
+#include "esparse.h"
 #include "export.h"
+#include "fileset.h"
 #include "log.h"
+#include "pcr.h"
+#include "pidstats.h"
+#include "rap.h"
+#include "scte35.h"
+#include "section.h"
+#include "si.h"
+#include "tr101290.h"
 #include "util.h"
 #include "vec.h"
+#include "walk.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include <dvbpsi/descriptor.h>
 #include <dvbpsi/dvbpsi.h>
 
+#include <dvbpsi/bat.h>
+#include <dvbpsi/cat.h>
 #include <dvbpsi/demux.h>
 #include <dvbpsi/nit.h>
 #include <dvbpsi/pat.h>
@@ -42,16 +61,12 @@ Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <arpa/inet.h> /* ntohs */
 #include <libavformat/avformat.h>
 
-#include <ftw.h>
-
 typedef dvbpsi_t *dvbpsi_t_p;
 VEC_DEFINE(dvbpsi_t_p)
 
-typedef dvbpsi_pmt_t *dvbpsi_pmt_t_p;
-VEC_DEFINE(dvbpsi_pmt_t_p)
-
-#define TS_PACKET_SIZE 188
 #define BUF_SIZE 4096
+/* for the reads which don't go through ffmpeg. */
+#define FEED_BUF_SIZE (TS_PACKET_SIZE * 1024)
 
 typedef void (*dvbpsi_detach_fn)(dvbpsi_t *p_dvbpsi);
 typedef void (*dvbpsi_detach_fn_w_tid)(dvbpsi_t *p_dvbpsi, uint8_t i_table_id,
@@ -61,7 +76,8 @@ typedef enum psi_monitor_type_ {
   PSI_MONITOR_PAT,
   PSI_MONITOR_PMT,
   PSI_MONITOR_SDT,
-  PSI_MONITOR_NIT
+  PSI_MONITOR_NIT,
+  PSI_MONITOR_CAT
 } psi_monitor_type;
 
 typedef struct psi_monitor_ {
@@ -75,6 +91,8 @@ typedef struct psi_monitor_ {
   uint16_t pid;
   uint16_t extension;
   uint8_t table_id;
+  /* the PCR at the start of the last section, for the repetition checks. */
+  int64_t last_section_pcr;
 } psi_monitor;
 VEC_DEFINE(psi_monitor)
 
@@ -108,7 +126,6 @@ static dvbpsi_t *create_dvbpsi_handle(void) {
 static void psi_monitor_simple_detach_init(psi_monitor *mon,
                                            dvbpsi_detach_fn detach,
                                            uint8_t table_id) {
-  mon->handle = create_dvbpsi_handle();
   mon->detach.d = detach;
   mon->table_id = table_id;
   mon->is_ready = 1;
@@ -117,7 +134,6 @@ static void psi_monitor_simple_detach_init(psi_monitor *mon,
 static void psi_monitor_ext_detach_preinit(psi_monitor *mon,
                                            dvbpsi_detach_fn_w_tid detach,
                                            uint8_t table_id) {
-  mon->handle = create_dvbpsi_handle();
   mon->detach.d_tid = detach;
   mon->table_id = table_id;
   mon->is_ready = 0;
@@ -135,6 +151,7 @@ static int psi_monitor_type_is_extended_detach(psi_monitor_type t) {
   switch (t) {
   case PSI_MONITOR_PAT:
   case PSI_MONITOR_PMT:
+  case PSI_MONITOR_CAT:
     return 0;
   case PSI_MONITOR_SDT:
   case PSI_MONITOR_NIT:
@@ -144,7 +161,8 @@ static int psi_monitor_type_is_extended_detach(psi_monitor_type t) {
   return -1;
 }
 
-static void psi_monitor_destroy(psi_monitor *mon) {
+/* the handle itself is kept for another monitor. */
+static void psi_monitor_detach(psi_monitor *mon) {
   if (psi_monitor_type_is_extended_detach(mon->type)) {
     if (mon->is_ready) {
       mon->detach.d_tid(mon->handle, mon->table_id, mon->extension);
@@ -153,14 +171,14 @@ static void psi_monitor_destroy(psi_monitor *mon) {
   } else {
     mon->detach.d(mon->handle);
   }
-  dvbpsi_delete(mon->handle);
 }
 
+#define PAT_PID 0
 #define PAT_TABLE_ID 0
 
 static void pat_monitor_init(psi_monitor *mon) {
   psi_monitor_simple_detach_init(mon, dvbpsi_pat_detach, PAT_TABLE_ID);
-  mon->pid = 0;
+  mon->pid = PAT_PID;
   mon->type = PSI_MONITOR_PAT;
 }
 
@@ -172,8 +190,18 @@ static void pmt_monitor_init(psi_monitor *mon, uint16_t pid) {
   mon->type = PSI_MONITOR_PMT;
 }
 
+#define CAT_PID 1
+#define CAT_TABLE_ID 1
+
+static void cat_monitor_init(psi_monitor *mon) {
+  psi_monitor_simple_detach_init(mon, dvbpsi_cat_detach, CAT_TABLE_ID);
+  mon->pid = CAT_PID;
+  mon->type = PSI_MONITOR_CAT;
+}
+
 #define SDT_PID 0x11
-#define SDT_CURRENT_TABLE_ID 0x42
+#define NIT_DEFAULT_PID 0x10
+#define BAT_TABLE_ID 0x4a
 
 static void sdt_monitor_init(psi_monitor *mon, uint8_t table_id,
                              uint16_t tsid) {
@@ -188,50 +216,379 @@ static void nit_monitor_init(psi_monitor *mon, uint8_t table_id, uint16_t pid) {
   mon->type = PSI_MONITOR_NIT;
 }
 
-typedef dvbpsi_sdt_t *dvbpsi_sdt_t_p;
-VEC_DEFINE(dvbpsi_sdt_t_p)
+/* the tables received from dvbpsi are deleted as soon as their rows are
+ * exported : only the information needed for discarding repetitions of the
+ * same table is retained. */
+typedef struct psi_table_version_ {
+  /* where the version was first seen, for the table_versions timeline. */
+  off_t first_offset;
+  int64_t first_pcr;
+  uint32_t id;
+  uint8_t table_id;
+  uint8_t version;
+  uint8_t current_next;
+  uint8_t has_version;
+} psi_table_version;
+VEC_DEFINE(psi_table_version)
+
+/* where the section 0 of a table last started with a new version. dvbpsi only
+ * delivers a table once its last section is complete, which can be packets
+ * later. */
+typedef struct psi_section_start_ {
+  off_t offset;
+  int64_t pcr;
+  uint16_t table_id_ext;
+  uint8_t table_id;
+  /* the version and current_next_indicator byte of the section header. */
+  uint8_t version;
+} psi_section_start;
+VEC_DEFINE(psi_section_start)
+
+VEC_DEFINE(section_reader)
+
+VEC_DEFINE(pcr_tracker)
+
+typedef struct probe_es_ {
+  uint16_t pid;
+  uint8_t is_video;
+} probe_es;
+VEC_DEFINE(probe_es)
+
+/* a PID of the PAT or of one of its PMTs which ffmpeg gets to see. */
+typedef struct ffmpeg_pid_ {
+  uint16_t program_number;
+  uint16_t pid;
+  /* the PMT itself, listed by the PAT. */
+  uint8_t is_pmt;
+} ffmpeg_pid;
+VEC_DEFINE(ffmpeg_pid)
 
 struct ts_file_read_ctx_;
+struct read_pool_;
 
 typedef struct {
+  struct read_pool_ *pool;
   db_export *db;
   const struct ts_file_read_ctx_ *file_ctx;
   sqlite3_int64 file_rowid;
   vec_psi_monitor psi_monitors;
   sqlite3_int64 pat_rowid;
-  dvbpsi_pat_t *current_pat;
-  vec_dvbpsi_pmt_t_p current_pmts;
-  vec_dvbpsi_sdt_t_p current_sdts;
-  dvbpsi_nit_t *current_nit;
+  psi_table_version current_pat;
+  vec_psi_table_version current_pmts;
+  /* SDTs are keyed by onid << 16 | tsid. */
+  vec_psi_table_version current_sdts;
+  vec_psi_table_version current_bats;
+  vec_psi_table_version other_sdts;
+  psi_table_version current_nit;
+  vec_psi_table_version other_nits;
+  psi_table_version current_cat;
+  vec_psi_section_start section_starts;
+  vec_section_reader section_readers;
+  section_set eit_sections;
+  eit_batch eit_events;
+  time_batch time_refs;
+  splice_batch splice_events;
+  section_set ait_sections;
+  ait_batch ait_applications;
+  /* one per video PID of the PMTs. */
+  vec_rap_scanner rap_scanners;
+  /* the audio and video ES of the current PMTs, for ending a fast probe. */
+  vec_probe_es probe_es;
+  /* with the native probe, one per audio and video PID of the PMTs.
+   * es_unknown is set when a PMT has an ES which might be audio or video, but
+   * which none of the parsers knows. */
+  int parse_es;
+  int es_unknown;
+  vec_es_parser es_parsers;
+  /* the PIDs ffmpeg gets to see once the PMTs of the PAT were all received :
+   * the PAT, the PMTs, their PCR PIDs and their ES which aren't known to only
+   * carry data. the bitmap is rebuilt from ffmpeg_es on every new PAT and PMT
+   * version. ffmpeg sees everything if some PID couldn't be recorded. */
+  vec_ffmpeg_pid ffmpeg_es;
+  uint8_t ffmpeg_pids[TS_PID_COUNT / 8];
+  int ffmpeg_pids_ready;
+  int ffmpeg_pids_lost;
+  /* file offset of the next packet start seen by ffmpeg. */
+  off_t ffmpeg_next_packet;
+  rap_batch random_access_points;
+  /* file offset of the packet currently being processed. */
+  off_t packet_offset;
+  /* PCRs are only followed on the first PID found carrying them, since the
+   * clocks of different programs have nothing in common. */
+  int64_t last_pcr;
+  int pcr_pid;
+  /* the time covered by the PCRs so far, without the discontinuities. the
+   * packets are counted per PID for each second of it. */
+  int64_t pcr_elapsed;
+  pid_bucket_batch pid_seconds;
+  /* the distinct sections of the file, unless they were archived already or
+   * are being read back from the archive. */
+  int archive_sections;
+  sqlite3_int64 archived_file_rowid;
+  section_set archived_keys;
+  section_archive archive;
+  /* one per distinct PCR PID of the PMTs. */
+  vec_pcr_tracker pcr_trackers;
+  pid_stats_table pid_stats;
+  tr101290_state tr101290;
+  size_t mem_used;
+  size_t mem_limit;
+  int mem_exceeded;
+  int has_pat;
+  int has_nit;
+  int has_cat;
   int has_file_rowid;
 } psi_parse_state;
 
+/* what outlives a single file : setting all of this up and tearing it down
+ * again dominates the time spent on directories of many small files. the
+ * containers of the parse state are only emptied between files. */
+typedef struct read_pool_ {
+  /* dvbpsi handles without any decoder attached. */
+  vec_dvbpsi_t_p idle_handles;
+  /* the AVIO buffer left by the previous file, which ffmpeg might have
+   * resized. */
+  uint8_t *avio_buffer;
+  int avio_buffer_size;
+  /* FEED_BUF_SIZE bytes, allocated on first use. */
+  uint8_t *feed_buffer;
+  psi_parse_state parse;
+} read_pool;
+
 typedef struct dvbpsi_read_state_ {
   uint8_t buf[TS_PACKET_SIZE];
   size_t buf_fill;
+  /* file position up to which the data has been read for dvbpsi. */
   off_t last_pos;
+  /* number of bytes handed to push_to_dvbpsi() so far. */
+  off_t pushed;
 } dvbpsi_read_state;
 
 typedef struct ts_file_read_ctx_ {
   FILE *file;
   const char *file_name;
   off_t file_size;
-  psi_parse_state dvbpsi_parse;
+  /* owned by the pool. */
+  psi_parse_state *dvbpsi_parse;
   dvbpsi_read_state dvbpsi_state;
 } ts_file_read_ctx;
 
-static int pat_is_same(const dvbpsi_pat_t *p1, const dvbpsi_pat_t *p2) {
-  return p1->b_current_next == p2->b_current_next &&
-         p1->i_ts_id == p2->i_ts_id && p1->i_version == p2->i_version;
+/* the real footprint of a dvbpsi handle depends on the decoders attached to it
+ * and the sections being gathered, none of which is visible from the outside.
+ * this is a rough upper bound for a single decoder with a full section. */
+#define PSI_MONITOR_MEM_ESTIMATE (sizeof(psi_monitor) + 4096)
+
+static int psi_mem_charge(psi_parse_state *state, size_t size) {
+  if (state->mem_exceeded) {
+    /* the rest of the PSI data is ignored, however small. */
+    return 0;
+  }
+  if (state->mem_limit && state->mem_used + size > state->mem_limit) {
+    if (!state->mem_exceeded) {
+      dvbindex_log(DVBIDX_LOG_CAT_DVBINDEX, DVBIDX_LOG_SEVERITY_WARNING,
+                   "%s : PSI state exceeds %zu bytes, ignoring the rest of "
+                   "the PSI data\n",
+                   file_name_from_path(state->file_ctx->file_name),
+                   state->mem_limit);
+      state->mem_exceeded = 1;
+    }
+    return 0;
+  }
+  state->mem_used += size;
+  return 1;
+}
+
+static void psi_mem_release(psi_parse_state *state, size_t size) {
+  assert(state->mem_used >= size);
+  state->mem_used -= size;
+}
+
+typedef void (*psi_flush_fn)(psi_parse_state *state);
+
+/* charges what a batch grew by with its last item. over the budget, nothing
+ * more is going to be parsed : the accounting is kept straight, and what's
+ * been gathered so far is written at once. returns 0 in that case. */
+static int psi_batch_grew(psi_parse_state *state, size_t before, size_t after,
+                          psi_flush_fn flush) {
+  if (psi_mem_charge(state, after - before)) {
+    return 1;
+  }
+  state->mem_used += after - before;
+  flush(state);
+  return 0;
+}
+
+static dvbpsi_t *psi_take_handle(psi_parse_state *state) {
+  vec_dvbpsi_t_p *idle = &state->pool->idle_handles;
+  if (idle->size) {
+    return idle->data[--idle->size];
+  }
+  return create_dvbpsi_handle();
+}
+
+static void psi_give_back_handle(psi_parse_state *state, dvbpsi_t *handle) {
+  if (!vec_dvbpsi_t_p_push(&state->pool->idle_handles, handle)) {
+    dvbpsi_delete(handle);
+  }
+}
+
+static psi_monitor *psi_new_monitor(psi_parse_state *state) {
+  if (!psi_mem_charge(state, PSI_MONITOR_MEM_ESTIMATE)) {
+    return 0;
+  }
+  dvbpsi_t *handle = psi_take_handle(state);
+  psi_monitor *mon = handle ? vec_psi_monitor_write(&state->psi_monitors) : 0;
+  if (!mon) {
+    if (handle) {
+      psi_give_back_handle(state, handle);
+    }
+    psi_mem_release(state, PSI_MONITOR_MEM_ESTIMATE);
+    return 0;
+  }
+  mon->handle = handle;
+  mon->last_section_pcr = -1;
+  return mon;
+}
+
+static void psi_release_monitor(psi_parse_state *state, psi_monitor *mon) {
+  psi_monitor_detach(mon);
+  psi_give_back_handle(state, mon->handle);
+  psi_mem_release(state, PSI_MONITOR_MEM_ESTIMATE);
+}
+
+static void ensure_file_has_rowid(psi_parse_state *handles) {
+  if (!handles->has_file_rowid) {
+    handles->file_rowid =
+        db_export_file(handles->db, handles->file_ctx->file_name,
+                       handles->file_ctx->file_size);
+    handles->has_file_rowid = 1;
+  }
+}
+
+static int psi_new_section_reader(psi_parse_state *state, uint16_t pid,
+                                  section_cbk cbk) {
+  if (!psi_mem_charge(state, sizeof(section_reader))) {
+    return 0;
+  }
+  section_reader *r = vec_section_reader_write(&state->section_readers);
+  if (!r) {
+    psi_mem_release(state, sizeof(section_reader));
+    return 0;
+  }
+  section_reader_init(r, pid, cbk, state);
+  return 1;
+}
+
+static void psi_ensure_section_reader(psi_parse_state *state, uint16_t pid,
+                                      section_cbk cbk) {
+  for (size_t i = 0; i < state->section_readers.size; ++i) {
+    if (state->section_readers.data[i].pid == pid) {
+      return;
+    }
+  }
+  psi_new_section_reader(state, pid, cbk);
+}
+
+static psi_table_version *psi_new_table_version(psi_parse_state *state,
+                                                vec_psi_table_version *vec) {
+  if (!psi_mem_charge(state, sizeof(psi_table_version))) {
+    return 0;
+  }
+  psi_table_version *v = vec_psi_table_version_write(vec);
+  if (!v) {
+    psi_mem_release(state, sizeof(psi_table_version));
+    return 0;
+  }
+  v->has_version = 0;
+  return v;
+}
+
+static void psi_table_version_export_span(psi_parse_state *state,
+                                          const psi_table_version *v,
+                                          off_t end_offset, int64_t end_pcr,
+                                          int superseded) {
+  table_version_span span;
+  span.first_byte_offset = v->first_offset;
+  span.end_byte_offset = end_offset;
+  span.first_pcr = v->first_pcr;
+  span.end_pcr = end_pcr;
+  span.table_id_ext = v->id & 0xffff;
+  span.table_id = v->table_id;
+  span.version = v->version;
+  span.current_next = v->current_next;
+  span.superseded = superseded;
+  ensure_file_has_rowid(state);
+  db_export_table_version(state->db, state->file_rowid, &span);
+}
+
+static psi_section_start *psi_seek_section_start(psi_parse_state *state,
+                                                 uint8_t table_id,
+                                                 uint16_t table_id_ext) {
+  for (size_t i = 0; i < state->section_starts.size; ++i) {
+    psi_section_start *s = &state->section_starts.data[i];
+    if (s->table_id == table_id && s->table_id_ext == table_id_ext) {
+      return s;
+    }
+  }
+  return 0;
+}
+
+/* records a newly accepted version, closing the span of the previous one. the
+ * low 16 bits of the id are the table_id_extension. */
+static void psi_table_version_set(psi_parse_state *state, psi_table_version *v,
+                                  uint8_t table_id, uint32_t id,
+                                  uint8_t version, bool current_next) {
+  const psi_section_start *start =
+      psi_seek_section_start(state, table_id, id & 0xffff);
+  const off_t first_offset = start ? start->offset : state->packet_offset;
+  const int64_t first_pcr = start ? start->pcr : state->last_pcr;
+  if (v->has_version) {
+    psi_table_version_export_span(state, v, first_offset, first_pcr, 1);
+  }
+  v->first_offset = first_offset;
+  v->first_pcr = first_pcr;
+  v->id = id;
+  v->table_id = table_id;
+  v->version = version;
+  v->current_next = current_next;
+  v->has_version = 1;
+}
+
+static void psi_table_versions_export_spans(psi_parse_state *state,
+                                            const vec_psi_table_version *vec) {
+  for (size_t i = 0; i < vec->size; ++i) {
+    if (vec->data[i].has_version) {
+      psi_table_version_export_span(state, &vec->data[i], state->packet_offset,
+                                    state->last_pcr, 0);
+    }
+  }
+}
+
+static int psi_table_version_is_same(const psi_table_version *v, uint32_t id,
+                                     uint8_t version, bool current_next) {
+  return v->id == id && v->version == version &&
+         v->current_next == current_next;
+}
+
+static psi_table_version *psi_seek_table_version(vec_psi_table_version *vec,
+                                                 uint32_t id) {
+  for (size_t i = 0; i < vec->size; ++i) {
+    if (vec->data[i].id == id)
+      return vec->data + i;
+  }
+  return 0;
 }
 
-static void psi_destroy_pmt(psi_parse_state *handles) {
+static void psi_destroy_pat_monitors(psi_parse_state *handles) {
+  /* PMT, SDT and NIT monitors are created anew for each PAT version, so the
+   * old ones must go away in order not to accumulate them on streams where
+   * the PAT changes often. */
   vec_psi_monitor new_monitors;
   vec_psi_monitor_init(&new_monitors);
   for (size_t i = 0; i < handles->psi_monitors.size; ++i) {
     psi_monitor *p = &handles->psi_monitors.data[i];
-    if (p->type == PSI_MONITOR_PMT) {
-      psi_monitor_destroy(p);
+    if (p->type != PSI_MONITOR_PAT && p->type != PSI_MONITOR_CAT) {
+      psi_release_monitor(handles, p);
     } else {
       psi_monitor *np = vec_psi_monitor_write(&new_monitors);
       *np = *p;
@@ -241,111 +598,359 @@ static void psi_destroy_pmt(psi_parse_state *handles) {
   handles->psi_monitors = new_monitors;
 }
 
-static void psi_destroy_pmt_data(psi_parse_state *handles) {
-  for (size_t i = 0; i < handles->current_pmts.size; ++i) {
-    dvbpsi_pmt_t *p = handles->current_pmts.data[i];
-    dvbpsi_pmt_delete(p);
+#define SDT_CURRENT_TABLE_ID 0x42
+#define SDT_OTHER_TABLE_ID 0x46
+
+static void psi_sdt_cbk(void *p_cb_data, dvbpsi_sdt_t *p_new_sdt) {
+  psi_parse_state *state = p_cb_data;
+  vec_psi_table_version *sdts = &state->current_sdts;
+  const uint32_t id =
+      ((uint32_t)p_new_sdt->i_network_id << 16) | p_new_sdt->i_extension;
+  if (p_new_sdt->i_table_id == SDT_OTHER_TABLE_ID) {
+    sdts = &state->other_sdts;
+  }
+  psi_table_version *sdt = psi_seek_table_version(sdts, id);
+  if (sdt && psi_table_version_is_same(sdt, id, p_new_sdt->i_version,
+                                       p_new_sdt->b_current_next)) {
+    dvbpsi_sdt_delete(p_new_sdt);
+    return;
+  }
+
+  if (!sdt) {
+    sdt = psi_new_table_version(state, sdts);
+  }
+  if (sdt) {
+    psi_table_version_set(state, sdt, p_new_sdt->i_table_id, id,
+                          p_new_sdt->i_version, p_new_sdt->b_current_next);
+    db_export_sdt(state->db, state->pat_rowid, p_new_sdt);
   }
+  dvbpsi_sdt_delete(p_new_sdt);
 }
 
-static int psi_seek_sdt_for_onid(vec_dvbpsi_sdt_t_p *sdts,
-                                 uint16_t network_id) {
-  for (size_t i = 0; i < sdts->size; ++i) {
-    if (sdts->data[i]->i_network_id == network_id)
-      return i;
+#define NIT_CURRENT_TABLE_ID 0x40
+#define NIT_OTHER_TABLE_ID 0x41
+
+static void psi_nit_other_cbk(psi_parse_state *state, dvbpsi_nit_t *p_new_nit) {
+  psi_table_version *nit =
+      psi_seek_table_version(&state->other_nits, p_new_nit->i_network_id);
+  if (nit && psi_table_version_is_same(nit, p_new_nit->i_network_id,
+                                       p_new_nit->i_version,
+                                       p_new_nit->b_current_next)) {
+    return;
   }
-  return -1;
-}
 
-static int should_discard_sdt(const dvbpsi_sdt_t *p1, const dvbpsi_sdt_t *p2) {
-  return p1->i_version == p2->i_version &&
-         p1->b_current_next == p2->b_current_next;
+  if (!nit) {
+    nit = psi_new_table_version(state, &state->other_nits);
+  }
+  if (nit) {
+    psi_table_version_set(state, nit, p_new_nit->i_table_id,
+                          p_new_nit->i_network_id, p_new_nit->i_version,
+                          p_new_nit->b_current_next);
+    db_export_nit(state->db, state->file_rowid, p_new_nit);
+  }
 }
 
-static void psi_sdt_cbk(void *p_cb_data, dvbpsi_sdt_t *p_new_sdt) {
+static void psi_nit_cbk(void *p_cb_data, dvbpsi_nit_t *p_new_nit) {
   psi_parse_state *state = p_cb_data;
-  int sdt_idx =
-      psi_seek_sdt_for_onid(&state->current_sdts, p_new_sdt->i_network_id);
-  if (sdt_idx != -1 &&
-      should_discard_sdt(state->current_sdts.data[sdt_idx], p_new_sdt)) {
-    dvbpsi_sdt_delete(p_new_sdt);
+  if (p_new_nit->i_table_id == NIT_OTHER_TABLE_ID) {
+    psi_nit_other_cbk(state, p_new_nit);
+  } else if (!state->has_nit ||
+             !psi_table_version_is_same(
+                 &state->current_nit, p_new_nit->i_network_id,
+                 p_new_nit->i_version, p_new_nit->b_current_next)) {
+    psi_table_version_set(state, &state->current_nit, p_new_nit->i_table_id,
+                          p_new_nit->i_network_id, p_new_nit->i_version,
+                          p_new_nit->b_current_next);
+    state->has_nit = 1;
+    db_export_nit(state->db, state->file_rowid, p_new_nit);
+  }
+  dvbpsi_nit_delete(p_new_nit);
+}
+
+#define PCR_PID_NONE 0x1fff
+
+static void psi_track_pcr_pid(psi_parse_state *state, uint16_t pcr_pid) {
+  if (pcr_pid == PCR_PID_NONE) {
+    return;
+  }
+  for (size_t i = 0; i < state->pcr_trackers.size; ++i) {
+    if (state->pcr_trackers.data[i].pid == pcr_pid) {
+      return;
+    }
+  }
+  if (!psi_mem_charge(state, sizeof(pcr_tracker))) {
+    return;
+  }
+  pcr_tracker *t = vec_pcr_tracker_write(&state->pcr_trackers);
+  if (t) {
+    pcr_tracker_init(t, pcr_pid);
   } else {
-    if (sdt_idx != -1) {
-      state->current_sdts.data[sdt_idx] = p_new_sdt;
-    } else {
-      vec_dvbpsi_sdt_t_p_push(&state->current_sdts, p_new_sdt);
+    psi_mem_release(state, sizeof(pcr_tracker));
+  }
+}
+
+/* the random access points of the video PIDs are gathered in the same pass,
+ * with a scanner created the first time a PMT announces the PID. */
+static void psi_scan_video_pids(psi_parse_state *state,
+                                const dvbpsi_pmt_t *pmt) {
+  for (const dvbpsi_pmt_es_t *es = pmt->p_first_es; es; es = es->p_next) {
+    const int codec = rap_codec_from_stream_type(es->i_type);
+    if (codec < 0) {
+      continue;
+    }
+    int has_scanner = 0;
+    for (size_t i = 0; i < state->rap_scanners.size; ++i) {
+      if (state->rap_scanners.data[i].pid == es->i_pid) {
+        has_scanner = 1;
+        break;
+      }
+    }
+    if (!has_scanner && psi_mem_charge(state, sizeof(rap_scanner))) {
+      rap_scanner *s = vec_rap_scanner_write(&state->rap_scanners);
+      if (s) {
+        rap_scanner_init(s, es->i_pid, (video_codec)codec);
+      } else {
+        psi_mem_release(state, sizeof(rap_scanner));
+      }
+    }
+  }
+}
+
+/* the tag of the descriptor telling the codec of PES private data. */
+static uint8_t es_dvb_audio_tag(const dvbpsi_pmt_es_t *es) {
+  for (const dvbpsi_descriptor_t *dr = es->p_first_descriptor; dr;
+       dr = dr->p_next) {
+    switch (dr->i_tag) {
+    case 0x6a: /* AC-3 */
+    case 0x7a: /* E-AC-3 */
+    case 0x7b: /* DTS */
+    case 0x7c: /* AAC */
+      return dr->i_tag;
     }
-    db_export_sdt(state->db, state->pat_rowid, p_new_sdt);
   }
+  return 0;
 }
 
-static int should_discard_nit(const dvbpsi_nit_t *current_nit,
-                              const dvbpsi_nit_t *new_nit) {
-  return current_nit->i_network_id == new_nit->i_network_id
-      && current_nit->i_version == new_nit->i_version
-      && current_nit->b_current_next == new_nit->b_current_next;
+static int es_is_audio(const dvbpsi_pmt_es_t *es) {
+  const int codec = es_codec_from_stream_type(es->i_type, es_dvb_audio_tag(es));
+  return codec >= 0 && es_codec_is_audio((es_codec)codec);
 }
 
-static void psi_nit_cbk(void *p_cb_data, dvbpsi_nit_t *p_new_nit) {
-  psi_parse_state *state = p_cb_data;
-  if(state->current_nit && should_discard_nit(state->current_nit, p_new_nit)) {
-    dvbpsi_nit_delete(p_new_nit);
+static void psi_wait_for_pmt_es(psi_parse_state *state,
+                                const dvbpsi_pmt_t *pmt) {
+  for (const dvbpsi_pmt_es_t *es = pmt->p_first_es; es; es = es->p_next) {
+    const int is_video = rap_codec_from_stream_type(es->i_type) >= 0;
+    if (!is_video && !es_is_audio(es)) {
+      continue;
+    }
+    int known = 0;
+    for (size_t i = 0; i < state->probe_es.size; ++i) {
+      if (state->probe_es.data[i].pid == es->i_pid) {
+        known = 1;
+        break;
+      }
+    }
+    if (!known && psi_mem_charge(state, sizeof(probe_es))) {
+      probe_es *p = vec_probe_es_write(&state->probe_es);
+      if (p) {
+        p->pid = es->i_pid;
+        p->is_video = is_video;
+      } else {
+        psi_mem_release(state, sizeof(probe_es));
+      }
+    }
+  }
+}
+
+static void psi_allow_ffmpeg_pid(psi_parse_state *state, uint16_t pid) {
+  state->ffmpeg_pids[pid >> 3] |= (uint8_t)(1 << (pid & 7));
+}
+
+static int psi_ffmpeg_pid_allowed(const psi_parse_state *state, uint16_t pid) {
+  return state->ffmpeg_pids[pid >> 3] & (1 << (pid & 7));
+}
+
+static void psi_rebuild_ffmpeg_pids(psi_parse_state *state) {
+  memset(state->ffmpeg_pids, 0, sizeof(state->ffmpeg_pids));
+  psi_allow_ffmpeg_pid(state, PAT_PID);
+  for (size_t i = 0; i < state->ffmpeg_es.size; ++i) {
+    psi_allow_ffmpeg_pid(state, state->ffmpeg_es.data[i].pid);
+  }
+}
+
+static void psi_add_ffmpeg_pid(psi_parse_state *state, uint16_t program_number,
+                               uint16_t pid, int is_pmt) {
+  ffmpeg_pid *p = psi_mem_charge(state, sizeof(ffmpeg_pid))
+                      ? vec_ffmpeg_pid_write(&state->ffmpeg_es)
+                      : 0;
+  if (!p) {
+    state->ffmpeg_pids_lost = 1;
     return;
   }
+  p->program_number = program_number;
+  p->pid = pid;
+  p->is_pmt = (uint8_t)is_pmt;
+}
 
-  state->current_nit = p_new_nit;
-  db_export_nit(state->db, state->file_rowid, p_new_nit);
+/* the PIDs of a previous version of the PMT are hidden again, unless the new
+ * one still has them. */
+static void psi_set_ffmpeg_pmt_pids(psi_parse_state *state,
+                                    const dvbpsi_pmt_t *pmt) {
+  vec_ffmpeg_pid *pids = &state->ffmpeg_es;
+  size_t kept = 0;
+  for (size_t i = 0; i < pids->size; ++i) {
+    const ffmpeg_pid *p = pids->data + i;
+    if (!p->is_pmt && p->program_number == pmt->i_program_number) {
+      psi_mem_release(state, sizeof(ffmpeg_pid));
+    } else {
+      pids->data[kept++] = *p;
+    }
+  }
+  pids->size = kept;
+  if (pmt->i_pcr_pid != PCR_PID_NONE) {
+    psi_add_ffmpeg_pid(state, pmt->i_program_number, pmt->i_pcr_pid, 0);
+  }
+  for (const dvbpsi_pmt_es_t *es = pmt->p_first_es; es; es = es->p_next) {
+    if (es_is_audio(es) || !es_stream_type_is_data(es->i_type)) {
+      psi_add_ffmpeg_pid(state, pmt->i_program_number, es->i_pid, 0);
+    }
+  }
+  psi_rebuild_ffmpeg_pids(state);
 }
 
-static dvbpsi_pmt_t_p *get_program_pmt(vec_dvbpsi_pmt_t_p *pmts,
-                                       uint16_t pgmno) {
-  for (size_t i = 0; i < pmts->size; ++i) {
-    if (pmts->data[i]->i_program_number == pgmno) {
-      return &pmts->data[i];
+/* the native probe parses the headers of the audio and video ES itself. */
+static void psi_parse_es_pids(psi_parse_state *state, const dvbpsi_pmt_t *pmt) {
+  for (const dvbpsi_pmt_es_t *es = pmt->p_first_es; es; es = es->p_next) {
+    const int codec =
+        es_codec_from_stream_type(es->i_type, es_dvb_audio_tag(es));
+    if (codec < 0) {
+      if (!es_stream_type_is_data(es->i_type)) {
+        state->es_unknown = 1;
+      }
+      continue;
+    }
+    int has_parser = 0;
+    for (size_t i = 0; i < state->es_parsers.size; ++i) {
+      if (state->es_parsers.data[i].pid == es->i_pid) {
+        has_parser = 1;
+        break;
+      }
+    }
+    if (!has_parser && psi_mem_charge(state, sizeof(es_parser))) {
+      es_parser *p = vec_es_parser_write(&state->es_parsers);
+      if (p) {
+        es_parser_init(p, es->i_pid, (es_codec)codec);
+      } else {
+        psi_mem_release(state, sizeof(es_parser));
+      }
     }
   }
-  dvbpsi_pmt_t_p *rv = vec_dvbpsi_pmt_t_p_write(pmts);
-  *rv = 0;
-  return rv;
 }
 
-static int should_discard_pmt(const dvbpsi_pmt_t *curpmt,
-                              const dvbpsi_pmt_t *newpmt) {
-  return curpmt->i_version == newpmt->i_version &&
-         curpmt->b_current_next == newpmt->b_current_next;
+static void psi_scte35_section_cbk(void *cbk_data, uint16_t pid,
+                                   const uint8_t *section, size_t size,
+                                   int64_t offset, int crc_ok);
+static void psi_ait_section_cbk(void *cbk_data, uint16_t pid,
+                                const uint8_t *section, size_t size,
+                                int64_t offset, int crc_ok);
+static void psi_crc_section_cbk(void *cbk_data, uint16_t pid,
+                                const uint8_t *section, size_t size,
+                                int64_t offset, int crc_ok);
+
+/* the private sections of the SCTE-35 and AIT PIDs are read in the same pass,
+ * with a section reader created the first time a PMT announces the PID. */
+static void psi_read_private_section_pids(psi_parse_state *state,
+                                          const dvbpsi_pmt_t *pmt) {
+  for (const dvbpsi_pmt_es_t *es = pmt->p_first_es; es; es = es->p_next) {
+    section_cbk cbk;
+    if (es->i_type == SCTE35_STREAM_TYPE) {
+      cbk = psi_scte35_section_cbk;
+    } else if (es->i_type == AIT_STREAM_TYPE) {
+      cbk = psi_ait_section_cbk;
+    } else {
+      continue;
+    }
+    psi_ensure_section_reader(state, es->i_pid, cbk);
+  }
 }
 
 static void psi_pmt_cbk(void *p_cb_data, dvbpsi_pmt_t *p_new_pmt) {
   psi_parse_state *ctx = p_cb_data;
-  dvbpsi_pmt_t_p *pmt =
-      get_program_pmt(&ctx->current_pmts, p_new_pmt->i_program_number);
-
-  if (*pmt && should_discard_pmt(*pmt, p_new_pmt)) {
+  psi_table_version *pmt = psi_seek_table_version(
+      &ctx->current_pmts, p_new_pmt->i_program_number);
+  if (pmt && psi_table_version_is_same(pmt, p_new_pmt->i_program_number,
+                                       p_new_pmt->i_version,
+                                       p_new_pmt->b_current_next)) {
     dvbpsi_pmt_delete(p_new_pmt);
-  } else {
-    if (*pmt) {
-      dvbpsi_pmt_delete(*pmt);
+    return;
+  }
+
+  if (!pmt) {
+    pmt = psi_new_table_version(ctx, &ctx->current_pmts);
+  }
+  if (pmt) {
+    psi_table_version_set(ctx, pmt, PMT_TABLE_ID, p_new_pmt->i_program_number,
+                          p_new_pmt->i_version, p_new_pmt->b_current_next);
+    db_export_pmt(ctx->db, ctx->file_rowid, ctx->pat_rowid, p_new_pmt);
+    psi_track_pcr_pid(ctx, p_new_pmt->i_pcr_pid);
+    psi_read_private_section_pids(ctx, p_new_pmt);
+    psi_scan_video_pids(ctx, p_new_pmt);
+    psi_wait_for_pmt_es(ctx, p_new_pmt);
+    psi_set_ffmpeg_pmt_pids(ctx, p_new_pmt);
+    if (ctx->parse_es) {
+      psi_parse_es_pids(ctx, p_new_pmt);
     }
-    *pmt = p_new_pmt;
-    db_export_pmt(ctx->db, ctx->pat_rowid, p_new_pmt);
   }
+  dvbpsi_pmt_delete(p_new_pmt);
+}
+
+static void psi_bat_cbk(void *p_cb_data, dvbpsi_bat_t *p_new_bat) {
+  psi_parse_state *state = p_cb_data;
+  psi_table_version *bat =
+      psi_seek_table_version(&state->current_bats, p_new_bat->i_extension);
+  if (bat && psi_table_version_is_same(bat, p_new_bat->i_extension,
+                                       p_new_bat->i_version,
+                                       p_new_bat->b_current_next)) {
+    dvbpsi_bat_delete(p_new_bat);
+    return;
+  }
+
+  if (!bat) {
+    bat = psi_new_table_version(state, &state->current_bats);
+  }
+  if (bat) {
+    psi_table_version_set(state, bat, BAT_TABLE_ID, p_new_bat->i_extension,
+                          p_new_bat->i_version, p_new_bat->b_current_next);
+    ensure_file_has_rowid(state);
+    db_export_bat(state->db, state->file_rowid, p_new_bat);
+  }
+  dvbpsi_bat_delete(p_new_bat);
 }
 
 static void psi_push_new_pmt(psi_parse_state *handles,
                              const struct dvbpsi_pat_program_s *program) {
-  psi_monitor *p = vec_psi_monitor_write(&handles->psi_monitors);
-  pmt_monitor_init(p, program->i_pid);
-  dvbpsi_pmt_attach(p->handle, program->i_number, psi_pmt_cbk, handles);
+  psi_monitor *p = psi_new_monitor(handles);
+  if (p) {
+    pmt_monitor_init(p, program->i_pid);
+    p->extension = program->i_number;
+    dvbpsi_pmt_attach(p->handle, program->i_number, psi_pmt_cbk, handles);
+  }
 }
 
 static void psi_sdt_demux_cbk(dvbpsi_t *handle, uint8_t table_id, uint16_t tsid,
                               void *p_cb_data) {
   psi_parse_state *handles = p_cb_data;
-  if (table_id == SDT_CURRENT_TABLE_ID &&
-      tsid == handles->current_pat->i_ts_id) {
+  if (table_id == SDT_CURRENT_TABLE_ID && tsid == handles->current_pat.id) {
     /* dvbpsi will return an error if there's already a callback associated
      * with the same table_id/tsid combination, which suits us just fine. */
     dvbpsi_sdt_attach(handle, table_id, tsid, psi_sdt_cbk, handles);
+  } else if (table_id == SDT_OTHER_TABLE_ID) {
+    /* SDT-other tables describe the services of the other transport streams
+     * of the network, one subtable per tsid. */
+    dvbpsi_sdt_attach(handle, table_id, tsid, psi_sdt_cbk, handles);
+  } else if (table_id == BAT_TABLE_ID) {
+    /* BATs share the PID with SDTs, and the extension is the bouquet_id. */
+    dvbpsi_bat_attach(handle, table_id, tsid, psi_bat_cbk, handles);
   }
 }
 
@@ -358,8 +963,6 @@ static psi_monitor *vec_psi_monitor_search(vec_psi_monitor *vec,
   return 0;
 }
 
-#define NIT_CURRENT_TABLE_ID 0x40
-
 static void psi_nit_demux_cbk(dvbpsi_t *handle, uint8_t table_id,
                               uint16_t network_id, void *p_cb_data) {
   psi_parse_state *handles = p_cb_data;
@@ -370,129 +973,984 @@ static void psi_nit_demux_cbk(dvbpsi_t *handle, uint8_t table_id,
     nit_mon->extension = network_id;
     nit_mon->is_ready = 1;
     dvbpsi_nit_attach(handle, table_id, network_id, psi_nit_cbk, handles);
+  } else if (table_id == NIT_OTHER_TABLE_ID) {
+    /* the subtables are all released along with the demux of the monitor. */
+    dvbpsi_nit_attach(handle, table_id, network_id, psi_nit_cbk, handles);
   }
 }
 
-static void ensure_file_has_rowid(psi_parse_state *handles) {
-  if (!handles->has_file_rowid) {
-    handles->file_rowid =
-        db_export_file(handles->db, handles->file_ctx->file_name,
-                       handles->file_ctx->file_size);
-    handles->has_file_rowid = 1;
+static int pat_has_pid(const dvbpsi_pat_t *pat, uint16_t pid) {
+  for (const struct dvbpsi_pat_program_s *program = pat->p_first_program;
+       program; program = program->p_next) {
+    if (program->i_pid == pid) {
+      return 1;
+    }
   }
+  return 0;
 }
 
-#define NIT_DEFAULT_PID 0x10
+/* like the monitors, the readers of the PMT PIDs which aren't in the new PAT
+ * would otherwise accumulate on streams where the PAT changes often. */
+static void psi_drop_pat_section_readers(psi_parse_state *handles,
+                                         const dvbpsi_pat_t *new_pat) {
+  vec_section_reader *readers = &handles->section_readers;
+  size_t kept = 0;
+  for (size_t i = 0; i < readers->size; ++i) {
+    const section_reader *r = readers->data + i;
+    const int fixed = r->pid == PAT_PID || r->pid == CAT_PID ||
+                      r->pid == NIT_DEFAULT_PID || r->pid == SDT_PID;
+    if (r->cbk == psi_crc_section_cbk && !fixed &&
+        !pat_has_pid(new_pat, r->pid)) {
+      psi_mem_release(handles, sizeof(section_reader));
+    } else {
+      if (kept != i) {
+        readers->data[kept] = *r;
+      }
+      ++kept;
+    }
+  }
+  readers->size = kept;
+}
 
 static void psi_new_pat_received(psi_parse_state *handles,
                                  dvbpsi_pat_t *new_pat) {
   struct dvbpsi_pat_program_s *program = new_pat->p_first_program;
-  psi_destroy_pmt(handles);
+  psi_destroy_pat_monitors(handles);
+  psi_drop_pat_section_readers(handles, new_pat);
+  /* ffmpeg sees everything again until the PMTs of this PAT are received. */
+  handles->ffmpeg_pids_ready = 0;
+  psi_mem_release(handles, sizeof(ffmpeg_pid) * handles->ffmpeg_es.size);
+  handles->ffmpeg_es.size = 0;
   uint16_t nit_pid = NIT_DEFAULT_PID;
   while (program) {
     if (program->i_number == 0) {
       nit_pid = program->i_pid;
     } else {
       psi_push_new_pmt(handles, program);
+      psi_add_ffmpeg_pid(handles, program->i_number, program->i_pid, 1);
     }
+    psi_ensure_section_reader(handles, program->i_pid, psi_crc_section_cbk);
     program = program->p_next;
   }
-  dvbpsi_pat_delete(handles->current_pat);
+  psi_rebuild_ffmpeg_pids(handles);
   ensure_file_has_rowid(handles);
-  handles->current_pat = new_pat;
+  psi_table_version_set(handles, &handles->current_pat, PAT_TABLE_ID,
+                        new_pat->i_ts_id, new_pat->i_version,
+                        new_pat->b_current_next);
+  handles->has_pat = 1;
   handles->pat_rowid = db_export_pat(handles->db, handles->file_rowid, new_pat);
-  psi_monitor *sdt_mon = vec_psi_monitor_write(&handles->psi_monitors);
-  sdt_monitor_init(sdt_mon, SDT_CURRENT_TABLE_ID, new_pat->i_ts_id);
-  dvbpsi_AttachDemux(sdt_mon->handle, psi_sdt_demux_cbk, handles);
-  psi_monitor *nit_mon = vec_psi_monitor_write(&handles->psi_monitors);
-  nit_monitor_init(nit_mon, NIT_CURRENT_TABLE_ID, nit_pid);
-  dvbpsi_AttachDemux(nit_mon->handle, psi_nit_demux_cbk, handles);
+  psi_monitor *sdt_mon = psi_new_monitor(handles);
+  if (sdt_mon) {
+    sdt_monitor_init(sdt_mon, SDT_CURRENT_TABLE_ID, new_pat->i_ts_id);
+    dvbpsi_AttachDemux(sdt_mon->handle, psi_sdt_demux_cbk, handles);
+  }
+  psi_monitor *nit_mon = psi_new_monitor(handles);
+  if (nit_mon) {
+    nit_monitor_init(nit_mon, NIT_CURRENT_TABLE_ID, nit_pid);
+    dvbpsi_AttachDemux(nit_mon->handle, psi_nit_demux_cbk, handles);
+  }
+}
+
+static void psi_cat_cbk(void *p_cb_data, dvbpsi_cat_t *p_new_cat) {
+  psi_parse_state *state = p_cb_data;
+  /* the CAT has no table_id_extension, so the id is always 0. */
+  if (!state->has_cat ||
+      !psi_table_version_is_same(&state->current_cat, 0, p_new_cat->i_version,
+                                 p_new_cat->b_current_next)) {
+    psi_table_version_set(state, &state->current_cat, CAT_TABLE_ID, 0,
+                          p_new_cat->i_version, p_new_cat->b_current_next);
+    state->has_cat = 1;
+    ensure_file_has_rowid(state);
+    db_export_cat(state->db, state->file_rowid, p_new_cat);
+  }
+  dvbpsi_cat_delete(p_new_cat);
 }
 
 static void psi_pat_cbk(void *p_cb_data, dvbpsi_pat_t *p_new_pat) {
   psi_parse_state *handles = p_cb_data;
-  if (!handles->current_pat || !pat_is_same(handles->current_pat, p_new_pat)) {
+  if (!handles->has_pat ||
+      !psi_table_version_is_same(&handles->current_pat, p_new_pat->i_ts_id,
+                                 p_new_pat->i_version,
+                                 p_new_pat->b_current_next)) {
     psi_new_pat_received(handles, p_new_pat);
-  } else {
-    dvbpsi_pat_delete(p_new_pat);
   }
+  dvbpsi_pat_delete(p_new_pat);
 }
 
-static void psi_destroy_sdt_data(vec_dvbpsi_sdt_t_p *sdts) {
-  for (size_t i = 0; i < sdts->size; ++i) {
-    dvbpsi_sdt_delete(sdts->data[i]);
+/* flushing the batch once it holds this many events keeps the memory used for
+ * it bounded, while still inserting lots of rows per transaction. */
+#define EIT_BATCH_MAX_EVENTS 4096
+
+static void psi_flush_eit_events(psi_parse_state *state) {
+  if (state->eit_events.sections.size == 0) {
+    return;
   }
+  ensure_file_has_rowid(state);
+  db_export_eit_batch(state->db, state->file_rowid, &state->eit_events);
+  psi_mem_release(state, state->eit_events.mem_used);
+  eit_batch_clear(&state->eit_events);
 }
 
-static void psi_handle_vec_init(psi_parse_state *handles, db_export *db) {
-  vec_psi_monitor_init(&handles->psi_monitors);
-  psi_monitor *m = vec_psi_monitor_write(&handles->psi_monitors);
-  pat_monitor_init(m);
-  dvbpsi_pat_attach(m->handle, psi_pat_cbk, handles);
-  handles->current_pat = 0;
-  handles->db = db;
-  handles->has_file_rowid = 0;
-  vec_dvbpsi_pmt_t_p_init(&handles->current_pmts);
-  vec_dvbpsi_sdt_t_p_init(&handles->current_sdts);
-  handles->current_nit = 0;
+static int psi_section_is_new(psi_parse_state *state, section_set *set,
+                              uint64_t key) {
+  size_t growth = section_set_growth(set);
+  if (growth && !psi_mem_charge(state, growth)) {
+    return 0;
+  }
+  return section_set_insert(set, key);
 }
 
-static void psi_handle_vec_destroy(psi_parse_state *handles) {
-  if (handles->current_pat) {
-    dvbpsi_pat_delete(handles->current_pat);
-  }
-  if (handles->current_nit) {
-    dvbpsi_nit_delete(handles->current_nit);
+#define SECTION_ARCHIVE_MAX_SECTIONS 4096
+
+static void psi_flush_section_archive(psi_parse_state *state) {
+  if (state->archive.sections.size == 0) {
+    return;
   }
-  psi_destroy_pmt_data(handles);
-  vec_dvbpsi_pmt_t_p_destroy(&handles->current_pmts);
-  psi_destroy_sdt_data(&handles->current_sdts);
-  vec_dvbpsi_sdt_t_p_destroy(&handles->current_sdts);
-  for (size_t i = 0; i < handles->psi_monitors.size; ++i) {
-    psi_monitor_destroy(&handles->psi_monitors.data[i]);
+  if (state->archived_file_rowid < 0) {
+    state->archived_file_rowid =
+        db_export_archived_file(state->db, state->file_ctx->file_name,
+                                state->file_ctx->file_size);
   }
-  vec_psi_monitor_destroy(&handles->psi_monitors);
+  db_export_section_archive(state->db, state->archived_file_rowid,
+                            &state->archive);
+  psi_mem_release(state, state->archive.mem_used);
+  section_archive_clear(&state->archive);
 }
 
-static uint16_t ts_extract_pid(const uint8_t *buf) {
-  uint16_t rv;
-  memcpy(&rv, buf + 1, sizeof(rv));
-  return htons(rv) & 0x1fff;
-}
+/* called for every complete section with a valid CRC, on all the PIDs carrying
+ * PSI or SI. offset is the one of the packet where the section starts. */
+static void psi_archive_section(psi_parse_state *state, uint16_t pid,
+                                const uint8_t *section, size_t size,
+                                off_t offset) {
+  if (!state->archive_sections) {
+    return;
+  }
+  const uint32_t crc = section_identity_crc(section, size);
+  const uint64_t key = (uint64_t)crc << 32 | (uint64_t)section[0] << 16 | pid;
+  if (!psi_section_is_new(state, &state->archived_keys, key)) {
+    return;
+  }
 
-static void psi_handle_vec_push_packet(psi_parse_state *handles, uint8_t *buf) {
-  for (size_t i = 0; i < handles->psi_monitors.size; ++i) {
-    psi_monitor *pm = &handles->psi_monitors.data[i];
-    if (buf[0] == 0x47 && ts_extract_pid(buf) == pm->pid) {
-      dvbpsi_packet_push(pm->handle, buf);
-    }
+  const size_t mem_before = state->archive.mem_used;
+  if (!section_archive_add(&state->archive, section, size, pid, crc, offset)) {
+    return;
+  }
+  if (!psi_batch_grew(state, mem_before, state->archive.mem_used,
+                      psi_flush_section_archive)) {
+    return;
+  }
+  if (state->archive.sections.size >= SECTION_ARCHIVE_MAX_SECTIONS) {
+    psi_flush_section_archive(state);
   }
 }
 
-static int ts_file_read_ctx_init(ts_file_read_ctx *ctx, const char *filename,
-                                 db_export *db) {
-  FILE *f = fopen(filename, "rb");
-  if (!f) {
-    return errno;
+static void psi_eit_section_cbk(void *cbk_data, uint16_t pid,
+                                const uint8_t *section, size_t size,
+                                int64_t offset, int crc_ok) {
+  psi_parse_state *state = cbk_data;
+  if (!crc_ok) {
+    tr101290_report(&state->tr101290, TR101290_CRC_ERROR,
+                    state->packet_offset);
+    return;
+  }
+  if (section[0] < EIT_MIN_TABLE_ID || section[0] > EIT_MAX_TABLE_ID) {
+    return;
+  }
+  psi_archive_section(state, pid, section, size, offset);
+
+  /* EIT sections are repeated all the time, and only a tiny fraction of them
+   * carries anything new. the CRC_32 covers the version, so identical
+   * repetitions end up with the same key. */
+  uint32_t crc;
+  memcpy(&crc, section + size - 4, sizeof(crc));
+  const uint64_t key = (uint64_t)crc << 32 | (uint64_t)section[0] << 24 |
+                       (uint64_t)section[6] << 16 | section[3] << 8 |
+                       section[4];
+  if (!psi_section_is_new(state, &state->eit_sections, key)) {
+    return;
   }
-  ctx->file = f;
-  ctx->file_name = filename;
-  ctx->dvbpsi_state.buf_fill = 0;
-  ctx->dvbpsi_state.last_pos = 0;
-  fseeko(f, 0, SEEK_END);
-  ctx->file_size = ftello(f);
-  fseeko(f, 0, SEEK_SET);
-  psi_handle_vec_init(&ctx->dvbpsi_parse, db);
-  ctx->dvbpsi_parse.file_ctx = ctx;
-  return 0;
-}
 
-static void ts_file_read_ctx_destroy(ts_file_read_ctx *ctx) {
-  psi_handle_vec_destroy(&ctx->dvbpsi_parse);
-  fclose(ctx->file);
+  const size_t mem_before = state->eit_events.mem_used;
+  if (!eit_batch_add_section(&state->eit_events, section, size)) {
+    return;
+  }
+  if (!psi_batch_grew(state, mem_before, state->eit_events.mem_used,
+                      psi_flush_eit_events)) {
+    return;
+  }
+  if (state->eit_events.events.size >= EIT_BATCH_MAX_EVENTS) {
+    psi_flush_eit_events(state);
+  }
 }
 
-static const AVInputFormat *mpegts_format;
+#define TIME_BATCH_MAX_REFS 4096
+
+static void psi_flush_time_refs(psi_parse_state *state) {
+  if (state->time_refs.refs.size == 0) {
+    return;
+  }
+  ensure_file_has_rowid(state);
+  db_export_time_batch(state->db, state->file_rowid, &state->time_refs);
+  psi_mem_release(state, state->time_refs.mem_used);
+  time_batch_clear(&state->time_refs);
+}
+
+static void psi_tdt_tot_section_cbk(void *cbk_data, uint16_t pid,
+                                    const uint8_t *section, size_t size,
+                                    int64_t offset, int crc_ok) {
+  psi_parse_state *state = cbk_data;
+  /* the TOT carries a CRC_32 even though its section_syntax_indicator is 0,
+   * so crc_ok tells nothing about it. the bad ones are neither archived nor
+   * decoded. */
+  if (section[0] == TOT_TABLE_ID) {
+    crc_ok = section_crc32(section, size) == 0;
+  }
+  if (!crc_ok) {
+    tr101290_report(&state->tr101290, TR101290_CRC_ERROR,
+                    state->packet_offset);
+    return;
+  }
+  psi_archive_section(state, pid, section, size, offset);
+  const size_t mem_before = state->time_refs.mem_used;
+  if (!time_batch_add_section(&state->time_refs, section, size,
+                              state->packet_offset)) {
+    return;
+  }
+  if (!psi_batch_grew(state, mem_before, state->time_refs.mem_used,
+                      psi_flush_time_refs)) {
+    return;
+  }
+  if (state->time_refs.refs.size >= TIME_BATCH_MAX_REFS) {
+    psi_flush_time_refs(state);
+  }
+}
+
+#define SPLICE_BATCH_MAX_EVENTS 4096
+
+static void psi_flush_splice_events(psi_parse_state *state) {
+  if (state->splice_events.events.size == 0) {
+    return;
+  }
+  ensure_file_has_rowid(state);
+  db_export_splice_batch(state->db, state->file_rowid, &state->splice_events);
+  psi_mem_release(state, state->splice_events.mem_used);
+  splice_batch_clear(&state->splice_events);
+}
+
+static void psi_scte35_section_cbk(void *cbk_data, uint16_t pid,
+                                   const uint8_t *section, size_t size,
+                                   int64_t offset, int crc_ok) {
+  psi_parse_state *state = cbk_data;
+  /* the section_syntax_indicator is 0, so crc_ok tells nothing : the CRC_32
+   * is checked along with the decoding, and the bad ones are not archived. */
+  const size_t mem_before = state->splice_events.mem_used;
+  const int added = splice_batch_add_section(&state->splice_events, section,
+                                             size, pid, state->packet_offset);
+  if (added < 0) {
+    tr101290_report(&state->tr101290, TR101290_CRC_ERROR,
+                    state->packet_offset);
+    return;
+  }
+  psi_archive_section(state, pid, section, size, offset);
+  if (!added) {
+    return;
+  }
+  if (!psi_batch_grew(state, mem_before, state->splice_events.mem_used,
+                      psi_flush_splice_events)) {
+    return;
+  }
+  if (state->splice_events.events.size >= SPLICE_BATCH_MAX_EVENTS) {
+    psi_flush_splice_events(state);
+  }
+}
+
+#define AIT_BATCH_MAX_APPLICATIONS 4096
+
+static void psi_flush_ait_applications(psi_parse_state *state) {
+  if (state->ait_applications.sections.size == 0) {
+    return;
+  }
+  ensure_file_has_rowid(state);
+  db_export_ait_batch(state->db, state->file_rowid, &state->ait_applications);
+  psi_mem_release(state, state->ait_applications.mem_used);
+  ait_batch_clear(&state->ait_applications);
+}
+
+static void psi_ait_section_cbk(void *cbk_data, uint16_t pid,
+                                const uint8_t *section, size_t size,
+                                int64_t offset, int crc_ok) {
+  psi_parse_state *state = cbk_data;
+  if (!crc_ok) {
+    tr101290_report(&state->tr101290, TR101290_CRC_ERROR,
+                    state->packet_offset);
+    return;
+  }
+  if (section[0] != AIT_TABLE_ID) {
+    return;
+  }
+  psi_archive_section(state, pid, section, size, offset);
+
+  /* just like EITs, AITs are repeated all the time without changing. */
+  uint32_t crc;
+  memcpy(&crc, section + size - 4, sizeof(crc));
+  const uint64_t key = (uint64_t)crc << 32 | (uint64_t)section[6] << 16 | pid;
+  if (!psi_section_is_new(state, &state->ait_sections, key)) {
+    return;
+  }
+
+  const size_t mem_before = state->ait_applications.mem_used;
+  if (!ait_batch_add_section(&state->ait_applications, section, size, pid)) {
+    return;
+  }
+  if (!psi_batch_grew(state, mem_before, state->ait_applications.mem_used,
+                      psi_flush_ait_applications)) {
+    return;
+  }
+  if (state->ait_applications.applications.size >=
+      AIT_BATCH_MAX_APPLICATIONS) {
+    psi_flush_ait_applications(state);
+  }
+}
+
+#define PID_SECONDS_BATCH_MAX_BUCKETS 4096
+
+static void psi_flush_pid_seconds(psi_parse_state *state) {
+  if (state->pid_seconds.buckets.size == 0) {
+    return;
+  }
+  ensure_file_has_rowid(state);
+  db_export_pid_seconds(state->db, state->file_rowid, &state->pid_seconds);
+  psi_mem_release(state, state->pid_seconds.mem_used);
+  pid_bucket_batch_clear(&state->pid_seconds);
+}
+
+static void psi_count_pid_second(psi_parse_state *state, uint16_t pid) {
+  const size_t mem_before = state->pid_seconds.mem_used;
+  if (!pid_stats_table_count_second(&state->pid_stats, &state->pid_seconds,
+                                    pid, state->pcr_elapsed / PCR_CLOCK)) {
+    return;
+  }
+  if (!psi_batch_grew(state, mem_before, state->pid_seconds.mem_used,
+                      psi_flush_pid_seconds)) {
+    return;
+  }
+  if (state->pid_seconds.buckets.size >= PID_SECONDS_BATCH_MAX_BUCKETS) {
+    psi_flush_pid_seconds(state);
+  }
+}
+
+/* the last second of every PID ends with the file. */
+static void psi_close_pid_seconds(psi_parse_state *state) {
+  const size_t mem_before = state->pid_seconds.mem_used;
+  pid_stats_table_close_seconds(&state->pid_stats, &state->pid_seconds);
+  state->mem_used += state->pid_seconds.mem_used - mem_before;
+  psi_flush_pid_seconds(state);
+}
+
+#define RAP_BATCH_MAX_POINTS 4096
+
+static void psi_flush_random_access_points(psi_parse_state *state) {
+  if (state->random_access_points.points.size == 0) {
+    return;
+  }
+  ensure_file_has_rowid(state);
+  db_export_rap_batch(state->db, state->file_rowid,
+                      &state->random_access_points);
+  psi_mem_release(state, state->random_access_points.mem_used);
+  rap_batch_clear(&state->random_access_points);
+}
+
+static void psi_scan_video_packet(psi_parse_state *state, rap_scanner *s,
+                                  const uint8_t *buf) {
+  const size_t mem_before = state->random_access_points.mem_used;
+  if (!rap_scanner_push(s, &state->random_access_points, buf,
+                        state->packet_offset)) {
+    return;
+  }
+  if (!psi_batch_grew(state, mem_before, state->random_access_points.mem_used,
+                      psi_flush_random_access_points)) {
+    return;
+  }
+  if (state->random_access_points.points.size >= RAP_BATCH_MAX_POINTS) {
+    psi_flush_random_access_points(state);
+  }
+}
+
+/* dvbpsi silently drops the sections with a bad CRC_32, so the PIDs of the
+ * tables it decodes are also read with our own section readers, for checking
+ * the CRCs and archiving the sections. */
+static void psi_crc_section_cbk(void *cbk_data, uint16_t pid,
+                                const uint8_t *section, size_t size,
+                                int64_t offset, int crc_ok) {
+  psi_parse_state *state = cbk_data;
+  if (!crc_ok) {
+    tr101290_report(&state->tr101290, TR101290_CRC_ERROR,
+                    state->packet_offset);
+    return;
+  }
+  /* the decoders of the other tables only exist once a PAT was received. the
+   * sections seen before that would be lost when rederiving. */
+  if (state->has_pat || pid == PAT_PID || pid == CAT_PID) {
+    psi_archive_section(state, pid, section, size, offset);
+  }
+}
+
+static void psi_flush_batches(psi_parse_state *state) {
+  psi_flush_eit_events(state);
+  psi_flush_time_refs(state);
+  psi_flush_splice_events(state);
+  psi_flush_ait_applications(state);
+  psi_flush_random_access_points(state);
+  psi_close_pid_seconds(state);
+  psi_flush_section_archive(state);
+}
+
+/* called at the end of the file, where all the versions still on air end. */
+static void psi_export_version_spans(psi_parse_state *state) {
+  const psi_table_version *singles[] = {&state->current_pat,
+                                        &state->current_nit,
+                                        &state->current_cat};
+  for (size_t i = 0; i < sizeof(singles) / sizeof(*singles); ++i) {
+    if (singles[i]->has_version) {
+      psi_table_version_export_span(state, singles[i], state->packet_offset,
+                                    state->last_pcr, 0);
+    }
+  }
+  psi_table_versions_export_spans(state, &state->current_pmts);
+  psi_table_versions_export_spans(state, &state->current_sdts);
+  psi_table_versions_export_spans(state, &state->current_bats);
+  psi_table_versions_export_spans(state, &state->other_sdts);
+  psi_table_versions_export_spans(state, &state->other_nits);
+}
+
+/* the mux bitrate and the duration of the file are taken from the PCR PID
+ * covering the most time. returns that duration, or -1 if there's none. */
+static double psi_export_pcr_timing(psi_parse_state *state) {
+  const pcr_tracker *longest = 0;
+  ensure_file_has_rowid(state);
+  for (size_t i = 0; i < state->pcr_trackers.size; ++i) {
+    const pcr_tracker *t = &state->pcr_trackers.data[i];
+    db_export_pcr_pid_timing(state->db, state->file_rowid, t->pid,
+                             pcr_tracker_duration(t), t->discontinuities);
+    if (!longest || t->ticks > longest->ticks) {
+      longest = t;
+    }
+  }
+  if (!longest) {
+    return -1;
+  }
+  const double duration = pcr_tracker_duration(longest);
+  db_export_file_timing(state->db, state->file_rowid, duration,
+                        pcr_tracker_bitrate(longest));
+  return duration;
+}
+
+/* the containers are allocated once per pool, and reused by every file. */
+static void psi_handle_vec_alloc(psi_parse_state *handles) {
+  vec_psi_monitor_init(&handles->psi_monitors);
+  vec_psi_table_version_init(&handles->current_pmts);
+  vec_psi_table_version_init(&handles->current_sdts);
+  vec_psi_table_version_init(&handles->current_bats);
+  vec_psi_table_version_init(&handles->other_sdts);
+  vec_psi_table_version_init(&handles->other_nits);
+  vec_psi_section_start_init(&handles->section_starts);
+  vec_section_reader_init(&handles->section_readers);
+  vec_pcr_tracker_init(&handles->pcr_trackers);
+  if (!pid_stats_table_init(&handles->pid_stats)) {
+    dvbindex_log(DVBIDX_LOG_CAT_DVBINDEX, DVBIDX_LOG_SEVERITY_WARNING,
+                 "Could not allocate the PID statistics\n");
+  }
+  section_set_init(&handles->eit_sections);
+  eit_batch_init(&handles->eit_events);
+  time_batch_init(&handles->time_refs);
+  splice_batch_init(&handles->splice_events);
+  section_set_init(&handles->ait_sections);
+  ait_batch_init(&handles->ait_applications);
+  vec_rap_scanner_init(&handles->rap_scanners);
+  vec_probe_es_init(&handles->probe_es);
+  vec_ffmpeg_pid_init(&handles->ffmpeg_es);
+  vec_es_parser_init(&handles->es_parsers);
+  rap_batch_init(&handles->random_access_points);
+  pid_bucket_batch_init(&handles->pid_seconds);
+  section_set_init(&handles->archived_keys);
+  section_archive_init(&handles->archive);
+}
+
+static void psi_handle_vec_free(psi_parse_state *handles) {
+  vec_section_reader_destroy(&handles->section_readers);
+  vec_pcr_tracker_destroy(&handles->pcr_trackers);
+  pid_stats_table_destroy(&handles->pid_stats);
+  eit_batch_destroy(&handles->eit_events);
+  time_batch_destroy(&handles->time_refs);
+  splice_batch_destroy(&handles->splice_events);
+  ait_batch_destroy(&handles->ait_applications);
+  vec_rap_scanner_destroy(&handles->rap_scanners);
+  vec_probe_es_destroy(&handles->probe_es);
+  vec_ffmpeg_pid_destroy(&handles->ffmpeg_es);
+  vec_es_parser_destroy(&handles->es_parsers);
+  rap_batch_destroy(&handles->random_access_points);
+  pid_bucket_batch_destroy(&handles->pid_seconds);
+  section_archive_destroy(&handles->archive);
+  vec_psi_table_version_destroy(&handles->current_pmts);
+  vec_psi_table_version_destroy(&handles->current_sdts);
+  vec_psi_table_version_destroy(&handles->current_bats);
+  vec_psi_table_version_destroy(&handles->other_sdts);
+  vec_psi_table_version_destroy(&handles->other_nits);
+  vec_psi_section_start_destroy(&handles->section_starts);
+  vec_psi_monitor_destroy(&handles->psi_monitors);
+}
+
+static void psi_handle_vec_init(psi_parse_state *handles, read_pool *pool,
+                                db_export *db, size_t mem_limit) {
+  handles->pool = pool;
+  handles->parse_es = 0;
+  handles->es_unknown = 0;
+  psi_rebuild_ffmpeg_pids(handles);
+  handles->ffmpeg_pids_ready = 0;
+  handles->ffmpeg_pids_lost = 0;
+  handles->ffmpeg_next_packet = 0;
+  handles->mem_used = 0;
+  handles->mem_limit = mem_limit;
+  handles->mem_exceeded = 0;
+  pid_stats_table_reset(&handles->pid_stats);
+  handles->packet_offset = 0;
+  handles->last_pcr = -1;
+  handles->pcr_pid = -1;
+  handles->pcr_elapsed = 0;
+  handles->archive_sections = 1;
+  handles->archived_file_rowid = -1;
+  handles->current_pat.has_version = 0;
+  handles->current_nit.has_version = 0;
+  handles->current_cat.has_version = 0;
+  psi_monitor *m = psi_new_monitor(handles);
+  if (m) {
+    pat_monitor_init(m);
+    dvbpsi_pat_attach(m->handle, psi_pat_cbk, handles);
+  }
+  m = psi_new_monitor(handles);
+  if (m) {
+    cat_monitor_init(m);
+    dvbpsi_cat_attach(m->handle, psi_cat_cbk, handles);
+  }
+  psi_new_section_reader(handles, EIT_PID, psi_eit_section_cbk);
+  psi_new_section_reader(handles, TDT_TOT_PID, psi_tdt_tot_section_cbk);
+  psi_new_section_reader(handles, PAT_PID, psi_crc_section_cbk);
+  psi_new_section_reader(handles, CAT_PID, psi_crc_section_cbk);
+  psi_new_section_reader(handles, NIT_DEFAULT_PID, psi_crc_section_cbk);
+  psi_new_section_reader(handles, SDT_PID, psi_crc_section_cbk);
+  tr101290_init(&handles->tr101290);
+  handles->db = db;
+  handles->has_pat = 0;
+  handles->has_nit = 0;
+  handles->has_cat = 0;
+  handles->has_file_rowid = 0;
+}
+
+/* empties the parse state for the next file. the section sets are freed, since
+ * their capacity is charged to the file which grew them. */
+static void psi_handle_vec_destroy(psi_parse_state *handles) {
+  for (size_t i = 0; i < handles->psi_monitors.size; ++i) {
+    psi_release_monitor(handles, &handles->psi_monitors.data[i]);
+  }
+  psi_mem_release(handles, sizeof(psi_table_version) *
+                               (handles->current_pmts.size +
+                                handles->current_sdts.size +
+                                handles->current_bats.size +
+                                handles->other_sdts.size +
+                                handles->other_nits.size));
+  psi_mem_release(handles,
+                  sizeof(psi_section_start) * handles->section_starts.size);
+  psi_mem_release(handles,
+                  sizeof(section_reader) * handles->section_readers.size);
+  psi_mem_release(handles, sizeof(pcr_tracker) * handles->pcr_trackers.size);
+  psi_mem_release(handles, sizeof(*handles->eit_sections.keys) *
+                               handles->eit_sections.cap);
+  psi_mem_release(handles, handles->eit_events.mem_used);
+  psi_mem_release(handles, handles->time_refs.mem_used);
+  psi_mem_release(handles, handles->splice_events.mem_used);
+  psi_mem_release(handles, sizeof(*handles->ait_sections.keys) *
+                               handles->ait_sections.cap);
+  psi_mem_release(handles, handles->ait_applications.mem_used);
+  psi_mem_release(handles, sizeof(rap_scanner) * handles->rap_scanners.size);
+  psi_mem_release(handles, sizeof(probe_es) * handles->probe_es.size);
+  psi_mem_release(handles, sizeof(ffmpeg_pid) * handles->ffmpeg_es.size);
+  psi_mem_release(handles, sizeof(es_parser) * handles->es_parsers.size);
+  psi_mem_release(handles, handles->random_access_points.mem_used);
+  psi_mem_release(handles, handles->pid_seconds.mem_used);
+  psi_mem_release(handles, sizeof(*handles->archived_keys.keys) *
+                               handles->archived_keys.cap);
+  psi_mem_release(handles, handles->archive.mem_used);
+  assert(handles->mem_used == 0);
+  handles->psi_monitors.size = 0;
+  handles->current_pmts.size = 0;
+  handles->current_sdts.size = 0;
+  handles->current_bats.size = 0;
+  handles->other_sdts.size = 0;
+  handles->other_nits.size = 0;
+  handles->section_starts.size = 0;
+  handles->section_readers.size = 0;
+  handles->pcr_trackers.size = 0;
+  handles->rap_scanners.size = 0;
+  handles->probe_es.size = 0;
+  handles->ffmpeg_es.size = 0;
+  handles->es_parsers.size = 0;
+  section_set_destroy(&handles->eit_sections);
+  section_set_destroy(&handles->ait_sections);
+  section_set_destroy(&handles->archived_keys);
+  eit_batch_clear(&handles->eit_events);
+  time_batch_reset(&handles->time_refs);
+  splice_batch_clear(&handles->splice_events);
+  ait_batch_clear(&handles->ait_applications);
+  rap_batch_clear(&handles->random_access_points);
+  pid_bucket_batch_clear(&handles->pid_seconds);
+  section_archive_clear(&handles->archive);
+}
+
+static void read_pool_init(read_pool *pool) {
+  vec_dvbpsi_t_p_init(&pool->idle_handles);
+  pool->avio_buffer = 0;
+  pool->avio_buffer_size = 0;
+  pool->feed_buffer = 0;
+  psi_handle_vec_alloc(&pool->parse);
+}
+
+static void read_pool_destroy(read_pool *pool) {
+  for (size_t i = 0; i < pool->idle_handles.size; ++i) {
+    dvbpsi_delete(pool->idle_handles.data[i]);
+  }
+  vec_dvbpsi_t_p_destroy(&pool->idle_handles);
+  av_freep(&pool->avio_buffer);
+  free(pool->feed_buffer);
+  psi_handle_vec_free(&pool->parse);
+}
+
+static uint16_t ts_extract_pid(const uint8_t *buf) {
+  uint16_t rv;
+  memcpy(&rv, buf + 1, sizeof(rv));
+  return htons(rv) & 0x1fff;
+}
+
+static void psi_track_pcr(psi_parse_state *handles, const uint8_t *buf,
+                          uint16_t pid) {
+  if (handles->pcr_pid >= 0 && handles->pcr_pid != pid) {
+    return;
+  }
+  const int64_t pcr = ts_packet_pcr(buf);
+  if (pcr >= 0) {
+    if (handles->last_pcr >= 0) {
+      const int64_t delta = pcr_delta(handles->last_pcr, pcr);
+      if (delta <= PCR_MAX_GAP) {
+        handles->pcr_elapsed += delta;
+      }
+    }
+    handles->last_pcr = pcr;
+    handles->pcr_pid = pid;
+  }
+}
+
+static void psi_report_pcr_events(psi_parse_state *handles, int events) {
+  tr101290_state *tr = &handles->tr101290;
+  if (events & PCR_EVENT_REPETITION) {
+    tr101290_report(tr, TR101290_PCR_REPETITION_ERROR, handles->packet_offset);
+  }
+  if (events & PCR_EVENT_UNSIGNALED_DISCONTINUITY) {
+    tr101290_report(tr, TR101290_PCR_DISCONTINUITY_INDICATOR_ERROR,
+                    handles->packet_offset);
+  }
+  if (events & PCR_EVENT_INACCURATE) {
+    tr101290_report(tr, TR101290_PCR_ACCURACY_ERROR, handles->packet_offset);
+  }
+}
+
+/* PATs and PMTs must be repeated at least every 500ms. */
+#define PSI_REPETITION_MAX (PCR_CLOCK / 2)
+
+static void psi_check_repetition(psi_parse_state *handles, psi_monitor *pm,
+                                 const uint8_t *buf) {
+  tr101290_error err;
+  if (pm->type == PSI_MONITOR_PAT) {
+    err = TR101290_PAT_ERROR;
+  } else if (pm->type == PSI_MONITOR_PMT) {
+    err = TR101290_PMT_ERROR;
+  } else {
+    return;
+  }
+  if (buf[3] & 0xc0) {
+    /* PATs and PMTs are never scrambled. */
+    tr101290_report(&handles->tr101290, err, handles->packet_offset);
+  }
+
+  const int payload_unit_start = buf[1] & 0x40;
+  if (!payload_unit_start || handles->last_pcr < 0) {
+    return;
+  }
+  if (pm->last_section_pcr >= 0 &&
+      pcr_delta(pm->last_section_pcr, handles->last_pcr) >
+          PSI_REPETITION_MAX) {
+    tr101290_report(&handles->tr101290, err, handles->packet_offset);
+  }
+  pm->last_section_pcr = handles->last_pcr;
+}
+
+#define SECTION_HEADER_SIZE 8
+
+static void psi_note_section_start(psi_parse_state *state, const uint8_t *h) {
+  const int has_syntax = h[1] & 0x80;
+  if (!has_syntax || h[6] != 0) {
+    return;
+  }
+  /* the CAT has no table_id_extension, and its versions are kept with 0. */
+  const uint16_t ext = h[0] == CAT_TABLE_ID ? 0 : (h[3] << 8) | h[4];
+  const uint8_t version = h[5] & 0x3f;
+  psi_section_start *s = psi_seek_section_start(state, h[0], ext);
+  if (s && s->version == version) {
+    return;
+  }
+  if (!s) {
+    if (!psi_mem_charge(state, sizeof(psi_section_start))) {
+      return;
+    }
+    s = vec_psi_section_start_write(&state->section_starts);
+    if (!s) {
+      psi_mem_release(state, sizeof(psi_section_start));
+      return;
+    }
+    s->table_id = h[0];
+    s->table_id_ext = ext;
+  }
+  s->version = version;
+  s->offset = state->packet_offset;
+  s->pcr = state->last_pcr;
+}
+
+/* goes through the headers of the sections starting in the packet. */
+static void psi_note_section_starts(psi_parse_state *state,
+                                    const uint8_t *buf) {
+  const int payload_unit_start = buf[1] & 0x40;
+  if (!payload_unit_start || !(buf[3] & 0x10)) {
+    return;
+  }
+  const uint8_t *p = buf + 4;
+  const uint8_t *end = buf + TS_PACKET_SIZE;
+  if (buf[3] & 0x20) {
+    p += 1 + buf[4];
+  }
+  if (p >= end || *p >= end - p - 1) {
+    return;
+  }
+  p += 1 + *p;
+  while (end - p >= SECTION_HEADER_SIZE && *p != 0xff) {
+    psi_note_section_start(state, p);
+    const size_t size = 3 + (((p[1] & 0x0f) << 8) | p[2]);
+    if (size >= (size_t)(end - p)) {
+      break;
+    }
+    p += size;
+  }
+}
+
+/* hands the packet to the PSI decoders and the section readers of its PID. */
+static void psi_push_section_packet(psi_parse_state *handles, uint16_t pid,
+                                    uint8_t *buf) {
+  int noted = 0;
+  for (size_t i = 0; i < handles->psi_monitors.size; ++i) {
+    psi_monitor *pm = &handles->psi_monitors.data[i];
+    if (pid == pm->pid) {
+      if (!noted) {
+        psi_note_section_starts(handles, buf);
+        noted = 1;
+      }
+      psi_check_repetition(handles, pm, buf);
+      dvbpsi_packet_push(pm->handle, buf);
+    }
+  }
+  for (size_t i = 0; i < handles->section_readers.size; ++i) {
+    section_reader *r = &handles->section_readers.data[i];
+    if (pid == r->pid) {
+      section_reader_push(r, buf, handles->packet_offset);
+    }
+  }
+}
+
+static void psi_handle_vec_push_packet(psi_parse_state *handles, uint8_t *buf) {
+  if (!tr101290_check_sync(&handles->tr101290, buf, handles->packet_offset)) {
+    return;
+  }
+  const uint16_t pid = ts_extract_pid(buf);
+  if (pid_stats_table_push(&handles->pid_stats, buf, handles->packet_offset)) {
+    tr101290_report(&handles->tr101290, TR101290_CONTINUITY_COUNT_ERROR,
+                    handles->packet_offset);
+  }
+  psi_track_pcr(handles, buf, pid);
+  psi_count_pid_second(handles, pid);
+  for (size_t i = 0; i < handles->pcr_trackers.size; ++i) {
+    pcr_tracker *t = &handles->pcr_trackers.data[i];
+    if (pid == t->pid) {
+      psi_report_pcr_events(handles,
+                            pcr_tracker_push(t, buf, handles->packet_offset));
+    }
+  }
+  if (handles->mem_exceeded) {
+    return;
+  }
+  psi_push_section_packet(handles, pid, buf);
+  for (size_t i = 0; i < handles->rap_scanners.size; ++i) {
+    rap_scanner *s = &handles->rap_scanners.data[i];
+    if (pid == s->pid) {
+      psi_scan_video_packet(handles, s, buf);
+    }
+  }
+  for (size_t i = 0; i < handles->es_parsers.size; ++i) {
+    es_parser *p = &handles->es_parsers.data[i];
+    if (pid == p->pid) {
+      es_parser_push(p, buf);
+    }
+  }
+}
+
+/* a few scrambled packets might be a glitch : a PID is only taken as
+ * scrambled once it had this many, and they're most of its payload. */
+#define SCRAMBLED_MIN_PACKETS 16
+
+static int psi_pid_is_scrambled(const psi_parse_state *state, uint16_t pid) {
+  if (!state->pid_stats.pids) {
+    return 0;
+  }
+  const pid_stats *s = &state->pid_stats.pids[pid];
+  return s->scrambled_packets >= SCRAMBLED_MIN_PACKETS &&
+         s->scrambled_packets * 2 > s->payload_packets;
+}
+
+static int psi_pmts_received(const psi_parse_state *state) {
+  for (size_t i = 0; i < state->psi_monitors.size; ++i) {
+    const psi_monitor *pm = &state->psi_monitors.data[i];
+    if (pm->type != PSI_MONITOR_PMT) {
+      continue;
+    }
+    int received = 0;
+    for (size_t j = 0; j < state->current_pmts.size; ++j) {
+      const psi_table_version *v = &state->current_pmts.data[j];
+      if (v->has_version && v->id == pm->extension) {
+        received = 1;
+        break;
+      }
+    }
+    if (!received) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* whether the PMTs of the PAT were all received, and every audio and video ES
+ * which isn't scrambled had a complete PES packet. video needs the given
+ * number of pictures, starting at a random access point. */
+static int psi_clear_es_probed(const psi_parse_state *state,
+                               int64_t pictures) {
+  if (!state->has_pat || state->probe_es.size == 0 ||
+      !state->pid_stats.pids || !psi_pmts_received(state)) {
+    return 0;
+  }
+  for (size_t i = 0; i < state->probe_es.size; ++i) {
+    const probe_es *es = &state->probe_es.data[i];
+    if (psi_pid_is_scrambled(state, es->pid)) {
+      continue;
+    }
+    if (!es->is_video) {
+      if (state->pid_stats.pids[es->pid].unit_starts < 2) {
+        return 0;
+      }
+      continue;
+    }
+    int complete = 0;
+    for (size_t j = 0; j < state->rap_scanners.size; ++j) {
+      const rap_scanner *s = &state->rap_scanners.data[j];
+      if (s->pid == es->pid) {
+        complete = s->pictures >= pictures;
+        break;
+      }
+    }
+    if (!complete) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* ffmpeg isn't needed once all the PMTs were received, and the parameters of
+ * each of their audio and video ES were found by the native parsers. */
+static int psi_es_parsed(const psi_parse_state *state) {
+  if (!state->has_pat || state->es_unknown || !psi_pmts_received(state)) {
+    return 0;
+  }
+  for (size_t i = 0; i < state->es_parsers.size; ++i) {
+    if (!es_parser_resolved(&state->es_parsers.data[i])) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void psi_mark_scrambled_es(psi_parse_state *state) {
+  for (size_t i = 0; i < state->es_parsers.size; ++i) {
+    es_parser *p = &state->es_parsers.data[i];
+    p->scrambled = (uint8_t)psi_pid_is_scrambled(state, p->pid);
+  }
+}
+
+/* a fast probe ends once the picture following the random access point has
+ * started. */
+#define FAST_PROBE_PICTURES 2
+/* as many pictures as ffmpeg analyses for finding the frame rate. */
+#define FULL_PROBE_PICTURES 21
+
+/* ffmpeg checks these between the packets it reads while probing, which are
+ * the packets the PSI state has already seen. */
+static int probe_interrupt_cbk(void *opaque) {
+  return psi_clear_es_probed(opaque, FAST_PROBE_PICTURES);
+}
+
+/* the full profile lets ffmpeg read as much as it wants, except when some ES
+ * are scrambled : it would read up to its limits trying to find their
+ * parameters, so it is stopped once only those are left. */
+static int probe_scrambled_interrupt_cbk(void *opaque) {
+  const psi_parse_state *state = opaque;
+  int scrambled = 0;
+  for (size_t i = 0; i < state->probe_es.size && !scrambled; ++i) {
+    scrambled = psi_pid_is_scrambled(state, state->probe_es.data[i].pid);
+  }
+  return scrambled && psi_clear_es_probed(state, FULL_PROBE_PICTURES);
+}
+
+static int ts_file_read_ctx_init(ts_file_read_ctx *ctx, read_pool *pool,
+                                 const char *filename, db_export *db,
+                                 const read_opts *opts) {
+  FILE *f = fopen(filename, "rb");
+  if (!f) {
+    return errno;
+  }
+  ctx->file = f;
+  ctx->file_name = filename;
+  ctx->dvbpsi_state.buf_fill = 0;
+  ctx->dvbpsi_state.last_pos = 0;
+  ctx->dvbpsi_state.pushed = 0;
+  fseeko(f, 0, SEEK_END);
+  ctx->file_size = ftello(f);
+  fseeko(f, 0, SEEK_SET);
+  ctx->dvbpsi_parse = &pool->parse;
+  ctx->dvbpsi_parse->file_ctx = ctx;
+  psi_handle_vec_init(ctx->dvbpsi_parse, pool, db, opts->psi_mem_limit);
+  return 0;
+}
+
+static void ts_file_read_ctx_destroy(ts_file_read_ctx *ctx) {
+  psi_handle_vec_destroy(ctx->dvbpsi_parse);
+  if (ctx->file) {
+    fclose(ctx->file);
+  }
+}
+
+static const AVInputFormat *mpegts_format;
 
 static dvbindex_log_severity ffmpeg_to_dvbindex_severity(int severity) {
   if (severity <= AV_LOG_FATAL) {
@@ -526,44 +1984,111 @@ int ffmpeg_init(void) {
 }
 
 static void push_to_dvbpsi(ts_file_read_ctx *ctx, uint8_t *buf, size_t size) {
-  if (ctx->dvbpsi_state.buf_fill != 0) {
+  dvbpsi_read_state *st = &ctx->dvbpsi_state;
+  if (st->buf_fill != 0) {
     /* incomplete packet leftover from previous call. */
-    const size_t needed = TS_PACKET_SIZE - ctx->dvbpsi_state.buf_fill;
-    if (size >= needed) {
-      memcpy(ctx->dvbpsi_state.buf + ctx->dvbpsi_state.buf_fill, buf, needed);
-      size -= needed;
-      buf += needed;
-      ctx->dvbpsi_state.buf_fill = 0;
-      psi_handle_vec_push_packet(&ctx->dvbpsi_parse, ctx->dvbpsi_state.buf);
+    const size_t needed = TS_PACKET_SIZE - st->buf_fill;
+    const size_t copied = FFMIN(needed, size);
+    memcpy(st->buf + st->buf_fill, buf, copied);
+    st->buf_fill += copied;
+    st->pushed += copied;
+    size -= copied;
+    buf += copied;
+    if (st->buf_fill < TS_PACKET_SIZE) {
+      return;
     }
+    st->buf_fill = 0;
+    ctx->dvbpsi_parse->packet_offset = st->pushed - TS_PACKET_SIZE;
+    psi_handle_vec_push_packet(ctx->dvbpsi_parse, st->buf);
   }
 
   /* submit as much as possible */
   while (size >= TS_PACKET_SIZE) {
-    psi_handle_vec_push_packet(&ctx->dvbpsi_parse, buf);
+    ctx->dvbpsi_parse->packet_offset = st->pushed;
+    psi_handle_vec_push_packet(ctx->dvbpsi_parse, buf);
     buf += TS_PACKET_SIZE;
     size -= TS_PACKET_SIZE;
+    st->pushed += TS_PACKET_SIZE;
   }
 
   /* save for next call if an incomplete packet is available. */
   if (size != 0) {
-    memcpy(ctx->dvbpsi_state.buf, buf, size);
-    ctx->dvbpsi_state.buf_fill = size;
+    memcpy(st->buf, buf, size);
+    st->buf_fill = size;
+    st->pushed += size;
   }
 }
 
+/* the PID ends in the third byte of the packet. */
+#define TS_PID_END 3
+
+static int ts_packet_starts_at(const uint8_t *buf, size_t size, size_t i) {
+  return buf[i] == 0x47 &&
+         (i + TS_PACKET_SIZE >= size || buf[i + TS_PACKET_SIZE] == 0x47);
+}
+
+/* once the PMTs are known, the packets of the PIDs ffmpeg has no use for, and
+ * of the scrambled ones, are turned into null packets, which its demuxer drops
+ * right away. the data keeps its size, so the offsets ffmpeg seeks to stay the
+ * same. the packets are found where the previous read left off, or by looking
+ * for sync bytes after a seek or a loss of sync. returns the size of the
+ * packet header cut by the end of buf, which should be read again. */
+static size_t hide_pids_from_ffmpeg(psi_parse_state *state, uint8_t *buf,
+                                    size_t size, off_t pos) {
+  if (!state->ffmpeg_pids_ready) {
+    state->ffmpeg_pids_ready = state->has_pat && psi_pmts_received(state);
+  }
+  if (!state->ffmpeg_pids_ready || state->ffmpeg_pids_lost) {
+    return 0;
+  }
+  const off_t expected = state->ffmpeg_next_packet;
+  size_t i = expected >= pos && expected < pos + (off_t)size
+                 ? (size_t)(expected - pos)
+                 : 0;
+  while (i < size) {
+    if (!ts_packet_starts_at(buf, size, i)) {
+      ++i;
+      continue;
+    }
+    if (size - i < TS_PID_END) {
+      break;
+    }
+    uint8_t *packet = buf + i;
+    const uint16_t pid = ts_extract_pid(packet);
+    if (!psi_ffmpeg_pid_allowed(state, pid) ||
+        psi_pid_is_scrambled(state, pid)) {
+      packet[1] = (uint8_t)((packet[1] & 0xe0) | (TS_NULL_PID >> 8));
+      packet[2] = TS_NULL_PID & 0xff;
+    }
+    i += TS_PACKET_SIZE;
+  }
+  state->ffmpeg_next_packet = pos + (off_t)i;
+  return i < size ? size - i : 0;
+}
+
 static int read_packet(void *opaque, uint8_t *buf, int buf_size) {
   /* really a wrapper for fread() which also synchronizes dvbpsi decoders. */
   ts_file_read_ctx *ctx = opaque;
   FILE *io = ctx->file;
+  off_t oldpos = ftello(io);
   size_t readsize = fread(buf, 1, (size_t)buf_size, io);
 
-  /* any packets submitted to dvbpsi must be only submitted sequentially. */
-  off_t newpos = ftello(ctx->file);
+  /* any packets submitted to dvbpsi must be only submitted sequentially, and
+   * only once : ffmpeg might seek back and read some data again. */
+  off_t newpos = oldpos + (off_t)readsize;
   if (newpos > ctx->dvbpsi_state.last_pos) {
-    push_to_dvbpsi(ctx, buf, readsize);
+    size_t skip = oldpos < ctx->dvbpsi_state.last_pos
+                      ? (size_t)(ctx->dvbpsi_state.last_pos - oldpos)
+                      : 0;
+    push_to_dvbpsi(ctx, buf + skip, readsize - skip);
     ctx->dvbpsi_state.last_pos = newpos;
   }
+  const size_t cut = hide_pids_from_ffmpeg(ctx->dvbpsi_parse, buf, readsize,
+                                           oldpos);
+  if (cut > 0 && cut < readsize && fseeko(io, -(off_t)cut, SEEK_CUR) == 0) {
+    /* the next read gets the whole header of that packet. */
+    readsize -= cut;
+  }
 
   return (int)readsize;
 }
@@ -585,22 +2110,24 @@ static off_t seek_destination(off_t end, off_t cur, int64_t offset,
   return -1;
 }
 
-static void feed_dvbpsi_while_seeking(ts_file_read_ctx *ctx, off_t cur,
-                                      off_t dst) {
+static void feed_dvbpsi_while_seeking(ts_file_read_ctx *ctx, off_t dst) {
   /* called when forwarding the file into areas not yet read by dvbpsi. make
-   * sure to read all the data in between the current position and the seek
-   * destination, as all data sent to dvbpsi must be delivered in file
+   * sure to read all the data in between the last position read by dvbpsi and
+   * the seek destination, as all data sent to dvbpsi must be delivered in file
    * order. */
   uint8_t buf[BUF_SIZE];
-  assert(dst > cur);
-  size_t to_read = (size_t)(dst - cur);
+  assert(dst > ctx->dvbpsi_state.last_pos);
+  fseeko(ctx->file, ctx->dvbpsi_state.last_pos, SEEK_SET);
+  size_t to_read = (size_t)(dst - ctx->dvbpsi_state.last_pos);
   while (to_read) {
     size_t readsize = fread(buf, 1, FFMIN(BUF_SIZE, to_read), ctx->file);
+    if (readsize == 0) {
+      break;
+    }
     push_to_dvbpsi(ctx, buf, readsize);
     to_read -= readsize;
+    ctx->dvbpsi_state.last_pos += readsize;
   }
-
-  ctx->dvbpsi_state.last_pos += to_read;
 }
 
 static int64_t seek_packet(void *opaque, int64_t offset, int whence) {
@@ -614,11 +2141,11 @@ static int64_t seek_packet(void *opaque, int64_t offset, int whence) {
   case SEEK_SET:
   case SEEK_END: {
     off_t dst = seek_destination(ctx->file_size, cur, offset, whence);
-    if (dst > ctx->dvbpsi_state.last_pos && dst > cur) {
-      feed_dvbpsi_while_seeking(ctx, cur, dst);
+    if (dst > ctx->dvbpsi_state.last_pos) {
+      feed_dvbpsi_while_seeking(ctx, dst);
     }
-    fseeko(ctx->file, offset, whence);
-    return offset;
+    fseeko(ctx->file, dst, SEEK_SET);
+    return dst;
   }
 
   case AVSEEK_SIZE:
@@ -629,18 +2156,172 @@ static int64_t seek_packet(void *opaque, int64_t offset, int whence) {
   }
 }
 
-static int read_ts_file(db_export *db, const char *filename) {
+static int probe_stream_info(AVFormatContext *fmt_ctx, probe_profile profile,
+                             psi_parse_state *state) {
+  if (profile != PROBE_PROFILE_FAST) {
+    fmt_ctx->interrupt_callback.callback = probe_scrambled_interrupt_cbk;
+    fmt_ctx->interrupt_callback.opaque = state;
+    int ret = avformat_find_stream_info(fmt_ctx, 0);
+    fmt_ctx->interrupt_callback.callback = 0;
+    return ret == AVERROR_EXIT ? 0 : ret;
+  }
+
+  /* decoders are only opened for the streams whose headers don't tell
+   * everything, and a single frame is enough for them : don't start a pool of
+   * threads for each. */
+  const unsigned int nb_streams = fmt_ctx->nb_streams;
+  AVDictionary **stream_opts = av_calloc(nb_streams, sizeof(*stream_opts));
+  if (nb_streams && !stream_opts) {
+    return AVERROR(ENOMEM);
+  }
+  for (unsigned int i = 0; i < nb_streams; ++i) {
+    av_dict_set(&stream_opts[i], "threads", "1", 0);
+  }
+  fmt_ctx->interrupt_callback.callback = probe_interrupt_cbk;
+  fmt_ctx->interrupt_callback.opaque = state;
+  int ret = avformat_find_stream_info(fmt_ctx, stream_opts);
+  fmt_ctx->interrupt_callback.callback = 0;
+  if (ret == AVERROR_EXIT) {
+    /* interrupted once everything was known. */
+    ret = 0;
+  }
+  for (unsigned int i = 0; i < nb_streams; ++i) {
+    av_dict_free(&stream_opts[i]);
+  }
+  av_freep(&stream_opts);
+  return ret;
+}
+
+/* ffmpeg is not really required to read the file until the end, since it can
+ * jump over parts it doesn't really care about. ensure that all the PSI data
+ * is submitted, though. */
+static int feed_dvbpsi_to_end(ts_file_read_ctx *ctx) {
+  read_pool *pool = ctx->dvbpsi_parse->pool;
+  if (!pool->feed_buffer && !(pool->feed_buffer = malloc(FEED_BUF_SIZE))) {
+    return AVERROR(ENOMEM);
+  }
+  fseeko(ctx->file, ctx->dvbpsi_state.last_pos, SEEK_SET);
+  size_t readsize;
+  do {
+    readsize = fread(pool->feed_buffer, 1, FEED_BUF_SIZE, ctx->file);
+    push_to_dvbpsi(ctx, pool->feed_buffer, readsize);
+    ctx->dvbpsi_state.last_pos += readsize;
+  } while (readsize);
+  return 0;
+}
+
+/* everything found by reading the packets, including the streams whose
+ * parameters the native parsers found. */
+static void export_file_tables(ts_file_read_ctx *ctx, db_export *db,
+                               const char *probe) {
+  psi_parse_state *state = ctx->dvbpsi_parse;
+  /* it is possible that we got here without a PAT, which means that the file
+   * won't have a database rowid. but ffmpeg might've registered some streams
+   * even without a PAT, and the PID statistics are there anyway. */
+  ensure_file_has_rowid(state);
+  psi_flush_batches(state);
+  psi_export_version_spans(state);
+  const double duration = psi_export_pcr_timing(state);
+  db_export_pid_stats(db, state->file_rowid, &state->pid_stats, duration);
+  db_export_tr101290(db, state->file_rowid, &state->tr101290);
+  db_export_file_probe_profile(db, state->file_rowid, probe);
+  db_export_es_streams(db, state->file_rowid, state->es_parsers.data,
+                       state->es_parsers.size);
+}
+
+static int psi_es_parsed_on_pid(const psi_parse_state *state, int pid) {
+  for (size_t i = 0; i < state->es_parsers.size; ++i) {
+    const es_parser *p = &state->es_parsers.data[i];
+    if (p->pid == pid && es_parser_resolved(p)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* the streams already exported from the native parsers are left out. */
+static void export_ffmpeg_streams(db_export *db, const psi_parse_state *state,
+                                  const AVFormatContext *fmt_ctx) {
+  const unsigned int nb_streams = fmt_ctx->nb_streams;
+  AVStream **streams = av_calloc(nb_streams, sizeof(*streams));
+  uint8_t *scrambled = av_calloc(nb_streams, sizeof(*scrambled));
+  if (nb_streams && (!streams || !scrambled)) {
+    av_freep(&streams);
+    av_freep(&scrambled);
+    return;
+  }
+  unsigned int count = 0;
+  for (unsigned int i = 0; i < nb_streams; ++i) {
+    const int pid = fmt_ctx->streams[i]->id;
+    if (!psi_es_parsed_on_pid(state, pid)) {
+      scrambled[count] =
+          pid >= 0 && pid < TS_PID_COUNT && psi_pid_is_scrambled(state, pid);
+      streams[count++] = fmt_ctx->streams[i];
+    }
+  }
+  db_export_av_streams(db, state->file_rowid, count, streams, scrambled);
+  av_freep(&streams);
+  av_freep(&scrambled);
+}
+
+typedef struct read_job_ {
+  char *path;
+  /* the archive survives schema changes, and might already have the sections
+   * of a file being read again. */
+  int archived;
+} read_job;
+VEC_DEFINE(read_job)
+
+static int read_ts_file(read_pool *pool, db_export *db, const read_opts *opts,
+                        const read_job *job) {
+  const char *filename = job->path;
   ts_file_read_ctx ctx;
-  int ret = ts_file_read_ctx_init(&ctx, filename, db);
+  int ret = ts_file_read_ctx_init(&ctx, pool, filename, db, opts);
   if (ret != 0) {
     return AVERROR(ret);
   }
+  if (job->archived) {
+    ctx.dvbpsi_parse->archive_sections = 0;
+  }
 
-  if (db_has_file(db, filename, ctx.file_size)) {
-    dvbindex_log(DVBIDX_LOG_CAT_DVBINDEX, DVBIDX_LOG_SEVERITY_INFO,
-                 "%s [%lld] already in database, skipping\n",
-                 file_name_from_path(filename), (long long int)ctx.file_size);
-    return 0;
+  if (opts->psi_only) {
+    /* the file is only read once, front to back. */
+    posix_fadvise(fileno(ctx.file), 0, 0, POSIX_FADV_SEQUENTIAL);
+    ret = feed_dvbpsi_to_end(&ctx);
+    if (ret == 0 && !ctx.dvbpsi_parse->tr101290.was_in_sync) {
+      /* a TS without any PSI still gets its row, and its PID statistics. */
+      ret = AVERROR_EOF;
+    }
+    if (ret == 0) {
+      /* no probe profile, since the streams weren't probed at all. */
+      export_file_tables(&ctx, db, 0);
+      dvbindex_log(DVBIDX_LOG_CAT_DVBINDEX, DVBIDX_LOG_SEVERITY_INFO,
+                   "Saved %s\n", file_name_from_path(filename));
+    }
+    ts_file_read_ctx_destroy(&ctx);
+    return ret;
+  }
+
+  probe_profile profile = opts->probe;
+  if (profile == PROBE_PROFILE_NATIVE) {
+    /* the whole file is read for the PSI anyway, and the ES parsers run on the
+     * way. ffmpeg only reads the file again if some ES couldn't be parsed. */
+    ctx.dvbpsi_parse->parse_es = 1;
+    ret = feed_dvbpsi_to_end(&ctx);
+    if (ret != 0) {
+      ts_file_read_ctx_destroy(&ctx);
+      return ret;
+    }
+    psi_mark_scrambled_es(ctx.dvbpsi_parse);
+    if (psi_es_parsed(ctx.dvbpsi_parse)) {
+      export_file_tables(&ctx, db, probe_profile_name(PROBE_PROFILE_NATIVE));
+      dvbindex_log(DVBIDX_LOG_CAT_DVBINDEX, DVBIDX_LOG_SEVERITY_INFO,
+                   "Saved %s\n", file_name_from_path(filename));
+      ts_file_read_ctx_destroy(&ctx);
+      return 0;
+    }
+    fseeko(ctx.file, 0, SEEK_SET);
+    profile = PROBE_PROFILE_FULL;
   }
 
   /* ffmpeg is used as the main reading driver of the files that we read. dvbpsi
@@ -650,23 +2331,47 @@ static int read_ts_file(db_export *db, const char *filename) {
   AVIOContext *avio_ctx;
 
   if (!(fmt_ctx = avformat_alloc_context())) {
-    return AVERROR(ENOMEM);
-  }
-
-  uint8_t *avio_ctx_buffer = av_malloc(BUF_SIZE);
-  if (!avio_ctx_buffer) {
     ret = AVERROR(ENOMEM);
     goto beach;
   }
 
-  avio_ctx = avio_alloc_context(avio_ctx_buffer, BUF_SIZE, 0, &ctx, read_packet,
-                                0, seek_packet);
+  if (!pool->avio_buffer) {
+    pool->avio_buffer = av_malloc(BUF_SIZE);
+    pool->avio_buffer_size = BUF_SIZE;
+    if (!pool->avio_buffer) {
+      ret = AVERROR(ENOMEM);
+      goto beach;
+    }
+  }
+
+  avio_ctx = avio_alloc_context(pool->avio_buffer, pool->avio_buffer_size, 0,
+                                &ctx, read_packet, 0, seek_packet);
   if (!avio_ctx) {
     ret = AVERROR(ENOMEM);
     goto beach;
   }
+  /* the buffer belongs to avio_ctx until the file is done. */
+  pool->avio_buffer = 0;
   fmt_ctx->pb = avio_ctx;
 
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(58, 20, 100)
+  /* the duration is measured from the PCRs instead, which avoids ffmpeg
+   * seeking to the end of the file for the last timestamps. */
+  fmt_ctx->skip_estimate_duration_from_pts = 1;
+#endif
+
+  if (profile == PROBE_PROFILE_FAST) {
+    /* the mpegts demuxer already uses probesize when looking for the PMTs in
+     * avformat_open_input(). */
+    fmt_ctx->probesize = opts->probe_size;
+    fmt_ctx->max_analyze_duration = opts->analyze_duration;
+    /* the frame rates come from the headers, without waiting for 20 frames of
+     * each video stream. */
+    fmt_ctx->fps_probe_size = 0;
+    /* the packets read while probing are never used. */
+    fmt_ctx->flags |= AVFMT_FLAG_NOBUFFER;
+  }
+
   /* restrict the possible input formats to mpegts only. */
   ret = avformat_open_input(&fmt_ctx, 0, mpegts_format, 0);
   if (ret < 0) {
@@ -674,30 +2379,17 @@ static int read_ts_file(db_export *db, const char *filename) {
   }
 
   /* this calls our own I/O callbacks. */
-  ret = avformat_find_stream_info(fmt_ctx, 0);
+  ret = probe_stream_info(fmt_ctx, profile, ctx.dvbpsi_parse);
   if (ret < 0) {
     goto beach2;
   }
 
-  /* ffmpeg is not really required to read the file until the end, since it can
-   * jump over parts it doesn't really care about. ensure that all the PSI data
-   * is submitted, though. */
-  {
-    fseeko(ctx.file, ctx.dvbpsi_state.last_pos, SEEK_SET);
-    size_t readsize;
-    uint8_t buf[BUF_SIZE];
-    do {
-      readsize = fread(buf, 1, BUF_SIZE, ctx.file);
-      push_to_dvbpsi(&ctx, buf, readsize);
-    } while (readsize);
+  ret = feed_dvbpsi_to_end(&ctx);
+  if (ret < 0) {
+    goto beach2;
   }
-
-  /* it is possible that we got here without a PAT, which means that the file
-   * won't have a database rowid. but ffmpeg might've registered some streams
-   * even without a PAT, and we need a valid rowid to insert streams. */
-  ensure_file_has_rowid(&ctx.dvbpsi_parse);
-  db_export_av_streams(db, ctx.dvbpsi_parse.file_rowid, fmt_ctx->nb_streams,
-                       fmt_ctx->streams);
+  export_file_tables(&ctx, db, probe_profile_name(profile));
+  export_ffmpeg_streams(db, ctx.dvbpsi_parse, fmt_ctx);
 
   dvbindex_log(DVBIDX_LOG_CAT_DVBINDEX, DVBIDX_LOG_SEVERITY_INFO, "Saved %s\n",
                file_name_from_path(filename));
@@ -705,8 +2397,10 @@ static int read_ts_file(db_export *db, const char *filename) {
   ret = 0;
 
 beach2:
-  /* the internal buffer could have changed, and be != avio_ctx_buffer */
-  av_freep(&avio_ctx->buffer);
+  /* the internal buffer could have changed, and be != the one it was given.
+   * whichever it is now serves the next file. */
+  pool->avio_buffer = avio_ctx->buffer;
+  pool->avio_buffer_size = avio_ctx->buffer_size;
   av_freep(&avio_ctx);
 
 beach:
@@ -716,37 +2410,578 @@ beach:
   return ret;
 }
 
-/* no other way to pass this to the nftw() callback, sadly. */
-static db_export *g_db;
+static void rederive_packet_cbk(void *cbk_data, uint8_t *packet) {
+  psi_parse_state *state = cbk_data;
+  if (!state->mem_exceeded) {
+    psi_push_section_packet(state, ts_extract_pid(packet), packet);
+  }
+}
 
-static int nftw_cbk(const char *fpath, const struct stat *sb, int typeflag,
-                    struct FTW *ftwbuf) {
-  if (typeflag == FTW_F) {
-    int rv = read_ts_file(g_db, fpath);
-    const char *name = file_name_from_path(fpath);
-    switch (rv) {
-    case 0:
-      break;
+/* the archived sections are put back into TS packets and handed to the same
+ * decoders as when reading the file, in the order they were first seen. only
+ * the tables derived from the PSI and SI are filled. */
+static int rederive_file(read_pool *pool, db_export *db, const read_opts *opts,
+                         const archived_file *f) {
+  section_archive archive;
+  section_archive_init(&archive);
+  uint8_t *cc = calloc(TS_PID_COUNT, 1);
+  if (!cc || !db_load_archived_sections(db, f->rowid, &archive)) {
+    free(cc);
+    section_archive_destroy(&archive);
+    return ENOMEM;
+  }
 
-    case AVERROR(ENOMEM):
-      /* don't process any more files, don't print, try to exit cleanly. */
-      return ENOMEM;
+  ts_file_read_ctx ctx;
+  ctx.file = 0;
+  ctx.file_name = f->name;
+  ctx.file_size = f->size;
+  ctx.dvbpsi_parse = &pool->parse;
+  ctx.dvbpsi_parse->file_ctx = &ctx;
+  psi_parse_state *state = ctx.dvbpsi_parse;
+  psi_handle_vec_init(state, pool, db, opts->psi_mem_limit);
+  state->archive_sections = 0;
+
+  uint8_t section[SECTION_MAX_SIZE];
+  for (size_t i = 0; i < archive.sections.size; ++i) {
+    const archived_section *s = archive.sections.data + i;
+    const size_t size = archived_section_uncompress(s, section);
+    if (size == 0) {
+      dvbindex_log(DVBIDX_LOG_CAT_DVBINDEX, DVBIDX_LOG_SEVERITY_WARNING,
+                   "%s : corrupt archived section at %lld\n", f->name,
+                   (long long int)s->file_offset);
+      continue;
+    }
+    state->packet_offset = s->file_offset;
+    section_packetize(section, size, s->pid, &cc[s->pid], rederive_packet_cbk,
+                      state);
+  }
+
+  state->packet_offset = f->size;
+  psi_flush_batches(state);
+  psi_export_version_spans(state);
+  ensure_file_has_rowid(state);
+  dvbindex_log(DVBIDX_LOG_CAT_DVBINDEX, DVBIDX_LOG_SEVERITY_INFO,
+               "Rederived %s\n", f->name);
 
-    case AVERROR_EOF:
+  ts_file_read_ctx_destroy(&ctx);
+  free(cc);
+  section_archive_destroy(&archive);
+  return 0;
+}
+
+int read_rederive(db_export *db, const read_opts *opts) {
+  vec_archived_file files;
+  if (!vec_archived_file_init(&files)) {
+    return ENOMEM;
+  }
+  int rv = db_load_archived_files(db, &files) ? 0 : ENOMEM;
+  read_pool pool;
+  read_pool_init(&pool);
+  for (size_t i = 0; i < files.size && rv == 0; ++i) {
+    const archived_file *f = files.data + i;
+    if (db_has_file(db, f->name, f->size)) {
       dvbindex_log(DVBIDX_LOG_CAT_DVBINDEX, DVBIDX_LOG_SEVERITY_INFO,
-                   "%s does not look like a MPEG-TS\n", name);
-      break;
+                   "%s [%lld] already in database, skipping\n", f->name,
+                   (long long int)f->size);
+      continue;
+    }
+    rv = rederive_file(&pool, db, opts, f);
+  }
+  read_pool_destroy(&pool);
+  for (size_t i = 0; i < files.size; ++i) {
+    free(files.data[i].name);
+  }
+  vec_archived_file_destroy(&files);
+  return rv;
+}
+
+/* returns 1 if no more files should be read. */
+static int report_read_result(const char *path, int rv) {
+  const char *name = file_name_from_path(path);
+  switch (rv) {
+  case 0:
+    break;
+
+  case AVERROR(ENOMEM):
+    /* don't process any more files, don't print, try to exit cleanly. */
+    return 1;
+
+  case AVERROR_EOF:
+    dvbindex_log(DVBIDX_LOG_CAT_DVBINDEX, DVBIDX_LOG_SEVERITY_INFO,
+                 "%s does not look like a MPEG-TS\n", name);
+    break;
+
+  default:
+    dvbindex_log(DVBIDX_LOG_CAT_DVBINDEX, DVBIDX_LOG_SEVERITY_CRITICAL,
+                 "Error while reading %s : %s\n", name, av_err2str(rv));
+  }
+  return 0;
+}
+
+/* the workers export each file into a private database in memory, whose image
+ * goes through this queue to the thread owning the real database. */
+typedef struct db_image_ {
+  void *data;
+  sqlite3_int64 size;
+} db_image;
+VEC_DEFINE(db_image)
+
+typedef struct read_workers_ {
+  db_export *db;
+  const read_opts *opts;
+  const char *path;
+  /* set when the walk reads the files it finds itself, one by one. */
+  read_pool *pool;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  /* the files in the database, and the ones met before during the walk,
+   * which are all left out. */
+  file_set seen_files;
+  /* the files whose sections were archived. */
+  file_set archived_files;
+  /* the files found by the walk and not taken by a worker yet. the walk waits
+   * for the queue to shrink below max_jobs. */
+  vec_read_job jobs;
+  size_t max_jobs;
+  int walking;
+  int walk_result;
+  int out_of_memory;
+  /* some rows could not be written. nothing more is read, since they would be
+   * lost as well. */
+  int write_failed;
+  /* the workers still running, and whether more might be started. the queue
+   * is done once both are 0. */
+  unsigned int active;
+  int starting;
+  vec_db_image images;
+  /* the workers wait for the queue to shrink below this. */
+  size_t max_images;
+} read_workers;
+
+typedef struct read_worker_ {
+  read_workers *shared;
+  read_pool pool;
+  db_export db;
+  pthread_t thread;
+} read_worker;
+
+static int read_workers_stopped(const read_workers *s) {
+  return s->out_of_memory || s->write_failed;
+}
+
+/* returns 0 if the file won't be read. */
+static int read_workers_push_job(read_workers *s, read_job job) {
+  pthread_mutex_lock(&s->lock);
+  while (s->jobs.size >= s->max_jobs && !read_workers_stopped(s)) {
+    pthread_cond_wait(&s->changed, &s->lock);
+  }
+  const int stopped = read_workers_stopped(s);
+  const int rv = !stopped && vec_read_job_push(&s->jobs, job);
+  if (!rv) {
+    free(job.path);
+    s->out_of_memory |= !stopped;
+  }
+  pthread_cond_broadcast(&s->changed);
+  pthread_mutex_unlock(&s->lock);
+  return rv;
+}
 
-    default:
-      dvbindex_log(DVBIDX_LOG_CAT_DVBINDEX, DVBIDX_LOG_SEVERITY_CRITICAL,
-                   "Error while reading %s : %s\n", name, av_err2str(rv));
+/* returns 0 once there won't be any more files to read, and -1 if there's none
+ * right now and wait is 0. */
+static int read_workers_next_job(read_workers *s, read_job *job, int wait) {
+  pthread_mutex_lock(&s->lock);
+  while (wait && s->jobs.size == 0 && s->walking && !read_workers_stopped(s)) {
+    pthread_cond_wait(&s->changed, &s->lock);
+  }
+  int rv = 0;
+  if (!read_workers_stopped(s) && s->jobs.size > 0) {
+    *job = s->jobs.data[0];
+    memmove(s->jobs.data, s->jobs.data + 1,
+            (s->jobs.size - 1) * sizeof(*s->jobs.data));
+    --s->jobs.size;
+    rv = 1;
+  } else if (!read_workers_stopped(s) && s->walking) {
+    rv = -1;
+  }
+  pthread_cond_broadcast(&s->changed);
+  pthread_mutex_unlock(&s->lock);
+  return rv;
+}
+
+/* returns 0 if the image won't be written. */
+static int read_workers_push_image(read_workers *s, db_image image) {
+  pthread_mutex_lock(&s->lock);
+  while (s->images.size >= s->max_images && !s->write_failed) {
+    pthread_cond_wait(&s->changed, &s->lock);
+  }
+  const int rv = !s->write_failed && vec_db_image_push(&s->images, image);
+  if (!rv) {
+    sqlite3_free(image.data);
+    s->out_of_memory |= !s->write_failed;
+  }
+  pthread_cond_broadcast(&s->changed);
+  pthread_mutex_unlock(&s->lock);
+  return rv;
+}
+
+static void read_workers_write_failed(read_workers *s) {
+  pthread_mutex_lock(&s->lock);
+  s->write_failed = 1;
+  pthread_cond_broadcast(&s->changed);
+  pthread_mutex_unlock(&s->lock);
+}
+
+/* waits for some images, and returns 0 once there won't be any more. */
+static size_t read_workers_pop_images(read_workers *s, db_image *images,
+                                      size_t max) {
+  pthread_mutex_lock(&s->lock);
+  while (s->images.size == 0 && (s->active || s->starting)) {
+    pthread_cond_wait(&s->changed, &s->lock);
+  }
+  const size_t count = s->images.size < max ? s->images.size : max;
+  memcpy(images, s->images.data, count * sizeof(*images));
+  memmove(s->images.data, s->images.data + count,
+          (s->images.size - count) * sizeof(*images));
+  s->images.size -= count;
+  pthread_cond_broadcast(&s->changed);
+  pthread_mutex_unlock(&s->lock);
+  return count;
+}
+
+static void read_workers_exit(read_workers *s, int out_of_memory) {
+  pthread_mutex_lock(&s->lock);
+  s->out_of_memory |= out_of_memory;
+  --s->active;
+  pthread_cond_broadcast(&s->changed);
+  pthread_mutex_unlock(&s->lock);
+}
+
+/* the files of the other shards and the ones already in the database are left
+ * out, as are the ones met before during the walk. */
+static int read_walk_file_cbk(void *opaque, const char *path, int64_t size) {
+  read_workers *s = opaque;
+  const char *name = file_name_from_path(path);
+  const uint64_t key = file_key(name, size);
+  if (key % s->opts->shards != s->opts->shard) {
+    return 0;
+  }
+  read_job job;
+  pthread_mutex_lock(&s->lock);
+  const int inserted = file_set_insert(&s->seen_files, name, size);
+  job.archived = file_set_has(&s->archived_files, name, size);
+  pthread_mutex_unlock(&s->lock);
+  if (inserted < 0) {
+    return ENOMEM;
+  }
+  if (inserted == 0) {
+    dvbindex_log(DVBIDX_LOG_CAT_DVBINDEX, DVBIDX_LOG_SEVERITY_INFO,
+                 "%s [%lld] already in database, skipping\n", name,
+                 (long long int)size);
+    return 0;
+  }
+
+  if (s->pool) {
+    job.path = (char *)path;
+    return report_read_result(path, read_ts_file(s->pool, s->db, s->opts, &job))
+               ? ENOMEM
+               : 0;
+  }
+  job.path = strdup(path);
+  if (!job.path) {
+    return ENOMEM;
+  }
+  if (!read_workers_push_job(s, job)) {
+    return s->write_failed ? EIO : ENOMEM;
+  }
+  return 0;
+}
+
+static void *read_walk_main(void *opaque) {
+  read_workers *s = opaque;
+  const int rv = walk_tree(s->path, s->opts->walkers, read_walk_file_cbk, s);
+  pthread_mutex_lock(&s->lock);
+  s->walking = 0;
+  s->walk_result = rv;
+  pthread_cond_broadcast(&s->changed);
+  pthread_mutex_unlock(&s->lock);
+  return 0;
+}
+
+/* returns 0 if the rows of the files read since the last image won't be
+ * written. */
+static int read_worker_push_image(read_worker *w, int *out_of_memory) {
+  db_image image;
+  image.data = db_export_image(&w->db, &image.size);
+  db_export_clear(&w->db);
+  if (!image.data) {
+    *out_of_memory = 1;
+    return 0;
+  }
+  return read_workers_push_image(w->shared, image);
+}
+
+/* the files are gathered in the private database of the worker, whose image
+ * goes to the writer every READ_IMAGE_MAX_FILES files, or as soon as there's
+ * no file to read right away. */
+#define READ_IMAGE_MAX_FILES 16
+
+static void *read_worker_main(void *opaque) {
+  read_worker *w = opaque;
+  read_workers *s = w->shared;
+  int out_of_memory = 0;
+  unsigned int pending = 0;
+  read_job job;
+  for (;;) {
+    const int next = read_workers_next_job(s, &job, pending == 0);
+    if (next <= 0) {
+      if (pending == 0 || !read_worker_push_image(w, &out_of_memory) ||
+          next == 0) {
+        break;
+      }
+      pending = 0;
+      continue;
+    }
+    out_of_memory =
+        report_read_result(job.path, read_ts_file(&w->pool, &w->db, s->opts,
+                                                  &job));
+    free(job.path);
+    if (out_of_memory) {
+      break;
+    }
+    /* whatever the file left in the database is kept, as when reading the
+     * files one by one. */
+    if (++pending == READ_IMAGE_MAX_FILES) {
+      if (!read_worker_push_image(w, &out_of_memory)) {
+        break;
+      }
+      pending = 0;
     }
   }
+  read_workers_exit(s, out_of_memory);
   return 0;
 }
 
-int read_path(db_export *db, const char *path) {
-  g_db = db;
-  /* 20 is taken from nftw's manpage. */
-  return nftw(path, nftw_cbk, 20, FTW_PHYS);
+static const char *const merge_schemas[] = {"w0", "w1", "w2", "w3",
+                                            "w4", "w5", "w6", "w7"};
+
+/* the images are merged a few at a time, each batch in a single transaction.
+ * once some rows couldn't be written, the reading stops and the images still
+ * coming are thrown away : their files aren't in the database, and are read
+ * again by the next run. */
+static void write_images(read_workers *s) {
+  size_t attached = 0;
+  while (attached < ARRAY_SIZE(merge_schemas) &&
+         db_export_attach(s->db, ":memory:", merge_schemas[attached]) ==
+             SQLITE_OK) {
+    ++attached;
+  }
+  int failed = attached == 0;
+  if (failed) {
+    dvbindex_log(DVBIDX_LOG_CAT_SQLITE, DVBIDX_LOG_SEVERITY_CRITICAL,
+                 "Could not attach a database for merging : %s\n",
+                 sqlite3_errmsg(s->db->db));
+    read_workers_write_failed(s);
+  }
+
+  db_image batch[ARRAY_SIZE(merge_schemas)];
+  size_t count;
+  while ((count = read_workers_pop_images(s, batch, failed ? ARRAY_SIZE(batch)
+                                                           : attached)) > 0) {
+    size_t loaded = 0;
+    for (size_t i = 0; i < count; ++i) {
+      if (failed) {
+        sqlite3_free(batch[i].data);
+        continue;
+      }
+      int rv = db_export_load_image(s->db, merge_schemas[loaded],
+                                    batch[i].data, batch[i].size);
+      if (rv == SQLITE_OK) {
+        ++loaded;
+      } else {
+        dvbindex_log(DVBIDX_LOG_CAT_SQLITE, DVBIDX_LOG_SEVERITY_CRITICAL,
+                     "Could not load the rows of some files : %s\n",
+                     sqlite3_errstr(rv));
+        failed = 1;
+      }
+    }
+    int rv = loaded && !failed ? db_export_merge(s->db, merge_schemas, loaded)
+                               : SQLITE_OK;
+    if (rv != SQLITE_OK) {
+      dvbindex_log(DVBIDX_LOG_CAT_SQLITE, DVBIDX_LOG_SEVERITY_CRITICAL,
+                   "Could not merge the rows of some files : %s\n",
+                   sqlite3_errstr(rv));
+      failed = 1;
+    }
+    if (failed) {
+      read_workers_write_failed(s);
+    }
+  }
+
+  for (size_t i = 0; i < attached; ++i) {
+    db_export_detach(s->db, merge_schemas[i]);
+  }
+}
+
+/* the files are read in the order the walk finds them, with a single walker :
+ * the rowids of a given tree are always the same. */
+static int read_path_serial(read_workers *s) {
+  read_pool pool;
+  read_pool_init(&pool);
+  s->pool = &pool;
+  const int rv = walk_tree(s->path, 1, read_walk_file_cbk, s);
+  s->pool = 0;
+  read_pool_destroy(&pool);
+  return rv;
+}
+
+/* the walk hands the files it finds to the workers as it goes. each worker
+ * reads whole files with its own parse state and database, while the calling
+ * thread is the only one writing to the real database. */
+static int read_path_parallel(read_workers *s) {
+  const unsigned int count = s->opts->jobs;
+  read_worker *workers = calloc(count, sizeof(*workers));
+  if (!workers) {
+    return ENOMEM;
+  }
+  s->walking = 1;
+  s->starting = 1;
+  s->max_jobs = 2 * (size_t)count;
+  s->max_images = 2 * (size_t)count;
+
+  unsigned int started = 0;
+  for (; started < count; ++started) {
+    read_worker *w = workers + started;
+    char *error = 0;
+    w->shared = s;
+    if (db_export_init(&w->db, ":memory:", &error) != SQLITE_OK) {
+      sqlite3_free(error);
+      break;
+    }
+    read_pool_init(&w->pool);
+    pthread_mutex_lock(&s->lock);
+    ++s->active;
+    pthread_mutex_unlock(&s->lock);
+    if (pthread_create(&w->thread, 0, read_worker_main, w) != 0) {
+      pthread_mutex_lock(&s->lock);
+      --s->active;
+      pthread_mutex_unlock(&s->lock);
+      read_pool_destroy(&w->pool);
+      db_export_close(&w->db);
+      break;
+    }
+  }
+
+  pthread_t walk_thread;
+  const int walk_started =
+      started > 0 && pthread_create(&walk_thread, 0, read_walk_main, s) == 0;
+  pthread_mutex_lock(&s->lock);
+  if (!walk_started) {
+    s->walking = 0;
+  }
+  s->starting = 0;
+  pthread_cond_broadcast(&s->changed);
+  pthread_mutex_unlock(&s->lock);
+
+  int rv;
+  if (started == 0) {
+    rv = read_path_serial(s);
+  } else {
+    write_images(s);
+    rv = s->write_failed    ? EIO
+         : s->out_of_memory ? ENOMEM
+         : walk_started     ? 0
+                            : EAGAIN;
+  }
+
+  if (walk_started) {
+    pthread_join(walk_thread, 0);
+    if (rv == 0) {
+      rv = s->walk_result;
+    }
+  }
+  for (unsigned int i = 0; i < started; ++i) {
+    pthread_join(workers[i].thread, 0);
+    read_pool_destroy(&workers[i].pool);
+    db_export_close(&workers[i].db);
+  }
+  free(workers);
+  return rv;
+}
+
+void read_opts_init(read_opts *opts) {
+  opts->psi_mem_limit = READ_DEFAULT_PSI_MEM_LIMIT;
+  opts->probe = PROBE_PROFILE_NATIVE;
+  opts->probe_size = READ_DEFAULT_FAST_PROBE_SIZE;
+  opts->analyze_duration = READ_DEFAULT_FAST_ANALYZE_DURATION;
+  opts->psi_only = 0;
+  const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  opts->jobs = cpus > 0 ? (unsigned int)cpus : 1;
+  opts->walkers = READ_DEFAULT_WALKERS;
+  opts->shard = 0;
+  opts->shards = 1;
+}
+
+static const char *probe_profile_names[] = {"full", "fast", "native"};
+
+int probe_profile_from_name(const char *name) {
+  for (size_t i = 0; i < ARRAY_SIZE(probe_profile_names); ++i) {
+    if (strcmp(name, probe_profile_names[i]) == 0) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+const char *probe_profile_name(probe_profile p) {
+  return probe_profile_names[p];
+}
+
+int read_path(db_export *db, const read_opts *opts, const char *path) {
+  read_workers s;
+  s.db = db;
+  s.opts = opts;
+  s.path = path;
+  s.pool = 0;
+  s.max_jobs = 0;
+  s.walking = 0;
+  s.walk_result = 0;
+  s.out_of_memory = 0;
+  s.write_failed = 0;
+  s.active = 0;
+  s.starting = 0;
+  s.max_images = 0;
+  file_set_init(&s.seen_files);
+  file_set_init(&s.archived_files);
+  if (!vec_read_job_init(&s.jobs)) {
+    return ENOMEM;
+  }
+  if (!vec_db_image_init(&s.images)) {
+    vec_read_job_destroy(&s.jobs);
+    return ENOMEM;
+  }
+  pthread_mutex_init(&s.lock, 0);
+  pthread_cond_init(&s.changed, 0);
+
+  int rv = ENOMEM;
+  if (db_load_files(db, 0, &s.seen_files) &&
+      db_load_files(db, 1, &s.archived_files)) {
+    /* a single file gets the same rowids as when it's read alone. */
+    struct stat st;
+    const int single_file = lstat(path, &st) == 0 && S_ISREG(st.st_mode);
+    rv = opts->jobs > 1 && DB_EXPORT_HAS_IMAGES && !single_file
+             ? read_path_parallel(&s)
+             : read_path_serial(&s);
+  }
+
+  /* only left over when reading was stopped. */
+  for (size_t i = 0; i < s.jobs.size; ++i) {
+    free(s.jobs.data[i].path);
+  }
+  pthread_cond_destroy(&s.changed);
+  pthread_mutex_destroy(&s.lock);
+  vec_db_image_destroy(&s.images);
+  vec_read_job_destroy(&s.jobs);
+  file_set_destroy(&s.archived_files);
+  file_set_destroy(&s.seen_files);
+  return rv;
 }
@@ -18,9 +18,61 @@ Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #ifndef DVBINDEX_READ_H
 #define DVBINDEX_READ_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 typedef struct db_export_ db_export;
 
-int read_path(db_export* db, const char* path);
+#define READ_DEFAULT_PSI_MEM_LIMIT (64 * 1024 * 1024)
+
+/* how much of a file ffmpeg reads for finding the parameters of its streams.
+ * the fast profile reads less, and stops as soon as the audio and video ES of
+ * all the PMTs had a complete frame. the native profile parses the headers of
+ * the ES itself, and only uses ffmpeg with the full profile for the files with
+ * ES it couldn't parse. */
+typedef enum probe_profile_ {
+  PROBE_PROFILE_FULL,
+  PROBE_PROFILE_FAST,
+  PROBE_PROFILE_NATIVE
+} probe_profile;
+
+#define READ_DEFAULT_FAST_PROBE_SIZE (1024 * 1024)
+/* in microseconds. */
+#define READ_DEFAULT_FAST_ANALYZE_DURATION 1000000
+
+#define READ_DEFAULT_WALKERS 4
+
+typedef struct read_opts_ {
+  /* upper bound for the memory used by the PSI parse state of a single file.
+   * 0 means no limit. */
+  size_t psi_mem_limit;
+  probe_profile probe;
+  /* only used by the fast profile. */
+  int64_t probe_size;
+  int64_t analyze_duration;
+  /* only the PSI and SI are indexed, by reading the files sequentially
+   * without ffmpeg. the stream tables are left alone. */
+  int psi_only;
+  /* the number of files read at the same time. the default is the number of
+   * online CPUs. */
+  unsigned int jobs;
+  /* the number of threads exploring the directories, each having at most one
+   * of them open. */
+  unsigned int walkers;
+  /* only the files whose file_key() modulo shards is shard are read, so that
+   * several hosts can each index a slice of the same tree. */
+  unsigned int shard;
+  unsigned int shards;
+} read_opts;
+
+void read_opts_init(read_opts *opts);
+/* returns -1 if the name is not a known profile. */
+int probe_profile_from_name(const char *name);
+const char *probe_profile_name(probe_profile p);
+int read_path(db_export* db, const read_opts *opts, const char* path);
+/* rebuilds the tables derived from the PSI and SI of the archived files which
+ * are not in the database, using only their archived sections. */
+int read_rederive(db_export *db, const read_opts *opts);
 int ffmpeg_init(void);
 
 #endif
@@ -0,0 +1,191 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "scte35.h"
+#include "section.h"
+
+#define CRC_SIZE 4
+#define SPLICE_INFO_HEADER_SIZE 14
+#define PTS_MASK ((INT64_C(1) << 33) - 1)
+
+void splice_batch_init(splice_batch *batch) {
+  vec_splice_event_init(&batch->events);
+  batch->mem_used = 0;
+}
+
+void splice_batch_clear(splice_batch *batch) {
+  batch->events.size = 0;
+  batch->mem_used = 0;
+}
+
+void splice_batch_destroy(splice_batch *batch) {
+  vec_splice_event_destroy(&batch->events);
+}
+
+static int64_t read_33_bits(const uint8_t *p) {
+  return ((int64_t)(p[0] & 0x01) << 32) | ((int64_t)p[1] << 24) |
+         (p[2] << 16) | (p[3] << 8) | p[4];
+}
+
+/* decodes a splice_time(), returning the number of bytes it spans or 0 if it
+ * does not fit. */
+static size_t decode_splice_time(const uint8_t *pos, const uint8_t *end,
+                                 int64_t pts_adjustment, int64_t *pts) {
+  if (pos >= end) {
+    return 0;
+  }
+  const int time_specified = pos[0] & 0x80;
+  if (!time_specified) {
+    *pts = -1;
+    return 1;
+  }
+  if (end - pos < 5) {
+    return 0;
+  }
+  *pts = (read_33_bits(pos) + pts_adjustment) & PTS_MASK;
+  return 5;
+}
+
+static int decode_splice_insert(splice_event *ev, const uint8_t *pos,
+                                const uint8_t *end, int64_t pts_adjustment) {
+  if (end - pos < 5) {
+    return 0;
+  }
+  ev->splice_event_id = ((uint32_t)pos[0] << 24) | (pos[1] << 16) |
+                        (pos[2] << 8) | pos[3];
+  ev->cancel = (pos[4] & 0x80) != 0;
+  pos += 5;
+  if (ev->cancel) {
+    return 1;
+  }
+
+  if (pos >= end) {
+    return 0;
+  }
+  ev->out_of_network = (pos[0] & 0x80) != 0;
+  const int program_splice = pos[0] & 0x40;
+  const int has_duration = pos[0] & 0x20;
+  ev->immediate = (pos[0] & 0x10) != 0;
+  ++pos;
+
+  if (program_splice) {
+    if (!ev->immediate) {
+      size_t len = decode_splice_time(pos, end, pts_adjustment, &ev->pts);
+      if (!len) {
+        return 0;
+      }
+      pos += len;
+    }
+  } else {
+    /* component splices : only the time of the first component is kept. */
+    if (pos >= end) {
+      return 0;
+    }
+    const uint8_t component_count = *pos++;
+    for (uint8_t i = 0; i < component_count; ++i) {
+      int64_t pts;
+      if (pos >= end) {
+        return 0;
+      }
+      ++pos;
+      if (!ev->immediate) {
+        size_t len = decode_splice_time(pos, end, pts_adjustment, &pts);
+        if (!len) {
+          return 0;
+        }
+        pos += len;
+        if (i == 0) {
+          ev->pts = pts;
+        }
+      }
+    }
+  }
+
+  if (has_duration) {
+    if (end - pos < 5) {
+      return 0;
+    }
+    ev->auto_return = (pos[0] & 0x80) != 0;
+    ev->break_duration = read_33_bits(pos);
+    pos += 5;
+  }
+
+  if (end - pos < 4) {
+    return 0;
+  }
+  ev->unique_program_id = (pos[0] << 8) | pos[1];
+  return 1;
+}
+
+int splice_batch_add_section(splice_batch *batch, const uint8_t *section,
+                             size_t size, uint16_t pid, int64_t file_offset) {
+  /* the section_syntax_indicator is 0, but a CRC_32 is present all the same,
+   * so the section reader can't check it for us. */
+  if (section[0] != SCTE35_TABLE_ID ||
+      size < SPLICE_INFO_HEADER_SIZE + CRC_SIZE) {
+    return 0;
+  }
+  if (section_crc32(section, size)) {
+    return -1;
+  }
+  const int encrypted = section[4] & 0x80;
+  if (encrypted) {
+    return 0;
+  }
+  const uint8_t command_type = section[13];
+  if (command_type != SPLICE_INSERT_COMMAND &&
+      command_type != TIME_SIGNAL_COMMAND) {
+    return 0;
+  }
+
+  const int64_t pts_adjustment = read_33_bits(section + 4);
+  const size_t command_length = ((section[11] & 0x0f) << 8) | section[12];
+  const uint8_t *pos = section + SPLICE_INFO_HEADER_SIZE;
+  const uint8_t *end = section + size - CRC_SIZE;
+  /* 0xfff is the legacy value for an unspecified length. */
+  if (command_length != 0xfff && pos + command_length <= end) {
+    end = pos + command_length;
+  }
+
+  splice_event ev;
+  ev.file_offset = file_offset;
+  ev.pts = -1;
+  ev.break_duration = -1;
+  ev.splice_event_id = -1;
+  ev.unique_program_id = -1;
+  ev.cancel = -1;
+  ev.out_of_network = -1;
+  ev.immediate = -1;
+  ev.auto_return = -1;
+  ev.pid = pid;
+  ev.command_type = command_type;
+  if (command_type == SPLICE_INSERT_COMMAND) {
+    if (!decode_splice_insert(&ev, pos, end, pts_adjustment)) {
+      return 0;
+    }
+  } else if (!decode_splice_time(pos, end, pts_adjustment, &ev.pts)) {
+    return 0;
+  }
+
+  splice_event *dst = vec_splice_event_write(&batch->events);
+  if (!dst) {
+    return 0;
+  }
+  *dst = ev;
+  batch->mem_used += sizeof(*dst);
+  return 1;
+}
@@ -0,0 +1,67 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef DVBINDEX_SCTE35_H
+#define DVBINDEX_SCTE35_H
+
+#include "vec.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* decoding of the SCTE-35 splice_info sections, carried on the PIDs with
+ * stream_type 0x86. */
+
+#define SCTE35_STREAM_TYPE 0x86
+#define SCTE35_TABLE_ID 0xfc
+
+#define SPLICE_INSERT_COMMAND 0x05
+#define TIME_SIGNAL_COMMAND 0x06
+
+/* the fields which don't apply to the command are -1. times and durations are
+ * in 90kHz units, with the pts_adjustment already applied. */
+typedef struct splice_event_ {
+  int64_t file_offset;
+  int64_t pts;
+  int64_t break_duration;
+  int64_t splice_event_id;
+  int32_t unique_program_id;
+  int8_t cancel;
+  int8_t out_of_network;
+  int8_t immediate;
+  int8_t auto_return;
+  uint16_t pid;
+  uint8_t command_type;
+} splice_event;
+VEC_DEFINE(splice_event)
+
+/* splice commands waiting to be written to the database. */
+typedef struct splice_batch_ {
+  vec_splice_event events;
+  size_t mem_used;
+} splice_batch;
+
+void splice_batch_init(splice_batch *batch);
+void splice_batch_clear(splice_batch *batch);
+void splice_batch_destroy(splice_batch *batch);
+/* decodes the splice_insert or time_signal command of a splice_info section
+ * found at file_offset. returns -1 if its CRC_32 is wrong, and 0 if the section
+ * is malformed, encrypted, or carries another command. */
+int splice_batch_add_section(splice_batch *batch, const uint8_t *section,
+                             size_t size, uint16_t pid, int64_t file_offset);
+
+#endif
@@ -0,0 +1,79 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef DVBINDEX_SECTION_H
+#define DVBINDEX_SECTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* reassembly of PSI sections from TS packets, for tables which dvbpsi has no
+ * decoder for, or for which its decoders don't fit our needs. */
+
+#define SECTION_MAX_SIZE 4096
+
+/* crc_ok is always 1 for sections without the section_syntax_indicator, since
+ * these aren't guaranteed to carry a CRC_32. offset is the one which was pushed
+ * along with the packet where the section starts. */
+typedef void (*section_cbk)(void *cbk_data, uint16_t pid,
+                            const uint8_t *section, size_t size,
+                            int64_t offset, int crc_ok);
+
+typedef struct section_reader_ {
+  uint8_t buf[SECTION_MAX_SIZE];
+  size_t fill;
+  size_t need;
+  int64_t offset;
+  section_cbk cbk;
+  void *cbk_data;
+  uint16_t pid;
+  uint8_t continuity_counter;
+  uint8_t synced;
+} section_reader;
+
+void section_reader_init(section_reader *reader, uint16_t pid, section_cbk cbk,
+                         void *cbk_data);
+void section_reader_push(section_reader *reader, const uint8_t *packet,
+                         int64_t offset);
+
+uint32_t section_crc32(const uint8_t *data, size_t size);
+
+static inline uint16_t section_length(const uint8_t *section) {
+  return ((section[1] & 0x0f) << 8) | section[2];
+}
+
+static inline int section_has_syntax(const uint8_t *section) {
+  return (section[1] & 0x80) != 0;
+}
+
+/* set of sections already seen, identified by a 64-bit key which should
+ * include the section's CRC_32. */
+typedef struct section_set_ {
+  uint64_t *keys;
+  size_t size;
+  size_t cap;
+  int has_zero;
+} section_set;
+
+void section_set_init(section_set *set);
+void section_set_destroy(section_set *set);
+/* returns 1 if the key was not present in the set before, 0 otherwise. */
+int section_set_insert(section_set *set, uint64_t key);
+/* memory used by the set after inserting one more key. */
+size_t section_set_growth(const section_set *set);
+
+#endif
@@ -0,0 +1,312 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "si.h"
+#include "dvbstring.h"
+#include "section.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* MJD of 1970-01-01. */
+#define MJD_UNIX_EPOCH 40587
+
+static int bcd_to_int(uint8_t bcd) {
+  if ((bcd >> 4) > 9 || (bcd & 0x0f) > 9) {
+    return -1;
+  }
+  return (bcd >> 4) * 10 + (bcd & 0x0f);
+}
+
+int32_t si_bcd_duration(const uint8_t *p) {
+  int h = bcd_to_int(p[0]);
+  int m = bcd_to_int(p[1]);
+  int s = bcd_to_int(p[2]);
+  if (h < 0 || m < 0 || s < 0) {
+    return -1;
+  }
+  return h * 3600 + m * 60 + s;
+}
+
+int64_t si_utc_time_to_unix(const uint8_t *p) {
+  const uint16_t mjd = (p[0] << 8) | p[1];
+  int32_t time = si_bcd_duration(p + 2);
+  if (mjd == 0xffff || time < 0) {
+    return -1;
+  }
+  return ((int64_t)mjd - MJD_UNIX_EPOCH) * 86400 + time;
+}
+
+int si_descriptor_next(const uint8_t **pos, const uint8_t *end, uint8_t *tag,
+                       const uint8_t **data, uint8_t *length) {
+  const uint8_t *p = *pos;
+  if (end - p < 2 || end - p - 2 < p[1]) {
+    return 0;
+  }
+  *tag = p[0];
+  *length = p[1];
+  *data = p + 2;
+  *pos = p + 2 + p[1];
+  return 1;
+}
+
+void eit_batch_init(eit_batch *batch) {
+  vec_eit_section_init(&batch->sections);
+  vec_eit_event_init(&batch->events);
+  batch->mem_used = 0;
+}
+
+void eit_batch_clear(eit_batch *batch) {
+  for (size_t i = 0; i < batch->events.size; ++i) {
+    free(batch->events.data[i].name);
+    free(batch->events.data[i].text);
+  }
+  batch->sections.size = 0;
+  batch->events.size = 0;
+  batch->mem_used = 0;
+}
+
+void eit_batch_destroy(eit_batch *batch) {
+  eit_batch_clear(batch);
+  vec_eit_section_destroy(&batch->sections);
+  vec_eit_event_destroy(&batch->events);
+}
+
+#define SHORT_EVENT_DR_TAG 0x4d
+
+static void decode_short_event_dr(eit_event *ev, const uint8_t *data,
+                                  uint8_t length) {
+  /* ISO_639_language_code, event_name_length, name, text_length, text. */
+  if (length < 5 || ev->name) {
+    return;
+  }
+  const uint8_t name_length = data[3];
+  if (4 + name_length + 1 > length) {
+    return;
+  }
+  const uint8_t text_length = data[4 + name_length];
+  if (5 + name_length + text_length > length) {
+    return;
+  }
+  memcpy(ev->language, data, sizeof(ev->language));
+  ev->has_language = 1;
+  ev->name = dvbstring_to_utf8(data + 4, name_length, &ev->name_length);
+  ev->text = dvbstring_to_utf8(data + 5 + name_length, text_length,
+                               &ev->text_length);
+}
+
+static void decode_event_descriptors(eit_event *ev, const uint8_t *pos,
+                                     const uint8_t *end) {
+  uint8_t tag, length;
+  const uint8_t *data;
+  while (si_descriptor_next(&pos, end, &tag, &data, &length)) {
+    switch (tag) {
+    case SHORT_EVENT_DR_TAG:
+      decode_short_event_dr(ev, data, length);
+      break;
+    }
+  }
+}
+
+#define EIT_HEADER_SIZE 14
+#define EIT_EVENT_HEADER_SIZE 12
+#define CRC_SIZE 4
+
+int eit_batch_add_section(eit_batch *batch, const uint8_t *section,
+                          size_t size) {
+  if (size < EIT_HEADER_SIZE + CRC_SIZE) {
+    return 0;
+  }
+
+  const uint8_t *pos = section + EIT_HEADER_SIZE;
+  const uint8_t *const end = section + size - CRC_SIZE;
+  const size_t first_event = batch->events.size;
+  while (end - pos >= EIT_EVENT_HEADER_SIZE) {
+    const uint16_t loop_length = ((pos[10] & 0x0f) << 8) | pos[11];
+    if (end - pos - EIT_EVENT_HEADER_SIZE < loop_length) {
+      break;
+    }
+    eit_event *ev = vec_eit_event_write(&batch->events);
+    if (!ev) {
+      break;
+    }
+    memset(ev, 0, sizeof(*ev));
+    ev->event_id = (pos[0] << 8) | pos[1];
+    ev->start_time = si_utc_time_to_unix(pos + 2);
+    ev->duration = si_bcd_duration(pos + 7);
+    ev->running_status = pos[10] >> 5;
+    ev->free_ca_mode = (pos[10] >> 4) & 0x01;
+    decode_event_descriptors(ev, pos + EIT_EVENT_HEADER_SIZE,
+                             pos + EIT_EVENT_HEADER_SIZE + loop_length);
+    batch->mem_used += sizeof(*ev) + ev->name_length + ev->text_length;
+    pos += EIT_EVENT_HEADER_SIZE + loop_length;
+  }
+
+  if (pos != end) {
+    /* roll back whatever was decoded from the malformed section. */
+    for (size_t i = first_event; i < batch->events.size; ++i) {
+      eit_event *ev = batch->events.data + i;
+      batch->mem_used -= sizeof(*ev) + ev->name_length + ev->text_length;
+      free(ev->name);
+      free(ev->text);
+    }
+    batch->events.size = first_event;
+    return 0;
+  }
+
+  eit_section *s = vec_eit_section_write(&batch->sections);
+  if (!s) {
+    return 0;
+  }
+  s->table_id = section[0];
+  s->service_id = (section[3] << 8) | section[4];
+  s->version = (section[5] >> 1) & 0x1f;
+  s->section_number = section[6];
+  s->tsid = (section[8] << 8) | section[9];
+  s->onid = (section[10] << 8) | section[11];
+  s->num_events = batch->events.size - first_event;
+  batch->mem_used += sizeof(*s);
+  return 1;
+}
+
+void time_batch_init(time_batch *batch) {
+  vec_time_ref_init(&batch->refs);
+  vec_local_time_offset_init(&batch->offsets);
+  batch->mem_used = 0;
+  batch->last_offsets_crc = 0;
+  batch->has_offsets = 0;
+}
+
+void time_batch_clear(time_batch *batch) {
+  /* last_offsets_crc is kept on purpose : offsets which did not change are not
+   * stored again after flushing. */
+  batch->refs.size = 0;
+  batch->offsets.size = 0;
+  batch->mem_used = 0;
+}
+
+void time_batch_reset(time_batch *batch) {
+  time_batch_clear(batch);
+  batch->last_offsets_crc = 0;
+  batch->has_offsets = 0;
+}
+
+void time_batch_destroy(time_batch *batch) {
+  vec_time_ref_destroy(&batch->refs);
+  vec_local_time_offset_destroy(&batch->offsets);
+}
+
+static int bcd_offset_to_minutes(const uint8_t *p) {
+  int h = bcd_to_int(p[0]);
+  int m = bcd_to_int(p[1]);
+  return (h < 0 || m < 0) ? 0 : h * 60 + m;
+}
+
+#define LOCAL_TIME_OFFSET_DR_TAG 0x58
+#define LOCAL_TIME_OFFSET_ENTRY_SIZE 13
+
+static size_t decode_local_time_offset_dr(vec_local_time_offset *offsets,
+                                          const uint8_t *data,
+                                          uint8_t length) {
+  size_t num_offsets = 0;
+  for (; length >= LOCAL_TIME_OFFSET_ENTRY_SIZE;
+       length -= LOCAL_TIME_OFFSET_ENTRY_SIZE,
+       data += LOCAL_TIME_OFFSET_ENTRY_SIZE) {
+    local_time_offset *lto = vec_local_time_offset_write(offsets);
+    if (!lto) {
+      break;
+    }
+    const int negative = data[3] & 0x01;
+    memcpy(lto->country_code, data, sizeof(lto->country_code));
+    lto->region_id = data[3] >> 2;
+    lto->offset = bcd_offset_to_minutes(data + 4);
+    lto->time_of_change = si_utc_time_to_unix(data + 6);
+    lto->next_offset = bcd_offset_to_minutes(data + 11);
+    if (negative) {
+      lto->offset = -lto->offset;
+      lto->next_offset = -lto->next_offset;
+    }
+    ++num_offsets;
+  }
+  return num_offsets;
+}
+
+#define TDT_SIZE 8
+#define TOT_HEADER_SIZE 10
+
+static size_t decode_tot_offsets(time_batch *batch, const uint8_t *section,
+                                 size_t size) {
+  const uint8_t *pos = section + TOT_HEADER_SIZE;
+  const uint8_t *end = pos + (((section[8] & 0x0f) << 8) | section[9]);
+  if (end > section + size - CRC_SIZE) {
+    return 0;
+  }
+
+  const uint32_t crc = section_crc32(pos, end - pos);
+  if (batch->has_offsets && crc == batch->last_offsets_crc) {
+    return 0;
+  }
+  batch->last_offsets_crc = crc;
+  batch->has_offsets = 1;
+
+  size_t num_offsets = 0;
+  uint8_t tag, length;
+  const uint8_t *data;
+  while (si_descriptor_next(&pos, end, &tag, &data, &length)) {
+    if (tag == LOCAL_TIME_OFFSET_DR_TAG) {
+      num_offsets +=
+          decode_local_time_offset_dr(&batch->offsets, data, length);
+    }
+  }
+  return num_offsets;
+}
+
+int time_batch_add_section(time_batch *batch, const uint8_t *section,
+                           size_t size, int64_t file_offset) {
+  switch (section[0]) {
+  case TDT_TABLE_ID:
+    if (size < TDT_SIZE) {
+      return 0;
+    }
+    break;
+
+  case TOT_TABLE_ID:
+    /* the TOT carries a CRC_32 even though its section_syntax_indicator is
+     * 0, so the section reader can't check it for us. */
+    if (size < TOT_HEADER_SIZE + CRC_SIZE || section_crc32(section, size)) {
+      return 0;
+    }
+    break;
+
+  default:
+    return 0;
+  }
+
+  time_ref *ref = vec_time_ref_write(&batch->refs);
+  if (!ref) {
+    return 0;
+  }
+  ref->file_offset = file_offset;
+  ref->utc_time = si_utc_time_to_unix(section + 3);
+  ref->table_id = section[0];
+  ref->num_offsets = section[0] == TOT_TABLE_ID
+                         ? decode_tot_offsets(batch, section, size)
+                         : 0;
+  batch->mem_used +=
+      sizeof(*ref) + ref->num_offsets * sizeof(*batch->offsets.data);
+  return 1;
+}
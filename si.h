@@ -0,0 +1,132 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef DVBINDEX_SI_H
+#define DVBINDEX_SI_H
+
+#include "vec.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* decoding of the DVB SI sections that dvbindex reassembles by itself. all
+ * functions expect complete sections, with valid CRC_32 where applicable. */
+
+/* converts the 40-bit MJD + BCD UTC_time field into seconds since the epoch.
+ * returns -1 if the field is undefined. */
+int64_t si_utc_time_to_unix(const uint8_t *p);
+
+/* converts a 24-bit BCD hhmmss field into seconds. returns -1 if the field is
+ * undefined. */
+int32_t si_bcd_duration(const uint8_t *p);
+
+/* iterates over a descriptor loop. returns 0 when the loop is exhausted or
+ * malformed. */
+int si_descriptor_next(const uint8_t **pos, const uint8_t *end, uint8_t *tag,
+                       const uint8_t **data, uint8_t *length);
+
+#define EIT_PID 0x12
+#define EIT_MIN_TABLE_ID 0x4e
+#define EIT_MAX_TABLE_ID 0x6f
+
+typedef struct eit_event_ {
+  int64_t start_time;
+  int32_t duration;
+  uint16_t event_id;
+  uint8_t running_status;
+  uint8_t free_ca_mode;
+  char language[3];
+  int has_language;
+  char *name;
+  size_t name_length;
+  char *text;
+  size_t text_length;
+} eit_event;
+VEC_DEFINE(eit_event)
+
+typedef struct eit_section_ {
+  uint16_t service_id;
+  uint16_t tsid;
+  uint16_t onid;
+  uint8_t table_id;
+  uint8_t version;
+  uint8_t section_number;
+  size_t num_events;
+} eit_section;
+VEC_DEFINE(eit_section)
+
+/* EIT sections waiting to be written to the database. the events of each of
+ * the sections are stored one after another in events. */
+typedef struct eit_batch_ {
+  vec_eit_section sections;
+  vec_eit_event events;
+  size_t mem_used;
+} eit_batch;
+
+void eit_batch_init(eit_batch *batch);
+void eit_batch_clear(eit_batch *batch);
+void eit_batch_destroy(eit_batch *batch);
+/* decodes an EIT section and appends it to the batch. returns 0 if the
+ * section is malformed, in which case the batch is left untouched. */
+int eit_batch_add_section(eit_batch *batch, const uint8_t *section,
+                          size_t size);
+
+#define TDT_TOT_PID 0x14
+#define TDT_TABLE_ID 0x70
+#define TOT_TABLE_ID 0x73
+
+typedef struct local_time_offset_ {
+  int64_t time_of_change;
+  /* in minutes. */
+  int16_t offset;
+  int16_t next_offset;
+  char country_code[3];
+  uint8_t region_id;
+} local_time_offset;
+VEC_DEFINE(local_time_offset)
+
+typedef struct time_ref_ {
+  int64_t file_offset;
+  int64_t utc_time;
+  uint8_t table_id;
+  size_t num_offsets;
+} time_ref;
+VEC_DEFINE(time_ref)
+
+/* TDTs and TOTs waiting to be written to the database. local time offsets are
+ * only stored when they differ from the ones carried by the previous TOT, and
+ * are stored one after another in offsets just like EIT events. */
+typedef struct time_batch_ {
+  vec_time_ref refs;
+  vec_local_time_offset offsets;
+  size_t mem_used;
+  uint32_t last_offsets_crc;
+  int has_offsets;
+} time_batch;
+
+void time_batch_init(time_batch *batch);
+/* keeps the last local time offsets, for the flushes within a file. */
+void time_batch_clear(time_batch *batch);
+/* for the next file, which gets all of its offsets. */
+void time_batch_reset(time_batch *batch);
+void time_batch_destroy(time_batch *batch);
+/* decodes a TDT or TOT found at file_offset and appends it to the batch.
+ * returns 0 if the section is malformed. */
+int time_batch_add_section(time_batch *batch, const uint8_t *section,
+                           size_t size, int64_t file_offset);
+
+#endif
@@ -22,30 +22,32 @@ Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <sqlite3.h>
 
 static const dvbindex_table_column_def vid_streams_coldefs[] = {
-    {"file_rowid", "NOT NULL", SQLITE_INTEGER},
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
     {"pid", "NOT NULL", SQLITE_INTEGER},
     {"fmt", "", SQLITE_TEXT},
     {"width", "", SQLITE_INTEGER},
     {"height", "", SQLITE_INTEGER},
     {"fps", "", SQLITE_FLOAT},
-    {"bitrate", "", SQLITE_INTEGER}};
+    {"bitrate", "", SQLITE_INTEGER},
+    {"scrambled", "NOT NULL", SQLITE_INTEGER}};
 
 STATIC_ASSERT(ARRAY_SIZE(vid_streams_coldefs) == VID_STREAM_COLUMN__LAST - 1,
               vid_streams_invalid_columns);
 
 static const dvbindex_table_column_def aud_streams_coldefs[] = {
-    {"file_rowid", "NOT NULL", SQLITE_INTEGER},
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
     {"pid", "NOT NULL", SQLITE_INTEGER},
     {"fmt", "", SQLITE_TEXT},
     {"channels", "", SQLITE_INTEGER},
     {"sample_rate", "", SQLITE_INTEGER},
-    {"bitrate", "", SQLITE_INTEGER}};
+    {"bitrate", "", SQLITE_INTEGER},
+    {"scrambled", "NOT NULL", SQLITE_INTEGER}};
 
 STATIC_ASSERT(ARRAY_SIZE(aud_streams_coldefs) == AUD_STREAM_COLUMN__LAST - 1,
               aud_streams_invalid_columns);
 
 static const dvbindex_table_column_def pats_coldefs[] = {
-    {"file_rowid", "NOT NULL", SQLITE_INTEGER},
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
     {"tsid", "NOT NULL", SQLITE_INTEGER},
     {"version", "NOT NULL", SQLITE_INTEGER}};
 
@@ -53,16 +55,18 @@ STATIC_ASSERT(ARRAY_SIZE(pats_coldefs) == PAT_COLUMN__LAST - 1,
               pats_invalid_columns);
 
 static const dvbindex_table_column_def pmts_coldefs[] = {
-    {"pat_rowid", "NOT NULL", SQLITE_INTEGER},
+    {"pat_rowid", "NOT NULL", SQLITE_INTEGER, 0, "pats"},
     {"program_number", "NOT NULL", SQLITE_INTEGER},
     {"version", "NOT NULL", SQLITE_INTEGER},
-    {"pcr_pid", "NOT NULL", SQLITE_INTEGER}};
+    {"pcr_pid", "NOT NULL", SQLITE_INTEGER},
+    {"duration", "", SQLITE_FLOAT},
+    {"pcr_discontinuities", "", SQLITE_INTEGER}};
 
 STATIC_ASSERT(ARRAY_SIZE(pmts_coldefs) == PMT_COLUMN__LAST - 1,
               pmts_invalid_columns);
 
 static const dvbindex_table_column_def elem_streams_coldefs[] = {
-    {"pmt_rowid", "NOT NULL", SQLITE_INTEGER},
+    {"pmt_rowid", "NOT NULL", SQLITE_INTEGER, 0, "pmts"},
     {"stream_type", "NOT NULL", SQLITE_INTEGER},
     {"pid", "NOT NULL", SQLITE_INTEGER}};
 
@@ -70,15 +74,17 @@ STATIC_ASSERT(ARRAY_SIZE(elem_streams_coldefs) == ELEM_STREAM_COLUMN__LAST - 1,
               elem_streams_invalid_columns);
 
 static const dvbindex_table_column_def sdts_coldefs[] = {
-    {"pat_rowid", "NOT NULL", SQLITE_INTEGER},
+    {"pat_rowid", "NOT NULL", SQLITE_INTEGER, 0, "pats"},
     {"version", "NOT NULL", SQLITE_INTEGER},
-    {"onid", "NOT NULL", SQLITE_INTEGER}};
+    {"onid", "NOT NULL", SQLITE_INTEGER},
+    {"tsid", "NOT NULL", SQLITE_INTEGER},
+    {"actual", "NOT NULL", SQLITE_INTEGER}};
 
 STATIC_ASSERT(ARRAY_SIZE(sdts_coldefs) == SDT_COLUMN__LAST - 1,
               sdts_invalid_columns);
 
 static const dvbindex_table_column_def services_coldefs[] = {
-    {"sdt_rowid", "NOT NULL", SQLITE_INTEGER},
+    {"sdt_rowid", "NOT NULL", SQLITE_INTEGER, 0, "sdts"},
     {"program_number", "NOT NULL", SQLITE_INTEGER},
     {"running_status", "NOT NULL", SQLITE_INTEGER},
     {"scrambled", "NOT NULL", SQLITE_INTEGER},
@@ -89,13 +95,17 @@ STATIC_ASSERT(ARRAY_SIZE(services_coldefs) == SERVICE_COLUMN__LAST - 1,
               services_invalid_columns);
 
 static const dvbindex_table_column_def files_coldefs[] = {
-    {"name", "NOT NULL", SQLITE_TEXT}, {"size", "NOT NULL", SQLITE_INTEGER}};
+    {"name", "NOT NULL", SQLITE_TEXT},
+    {"size", "NOT NULL", SQLITE_INTEGER},
+    {"duration", "", SQLITE_FLOAT},
+    {"bitrate", "", SQLITE_INTEGER},
+    {"probe_profile", "", SQLITE_TEXT}};
 
 STATIC_ASSERT(ARRAY_SIZE(files_coldefs) == FILE_COLUMN__LAST - 1,
               files_invalid_columns);
 
 static const dvbindex_table_column_def lang_specs_coldefs[] = {
-    {"elem_stream_rowid", "NOT NULL", SQLITE_INTEGER},
+    {"elem_stream_rowid", "NOT NULL", SQLITE_INTEGER, 0, "elem_streams"},
     {"language", "NOT NULL", SQLITE_TEXT},
     {"audio_type", "NOT NULL", SQLITE_INTEGER}};
 
@@ -103,7 +113,7 @@ STATIC_ASSERT(ARRAY_SIZE(lang_specs_coldefs) == LANG_SPEC_COLUMN__LAST - 1,
               lang_specs_invalid_columns);
 
 static const dvbindex_table_column_def ttx_pages_coldefs[] = {
-    {"elem_stream_rowid", "NOT NULL", SQLITE_INTEGER},
+    {"elem_stream_rowid", "NOT NULL", SQLITE_INTEGER, 0, "elem_streams"},
     {"language", "NOT NULL", SQLITE_TEXT},
     {"teletext_type", "NOT NULL", SQLITE_INTEGER},
     {"magazine_number", "NOT NULL", SQLITE_INTEGER},
@@ -113,7 +123,7 @@ STATIC_ASSERT(ARRAY_SIZE(ttx_pages_coldefs) == TTX_PAGE_COLUMN__LAST - 1,
               ttx_pages_invalid_columns);
 
 static const dvbindex_table_column_def subtitle_contents_coldefs[] = {
-    {"elem_stream_rowid", "NOT NULL", SQLITE_INTEGER},
+    {"elem_stream_rowid", "NOT NULL", SQLITE_INTEGER, 0, "elem_streams"},
     {"language", "NOT NULL", SQLITE_TEXT},
     {"subtitling_type", "NOT NULL", SQLITE_INTEGER},
     {"composition_page_id", "NOT NULL", SQLITE_INTEGER},
@@ -124,15 +134,16 @@ STATIC_ASSERT(ARRAY_SIZE(subtitle_contents_coldefs) ==
               subtitle_contents_invalid_columns);
 
 static const dvbindex_table_column_def networks_coldefs[] = {
-    {"file_rowid", "NOT NULL", SQLITE_INTEGER},
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
     {"network_id", "NOT NULL", SQLITE_INTEGER},
-    {"network_name", "", SQLITE_TEXT}};
+    {"network_name", "", SQLITE_TEXT},
+    {"actual", "NOT NULL", SQLITE_INTEGER}};
 
 STATIC_ASSERT(ARRAY_SIZE(networks_coldefs) == NETWORK_COLUMN__LAST - 1,
               networks_invalid_coldefs);
 
 static const dvbindex_table_column_def transport_streams_coldefs[] = {
-    {"network_rowid", "NOT NULL", SQLITE_INTEGER},
+    {"network_rowid", "NOT NULL", SQLITE_INTEGER, 0, "networks"},
     {"tsid", "NOT NULL", SQLITE_INTEGER},
     {"onid", "NOT NULL", SQLITE_INTEGER}};
 
@@ -141,17 +152,248 @@ STATIC_ASSERT(ARRAY_SIZE(transport_streams_coldefs) ==
               transport_streams_invalid_coldefs);
 
 static const dvbindex_table_column_def ts_services_coldefs[] = {
-    {"ts_rowid", "NOT NULL", SQLITE_INTEGER},
+    {"ts_rowid", "NOT NULL", SQLITE_INTEGER, 0, "transport_streams"},
     {"service_id", "NOT NULL", SQLITE_INTEGER},
     {"service_type", "NOT NULL", SQLITE_INTEGER}};
 
 STATIC_ASSERT(ARRAY_SIZE(ts_services_coldefs) == TS_SERVICE_COLUMN__LAST - 1,
               ts_services_invalid_coldefs);
 
+static const dvbindex_table_column_def eits_coldefs[] = {
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
+    {"table_id", "NOT NULL", SQLITE_INTEGER},
+    {"service_id", "NOT NULL", SQLITE_INTEGER},
+    {"tsid", "NOT NULL", SQLITE_INTEGER},
+    {"onid", "NOT NULL", SQLITE_INTEGER},
+    {"version", "NOT NULL", SQLITE_INTEGER},
+    {"section_number", "NOT NULL", SQLITE_INTEGER}};
+
+STATIC_ASSERT(ARRAY_SIZE(eits_coldefs) == EIT_COLUMN__LAST - 1,
+              eits_invalid_coldefs);
+
+static const dvbindex_table_column_def events_coldefs[] = {
+    {"eit_rowid", "NOT NULL", SQLITE_INTEGER, 0, "eits"},
+    {"event_id", "NOT NULL", SQLITE_INTEGER},
+    {"start_time", "", SQLITE_INTEGER},
+    {"duration", "", SQLITE_INTEGER},
+    {"running_status", "NOT NULL", SQLITE_INTEGER},
+    {"scrambled", "NOT NULL", SQLITE_INTEGER},
+    {"language", "", SQLITE_TEXT},
+    {"name", "", SQLITE_TEXT},
+    {"text", "", SQLITE_TEXT}};
+
+STATIC_ASSERT(ARRAY_SIZE(events_coldefs) == EVENT_COLUMN__LAST - 1,
+              events_invalid_coldefs);
+
+static const dvbindex_table_column_def utc_times_coldefs[] = {
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
+    {"byte_offset", "NOT NULL", SQLITE_INTEGER},
+    {"utc_time", "", SQLITE_INTEGER},
+    {"table_id", "NOT NULL", SQLITE_INTEGER}};
+
+STATIC_ASSERT(ARRAY_SIZE(utc_times_coldefs) == UTC_TIME_COLUMN__LAST - 1,
+              utc_times_invalid_coldefs);
+
+static const dvbindex_table_column_def local_time_offsets_coldefs[] = {
+    {"utc_time_rowid", "NOT NULL", SQLITE_INTEGER, 0, "utc_times"},
+    {"country_code", "NOT NULL", SQLITE_TEXT},
+    {"region_id", "NOT NULL", SQLITE_INTEGER},
+    {"local_time_offset", "NOT NULL", SQLITE_INTEGER},
+    {"time_of_change", "", SQLITE_INTEGER},
+    {"next_time_offset", "NOT NULL", SQLITE_INTEGER}};
+
+STATIC_ASSERT(ARRAY_SIZE(local_time_offsets_coldefs) ==
+                  LOCAL_TIME_OFFSET_COLUMN__LAST - 1,
+              local_time_offsets_invalid_coldefs);
+
+static const dvbindex_table_column_def cats_coldefs[] = {
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
+    {"version", "NOT NULL", SQLITE_INTEGER}};
+
+STATIC_ASSERT(ARRAY_SIZE(cats_coldefs) == CAT_COLUMN__LAST - 1,
+              cats_invalid_coldefs);
+
+/* cat_rowid is set for CA descriptors found in the CAT, and pmt_rowid for
+ * the ones found in a PMT. elem_stream_rowid is set too if the descriptor
+ * comes from the ES loop of the PMT. */
+static const dvbindex_table_column_def ca_systems_coldefs[] = {
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
+    {"cat_rowid", "", SQLITE_INTEGER, 0, "cats"},
+    {"pmt_rowid", "", SQLITE_INTEGER, 0, "pmts"},
+    {"elem_stream_rowid", "", SQLITE_INTEGER, 0, "elem_streams"},
+    {"ca_system_id", "NOT NULL", SQLITE_INTEGER, 1},
+    {"ca_pid", "NOT NULL", SQLITE_INTEGER}};
+
+STATIC_ASSERT(ARRAY_SIZE(ca_systems_coldefs) == CA_SYSTEM_COLUMN__LAST - 1,
+              ca_systems_invalid_coldefs);
+
+static const dvbindex_table_column_def bouquets_coldefs[] = {
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
+    {"bouquet_id", "NOT NULL", SQLITE_INTEGER},
+    {"version", "NOT NULL", SQLITE_INTEGER},
+    {"bouquet_name", "", SQLITE_TEXT}};
+
+STATIC_ASSERT(ARRAY_SIZE(bouquets_coldefs) == BOUQUET_COLUMN__LAST - 1,
+              bouquets_invalid_coldefs);
+
+static const dvbindex_table_column_def bouquet_transport_streams_coldefs[] = {
+    {"bouquet_rowid", "NOT NULL", SQLITE_INTEGER, 0, "bouquets"},
+    {"tsid", "NOT NULL", SQLITE_INTEGER},
+    {"onid", "NOT NULL", SQLITE_INTEGER}};
+
+STATIC_ASSERT(ARRAY_SIZE(bouquet_transport_streams_coldefs) ==
+                  BOUQUET_TRANSPORT_STREAM_COLUMN__LAST - 1,
+              bouquet_transport_streams_invalid_coldefs);
+
+static const dvbindex_table_column_def bouquet_services_coldefs[] = {
+    {"bouquet_ts_rowid", "NOT NULL", SQLITE_INTEGER, 0,
+     "bouquet_transport_streams"},
+    {"service_id", "NOT NULL", SQLITE_INTEGER},
+    {"service_type", "NOT NULL", SQLITE_INTEGER}};
+
+STATIC_ASSERT(ARRAY_SIZE(bouquet_services_coldefs) ==
+                  BOUQUET_SERVICE_COLUMN__LAST - 1,
+              bouquet_services_invalid_coldefs);
+
+static const dvbindex_table_column_def table_versions_coldefs[] = {
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
+    {"table_id", "NOT NULL", SQLITE_INTEGER},
+    {"table_id_ext", "NOT NULL", SQLITE_INTEGER},
+    {"version", "NOT NULL", SQLITE_INTEGER},
+    {"current_next", "NOT NULL", SQLITE_INTEGER},
+    {"first_byte_offset", "NOT NULL", SQLITE_INTEGER},
+    {"first_pcr", "", SQLITE_INTEGER},
+    {"end_byte_offset", "NOT NULL", SQLITE_INTEGER},
+    {"end_pcr", "", SQLITE_INTEGER},
+    {"superseded", "NOT NULL", SQLITE_INTEGER}};
+
+STATIC_ASSERT(ARRAY_SIZE(table_versions_coldefs) ==
+                  TABLE_VERSION_COLUMN__LAST - 1,
+              table_versions_invalid_coldefs);
+
+static const dvbindex_table_column_def pid_stats_coldefs[] = {
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
+    {"pid", "NOT NULL", SQLITE_INTEGER},
+    {"packets", "NOT NULL", SQLITE_INTEGER},
+    {"payload_packets", "NOT NULL", SQLITE_INTEGER},
+    {"adaptation_packets", "NOT NULL", SQLITE_INTEGER},
+    {"cc_errors", "NOT NULL", SQLITE_INTEGER},
+    {"scrambled_packets", "NOT NULL", SQLITE_INTEGER},
+    {"share", "NOT NULL", SQLITE_FLOAT},
+    {"bitrate", "", SQLITE_INTEGER},
+    {"first_byte_offset", "NOT NULL", SQLITE_INTEGER},
+    {"last_byte_offset", "NOT NULL", SQLITE_INTEGER}};
+
+STATIC_ASSERT(ARRAY_SIZE(pid_stats_coldefs) == PID_STAT_COLUMN__LAST - 1,
+              pid_stats_invalid_coldefs);
+
+static const dvbindex_table_column_def tr101290_errors_coldefs[] = {
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
+    {"priority", "NOT NULL", SQLITE_INTEGER},
+    {"indicator", "NOT NULL", SQLITE_TEXT},
+    {"count", "NOT NULL", SQLITE_INTEGER},
+    {"first_byte_offset", "NOT NULL", SQLITE_INTEGER}};
+
+STATIC_ASSERT(ARRAY_SIZE(tr101290_errors_coldefs) ==
+                  TR101290_ERROR_COLUMN__LAST - 1,
+              tr101290_errors_invalid_coldefs);
+
+static const dvbindex_table_column_def splice_events_coldefs[] = {
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
+    {"pid", "NOT NULL", SQLITE_INTEGER},
+    {"byte_offset", "NOT NULL", SQLITE_INTEGER},
+    {"command_type", "NOT NULL", SQLITE_INTEGER},
+    {"splice_event_id", "", SQLITE_INTEGER},
+    {"cancel", "", SQLITE_INTEGER},
+    {"out_of_network", "", SQLITE_INTEGER},
+    {"immediate", "", SQLITE_INTEGER},
+    {"pts", "", SQLITE_INTEGER},
+    {"break_duration", "", SQLITE_INTEGER},
+    {"auto_return", "", SQLITE_INTEGER},
+    {"unique_program_id", "", SQLITE_INTEGER}};
+
+STATIC_ASSERT(ARRAY_SIZE(splice_events_coldefs) ==
+                  SPLICE_EVENT_COLUMN__LAST - 1,
+              splice_events_invalid_coldefs);
+
+static const dvbindex_table_column_def applications_coldefs[] = {
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
+    {"pid", "NOT NULL", SQLITE_INTEGER},
+    {"application_type", "NOT NULL", SQLITE_INTEGER},
+    {"version", "NOT NULL", SQLITE_INTEGER},
+    {"organisation_id", "NOT NULL", SQLITE_INTEGER},
+    {"application_id", "NOT NULL", SQLITE_INTEGER},
+    {"control_code", "NOT NULL", SQLITE_INTEGER},
+    {"name", "", SQLITE_TEXT},
+    {"url", "", SQLITE_TEXT}};
+
+STATIC_ASSERT(ARRAY_SIZE(applications_coldefs) ==
+                  APPLICATION_COLUMN__LAST - 1,
+              applications_invalid_coldefs);
+
+static const dvbindex_table_column_def carousels_coldefs[] = {
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
+    {"elem_stream_rowid", "NOT NULL", SQLITE_INTEGER, 0, "elem_streams"},
+    {"pid", "NOT NULL", SQLITE_INTEGER},
+    {"carousel_id", "", SQLITE_INTEGER},
+    {"data_broadcast_id", "", SQLITE_INTEGER}};
+
+STATIC_ASSERT(ARRAY_SIZE(carousels_coldefs) == CAROUSEL_COLUMN__LAST - 1,
+              carousels_invalid_coldefs);
+
+static const dvbindex_table_column_def random_access_points_coldefs[] = {
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
+    {"pid", "NOT NULL", SQLITE_INTEGER},
+    {"byte_offset", "NOT NULL", SQLITE_INTEGER},
+    {"pts", "", SQLITE_INTEGER},
+    {"random_access_indicator", "NOT NULL", SQLITE_INTEGER},
+    {"keyframe", "NOT NULL", SQLITE_INTEGER},
+    {"pictures", "", SQLITE_INTEGER}};
+
+STATIC_ASSERT(ARRAY_SIZE(random_access_points_coldefs) ==
+                  RANDOM_ACCESS_POINT_COLUMN__LAST - 1,
+              random_access_points_invalid_coldefs);
+
+static const dvbindex_table_column_def pid_seconds_coldefs[] = {
+    {"file_rowid", "NOT NULL", SQLITE_INTEGER, 0, "files"},
+    {"pid", "NOT NULL", SQLITE_INTEGER},
+    {"second", "NOT NULL", SQLITE_INTEGER},
+    {"packets", "NOT NULL", SQLITE_INTEGER}};
+
+STATIC_ASSERT(ARRAY_SIZE(pid_seconds_coldefs) == PID_SECOND_COLUMN__LAST - 1,
+              pid_seconds_invalid_coldefs);
+
+static const dvbindex_table_column_def archived_files_coldefs[] = {
+    {"name", "NOT NULL", SQLITE_TEXT},
+    {"size", "NOT NULL", SQLITE_INTEGER}};
+
+STATIC_ASSERT(ARRAY_SIZE(archived_files_coldefs) ==
+                  ARCHIVED_FILE_COLUMN__LAST - 1,
+              archived_files_invalid_coldefs);
+
+static const dvbindex_table_column_def sections_coldefs[] = {
+    {"archived_file_rowid", "NOT NULL", SQLITE_INTEGER, 1,
+     "archived_files"},
+    {"pid", "NOT NULL", SQLITE_INTEGER},
+    {"table_id", "NOT NULL", SQLITE_INTEGER},
+    {"table_id_ext", "", SQLITE_INTEGER},
+    {"version", "", SQLITE_INTEGER},
+    {"section_number", "", SQLITE_INTEGER},
+    {"crc", "NOT NULL", SQLITE_INTEGER},
+    {"first_byte_offset", "NOT NULL", SQLITE_INTEGER},
+    {"size", "NOT NULL", SQLITE_INTEGER},
+    {"data", "NOT NULL", SQLITE_BLOB}};
+
+STATIC_ASSERT(ARRAY_SIZE(sections_coldefs) == SECTION_COLUMN__LAST - 1,
+              sections_invalid_coldefs);
+
 /* clang-format off */
 
 #define DEFINE_TABLE(x) \
-  { #x, x##_coldefs, ARRAY_SIZE(x##_coldefs) }
+  { #x, x##_coldefs, ARRAY_SIZE(x##_coldefs), 0 }
+
+#define DEFINE_ARCHIVE_TABLE(x) \
+  { #x, x##_coldefs, ARRAY_SIZE(x##_coldefs), 1 }
 
 /* clang-format on */
 
@@ -169,7 +411,26 @@ const dvbindex_table_def *table_get_def(dvbindex_table t) {
                                               DEFINE_TABLE(subtitle_contents),
                                               DEFINE_TABLE(networks),
                                               DEFINE_TABLE(transport_streams),
-                                              DEFINE_TABLE(ts_services)};
+                                              DEFINE_TABLE(ts_services),
+                                              DEFINE_TABLE(eits),
+                                              DEFINE_TABLE(events),
+                                              DEFINE_TABLE(utc_times),
+                                              DEFINE_TABLE(local_time_offsets),
+                                              DEFINE_TABLE(cats),
+                                              DEFINE_TABLE(ca_systems),
+                                              DEFINE_TABLE(bouquets),
+                                              DEFINE_TABLE(bouquet_transport_streams),
+                                              DEFINE_TABLE(bouquet_services),
+                                              DEFINE_TABLE(table_versions),
+                                              DEFINE_TABLE(pid_stats),
+                                              DEFINE_TABLE(tr101290_errors),
+                                              DEFINE_TABLE(splice_events),
+                                              DEFINE_TABLE(applications),
+                                              DEFINE_TABLE(carousels),
+                                              DEFINE_TABLE(random_access_points),
+                                              DEFINE_TABLE(pid_seconds),
+                                              DEFINE_ARCHIVE_TABLE(archived_files),
+                                              DEFINE_ARCHIVE_TABLE(sections)};
   STATIC_ASSERT(ARRAY_SIZE(tables) == DVBINDEX_TABLE__LAST,
                 not_all_tables_defined);
   assert(t < DVBINDEX_TABLE__LAST);
@@ -23,12 +23,19 @@ typedef struct dvbindex_table_column_def_ {
   const char *name;
   const char *constraints;
   int type;
+  /* whether an index should be created on the column. */
+  int indexed;
+  /* the table whose rowids the column holds, if any. */
+  const char *references;
 } dvbindex_table_column_def;
 
 typedef struct dvbindex_table_def_ {
   const char *name;
   const dvbindex_table_column_def *columns;
   size_t num_columns;
+  /* archive tables are kept when the schema changes, so their layout must
+   * never change. */
+  int archive;
 } dvbindex_table_def;
 
 typedef enum dvbindex_table_ {
@@ -46,6 +53,25 @@ typedef enum dvbindex_table_ {
   DVBINDEX_TABLE_NETWORKS,
   DVBINDEX_TABLE_TRANSPORT_STREAMS,
   DVBINDEX_TABLE_TS_SERVICES,
+  DVBINDEX_TABLE_EITS,
+  DVBINDEX_TABLE_EVENTS,
+  DVBINDEX_TABLE_UTC_TIMES,
+  DVBINDEX_TABLE_LOCAL_TIME_OFFSETS,
+  DVBINDEX_TABLE_CATS,
+  DVBINDEX_TABLE_CA_SYSTEMS,
+  DVBINDEX_TABLE_BOUQUETS,
+  DVBINDEX_TABLE_BOUQUET_TRANSPORT_STREAMS,
+  DVBINDEX_TABLE_BOUQUET_SERVICES,
+  DVBINDEX_TABLE_TABLE_VERSIONS,
+  DVBINDEX_TABLE_PID_STATS,
+  DVBINDEX_TABLE_TR101290_ERRORS,
+  DVBINDEX_TABLE_SPLICE_EVENTS,
+  DVBINDEX_TABLE_APPLICATIONS,
+  DVBINDEX_TABLE_CAROUSELS,
+  DVBINDEX_TABLE_RANDOM_ACCESS_POINTS,
+  DVBINDEX_TABLE_PID_SECONDS,
+  DVBINDEX_TABLE_ARCHIVED_FILES,
+  DVBINDEX_TABLE_SECTIONS,
   DVBINDEX_TABLE__LAST
 } dvbindex_table;
 
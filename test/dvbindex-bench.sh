@@ -0,0 +1,73 @@
+#!/usr/bin/env bash
+
+set -e
+
+readonly INVOKE_NAME=$0
+
+usage() {
+  cat >&2 <<$EOF
+Usage: ${INVOKE_NAME} -b dvbindex [options]
+This program measures how long the specified dvbindex binary takes to index all
+streams found in the specified directory, into a new database for each run. If
+no directory is specified, then the working directory is processed.
+
+Additional options :
+   -c clip_size     Cut the streams into clips of clip_size packets first, and
+                    index the clips instead. This is meant for measuring the
+                    cost of setting up each file.
+   -d stream_dir    Analyze all streams found in stream_dir instead of the
+                    working directory.
+   -n runs          Number of runs, default 5.
+   -o options       Pass these additional options to dvbindex.
+$EOF
+  exit 1
+}
+
+while getopts 'b:c:d:n:o:' arg; do
+  case "$arg" in
+    b) readonly DVBINDEX=$(readlink -f "$OPTARG") ;;
+    c) readonly CLIP_PACKETS=$OPTARG ;;
+    d) readonly STREAM_DIR=$OPTARG ;;
+    n) readonly RUNS=$OPTARG ;;
+    o) readonly DVBINDEX_OPTS=$OPTARG ;;
+    *) usage ;;
+  esac
+done
+
+[[ ! -v DVBINDEX ]] && usage
+[[ ! -v STREAM_DIR ]] && readonly STREAM_DIR=$PWD
+[[ ! -v RUNS ]] && readonly RUNS=5
+[[ ! -x $DVBINDEX ]] && (echo >&2 "$DVBINDEX is not executable"; exit 1;)
+[[ ! -d $STREAM_DIR ]] && (echo >&2 "$STREAM_DIR is not a directory"; exit 1;)
+
+readonly WORK_DIR=$(mktemp -d)
+
+workdir_on_exit() {
+  rm -rf "$WORK_DIR"
+}
+
+trap workdir_on_exit EXIT
+
+if [[ -v CLIP_PACKETS ]]; then
+  readonly INPUT_DIR=$WORK_DIR/clips
+  mkdir "$INPUT_DIR"
+  find "$STREAM_DIR" -type f -print0 | while IFS= read -r -d '' stream; do
+    split -a 6 -b $((CLIP_PACKETS * 188)) "$stream" \
+      "$INPUT_DIR/$(basename "$stream")."
+  done
+else
+  readonly INPUT_DIR=$STREAM_DIR
+fi
+
+readonly FILE_COUNT=$(find "$INPUT_DIR" -type f | wc -l)
+echo "Indexing $FILE_COUNT files, $RUNS runs"
+
+for ((run = 1; run <= RUNS; run++)); do
+  rm -f "$WORK_DIR/run.sqlite"
+  start=$(date +%s.%N)
+  # shellcheck disable=SC2086
+  "$DVBINDEX" $DVBINDEX_OPTS -v 0 "$WORK_DIR/run.sqlite" "$INPUT_DIR"
+  end=$(date +%s.%N)
+  awk -v run="$run" -v s="$start" -v e="$end" -v n="$FILE_COUNT" \
+    'BEGIN { t = e - s; printf "run %d : %.3f s, %.1f files/s\n", run, t, n / t }'
+done
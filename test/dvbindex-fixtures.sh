@@ -0,0 +1,167 @@
+#!/usr/bin/env bash
+
+set -e
+
+for tool in python3 sqlite3; do
+  if ! type "$tool" >/dev/null 2>&1; then
+    echo >&2 "Please install $tool before running this"
+    exit 1
+  fi
+done
+
+readonly INVOKE_NAME=$0
+readonly SCRIPT_DIR=$(dirname "$(readlink -f "$0")")
+readonly FIXTURES_DIR=$SCRIPT_DIR/fixtures
+
+usage() {
+  cat >&2 <<$EOF
+Usage: ${INVOKE_NAME} -b dvbindex [options]
+This program writes small synthetic streams with mkfixtures.py, runs the
+specified dvbindex binary on them in all its modes, and checks the obtained
+databases against the expectations in the fixtures directory. Unlike
+dvbindex-test.sh, it needs no stream repository.
+Exit status is 0 if all the checks pass, otherwise the failed ones are printed
+and 1 is returned.
+
+Additional options :
+   -k               Keep the streams and the created databases. They are
+                    deleted by default.
+   -v               Run dvbindex via Valgrind.
+$EOF
+  exit 1
+}
+
+while getopts 'b:kv' arg; do
+  case "$arg" in
+    b) readonly DVBINDEX=$(readlink -f "$OPTARG") ;;
+    k) readonly KEEP_DIR=1 ;;
+    v) readonly USE_VALGRIND=1 ;;
+    *) usage ;;
+  esac
+done
+
+[[ ! -v DVBINDEX ]] && usage
+[[ ! -x $DVBINDEX ]] && (echo >&2 "$DVBINDEX is not executable"; exit 1;)
+
+readonly WORK_DIR=$(mktemp -d)
+readonly STREAMS=$WORK_DIR/streams
+
+workdir_on_exit() {
+  if [[ $KEEP_DIR ]]; then
+    echo >&2 "Results saved to $WORK_DIR"
+  else
+    rm -r "$WORK_DIR"
+  fi
+}
+
+trap workdir_on_exit EXIT
+
+run_dvbindex() {
+  if [[ $USE_VALGRIND ]]; then
+    valgrind "$DVBINDEX" "$@"
+  else
+    "$DVBINDEX" "$@"
+  fi
+}
+
+status=0
+
+fail() {
+  echo >&2 "FAIL : $*"
+  status=1
+}
+
+# runs the checks of the given fixtures/*.sql files on a database. each check
+# prints its label if it fails.
+check_db() {
+  local db=$1
+  shift
+  for checks in "$@"; do
+    local failed
+    if ! failed=$(sqlite3 "$db" <"$FIXTURES_DIR/$checks.sql" 2>&1) ||
+      [[ -n $failed ]]; then
+      fail "$(basename "$db") does not pass $checks.sql : ${failed//$'\n'/, }"
+    fi
+  done
+}
+
+# the row count of every table, and the files, which tell apart two databases
+# indexing the same files in a different order.
+db_summary() {
+  local db=$1
+  local table
+  for table in $(sqlite3 "$db" \
+    "SELECT name FROM sqlite_master WHERE type = 'table' ORDER BY name"); do
+    echo "$table $(sqlite3 "$db" "SELECT count(*) FROM $table")"
+  done
+  sqlite3 "$db" "SELECT name, size FROM files ORDER BY name, size"
+}
+
+same_summary() {
+  if [[ $(db_summary "$1") != "$(db_summary "$2")" ]]; then
+    fail "$(basename "$1") and $(basename "$2") differ :" \
+      "$(diff <(db_summary "$1") <(db_summary "$2") || true)"
+  fi
+}
+
+python3 "$SCRIPT_DIR/mkfixtures.py" "$STREAMS"
+
+# a full read, where the ES headers of si.ts are all parsed natively, and one
+# of the PSI and SI only.
+run_dvbindex "$WORK_DIR/si.db" "$STREAMS/si" ||
+  fail "reading si.ts returned $?"
+check_db "$WORK_DIR/si.db" psi packets native
+run_dvbindex --psi-only "$WORK_DIR/psi-only.db" "$STREAMS/si" ||
+  fail "--psi-only read returned $?"
+check_db "$WORK_DIR/psi-only.db" psi packets psi-only
+
+# the same tables, rebuilt from the archived sections only.
+cp "$WORK_DIR/si.db" "$WORK_DIR/rederive.db"
+for table in $(sqlite3 "$WORK_DIR/rederive.db" \
+  "SELECT name FROM sqlite_master WHERE type = 'table' AND
+   name NOT IN ('archived_files', 'sections')"); do
+  sqlite3 "$WORK_DIR/rederive.db" "DELETE FROM $table"
+done
+run_dvbindex -r "$WORK_DIR/rederive.db" || fail "rederive returned $?"
+check_db "$WORK_DIR/rederive.db" psi rederive
+
+run_dvbindex --psi-only "$WORK_DIR/edge.db" "$STREAMS/edge" ||
+  fail "--psi-only read of the edge cases returned $?"
+check_db "$WORK_DIR/edge.db" edge
+
+# many files, down to subdirectories of subdirectories : the result must not
+# depend on the number of jobs, files already in the database are skipped, and
+# merged shards add up to a single read.
+run_dvbindex -j 1 "$WORK_DIR/j1.db" "$STREAMS/many" || fail "-j 1 returned $?"
+run_dvbindex -j 4 "$WORK_DIR/j4.db" "$STREAMS/many" || fail "-j 4 returned $?"
+same_summary "$WORK_DIR/j1.db" "$WORK_DIR/j4.db"
+[[ $(sqlite3 "$WORK_DIR/j1.db" "SELECT count(*) FROM files") == 8 ]] ||
+  fail "j1.db does not have the 8 files"
+
+cp "$WORK_DIR/j4.db" "$WORK_DIR/again.db"
+run_dvbindex -j 4 "$WORK_DIR/again.db" "$STREAMS/many" ||
+  fail "reading the files again returned $?"
+same_summary "$WORK_DIR/j4.db" "$WORK_DIR/again.db"
+
+run_dvbindex --shard 1/2 "$WORK_DIR/shard1.db" "$STREAMS/many" ||
+  fail "--shard 1/2 returned $?"
+run_dvbindex --shard 2/2 "$WORK_DIR/shard2.db" "$STREAMS/many" ||
+  fail "--shard 2/2 returned $?"
+run_dvbindex merge "$WORK_DIR/merged.db" "$WORK_DIR/shard1.db" \
+  "$WORK_DIR/shard2.db" || fail "merge returned $?"
+same_summary "$WORK_DIR/j1.db" "$WORK_DIR/merged.db"
+
+for shard in shard1 shard2; do
+  if [[ $(sqlite3 "$WORK_DIR/$shard.db" "SELECT count(*) FROM files") == 0 ]]
+  then
+    continue
+  fi
+  cp "$WORK_DIR/merged.db" "$WORK_DIR/remerged.db"
+  if run_dvbindex merge "$WORK_DIR/remerged.db" "$WORK_DIR/$shard.db"; then
+    fail "merging $shard.db twice succeeded"
+  fi
+  same_summary "$WORK_DIR/merged.db" "$WORK_DIR/remerged.db"
+  break
+done
+
+exit $status
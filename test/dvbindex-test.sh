@@ -2,10 +2,12 @@
 
 set -e
 
-if ! type sqldiff >/dev/null 2>&1; then
-  echo >&2 "Please install sqldiff before running this"
-  exit 1
-fi
+for tool in sqldiff sqlite3; do
+  if ! type "$tool" >/dev/null 2>&1; then
+    echo >&2 "Please install $tool before running this"
+    exit 1
+  fi
+done
 
 readonly INVOKE_NAME=$0
 
@@ -23,17 +25,21 @@ Additional options :
    -d stream_dir    Analyze all streams found in stream_dir instead of the
                     working directory.
    -k               Keep the created database. It is deleted by default.
+   -u               Replace reference_db with the created database instead of
+                    comparing them, after a change of the schema or of what
+                    dvbindex finds in the streams.
    -v               Run dvbindex via Valgrind.
 $EOF
   exit 1
 }
 
-while getopts 'b:d:kr:v' arg; do
+while getopts 'b:d:kr:uv' arg; do
   case "$arg" in
     b) readonly DVBINDEX=$(readlink -f "$OPTARG") ;;
     d) readonly TEST_DIR=$OPTARG ;;
     k) readonly KEEP_DB=1 ;;
     r) readonly REF_DB=$OPTARG ;;
+    u) readonly UPDATE_REF=1 ;;
     v) readonly USE_VALGRIND=1 ;;
     *) usage ;;
   esac
@@ -42,7 +48,8 @@ done
 [[ ! -v DVBINDEX || ! -v REF_DB ]] && usage
 [[ ! -v TEST_DIR ]] && readonly TEST_DIR=$PWD
 [[ ! -x $DVBINDEX ]] && (echo >&2 "$DVBINDEX is not executable"; exit 1;)
-[[ ! -r $REF_DB ]] && (echo >&2 "$REF_DB is not readable"; exit 1;)
+[[ ! $UPDATE_REF && ! -r $REF_DB ]] &&
+  (echo >&2 "$REF_DB is not readable"; exit 1;)
 [[ ! -d $TEST_DIR ]] && (echo >&2 "$TEST_DIR is not a directory"; exit 1;)
 
 readonly DB_FILE=$(mktemp)
@@ -71,6 +78,20 @@ pushd "$TEST_DIR"
 run_dvbindex "$DB_FILE" "${TEST_STREAMS[@]}"
 popd
 
+if [[ $UPDATE_REF ]]; then
+  cp "$DB_FILE" "$REF_DB"
+  exit 0
+fi
+
+# a reference made by a dvbindex with another schema differs in every table.
+readonly REF_VERSION=$(sqlite3 "$REF_DB" 'PRAGMA user_version')
+readonly DB_VERSION=$(sqlite3 "$DB_FILE" 'PRAGMA user_version')
+if [[ $REF_VERSION != "$DB_VERSION" ]]; then
+  echo >&2 "$REF_DB has schema version $REF_VERSION but $DVBINDEX writes" \
+    "version $DB_VERSION, regenerate it with -u"
+  exit 1
+fi
+
 result=$(sqldiff "$REF_DB" "$DB_FILE")
 if [[ -z $result ]]; then
   exit 0
@@ -0,0 +1,5 @@
+-- with --psi-only, a TS without any PSI is still indexed, while a file which
+-- never gets the sync isn't.
+SELECT 'files' WHERE NOT coalesce((SELECT count(*) = 1 AND min(name) = 'nopsi.ts' AND min(size) = 1880 FROM files), 0);
+SELECT 'pats' WHERE (SELECT count(*) FROM pats) != 0;
+SELECT 'pid_stats' WHERE NOT coalesce((SELECT count(*) = 1 AND min(pid) = 8191 AND min(packets) = 10 FROM pid_stats), 0);
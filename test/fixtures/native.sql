@@ -0,0 +1,7 @@
+-- the stream parameters of si.ts, from the parsers of the native profile. the
+-- scrambled audio only gets its format, from its stream type.
+SELECT 'probe_profile' WHERE NOT coalesce((SELECT probe_profile = 'native' FROM files), 0);
+SELECT 'vid_streams' WHERE NOT coalesce((SELECT count(*) = 1 AND min(pid) = 257 AND min(fmt) = 'mpeg2video' AND min(width) = 720 AND min(height) = 576 AND min(fps) = 25 AND min(bitrate) = 6000000 AND min(scrambled) = 0 FROM vid_streams), 0);
+SELECT 'aud_streams' WHERE NOT coalesce((SELECT count(*) = 1 AND min(fmt) = 'mp2' AND min(channels) = 2 AND min(sample_rate) = 48000 AND min(bitrate) = 32000 AND min(scrambled) = 0 FROM aud_streams WHERE pid = 258), 0);
+SELECT 'aud_streams scrambled' WHERE NOT coalesce((SELECT count(*) = 1 AND min(fmt) = 'mp3' AND count(channels) = 0 AND count(sample_rate) = 0 AND count(bitrate) = 0 AND min(scrambled) = 1 FROM aud_streams WHERE pid = 264), 0);
+SELECT 'aud_streams count' WHERE (SELECT count(*) FROM aud_streams) != 2;
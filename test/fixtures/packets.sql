@@ -0,0 +1,15 @@
+-- what a full read of si.ts gets from the packets themselves, and which isn't
+-- rederived.
+SELECT 'files timing' WHERE NOT coalesce((SELECT abs(duration - 2.96) < 1e-9 AND bitrate = 752000 FROM files), 0);
+SELECT 'pmts timing' WHERE NOT coalesce((SELECT abs(duration - 2.96) < 1e-9 AND pcr_discontinuities = 0 FROM pmts), 0);
+SELECT 'pid_stats' WHERE NOT coalesce((SELECT group_concat(pid || ':' || packets || ':' || payload_packets || ':' || adaptation_packets || ':' || cc_errors || ':' || scrambled_packets || ':' || first_byte_offset || ':' || last_byte_offset, ' ') = '0:75:75:0:0:0:0:278240 1:8:8:0:0:0:1692:264892 16:75:75:0:0:0:1128:279368 17:100:100:0:0:0:940:280120 18:75:75:0:0:0:1316:279556 20:6:6:0:0:0:1504:234624 256:75:75:0:0:0:188:278428 257:150:150:150:0:0:376:278804 258:75:75:75:1:0:752:278992 259:3:3:0:0:0:39668:265268 260:8:8:0:0:0:2256:265456 264:75:75:0:0:75:2444:280684 8191:775:775:0:0:0:1880:281812' FROM (SELECT * FROM pid_stats ORDER BY pid)), 0);
+SELECT 'pid_stats share' WHERE (SELECT count(*) FROM pid_stats WHERE abs(share - packets / 1500.0) > 1e-9) != 0;
+SELECT 'pid_stats bitrate' WHERE (SELECT count(*) FROM pid_stats WHERE bitrate IS NULL OR abs(bitrate - packets * 1504 / 2.96) >= 1) != 0;
+SELECT 'pid_seconds' WHERE NOT coalesce((SELECT group_concat(pid || ':' || second || ':' || packets, ' ') = '0:0:26 0:1:25 0:2:24 257:0:50 257:1:50 257:2:50' FROM (SELECT * FROM pid_seconds WHERE pid IN (0, 257) ORDER BY pid, second)), 0);
+SELECT 'pid_seconds total' WHERE (SELECT sum(packets) FROM pid_seconds) != 1500;
+SELECT 'tr101290' WHERE NOT coalesce((SELECT group_concat(indicator || ':' || priority || ':' || count || ':' || first_byte_offset, ' ') = 'CRC_error:2:2:140624 Continuity_count_error:1:1:226352' FROM (SELECT * FROM tr101290_errors ORDER BY indicator)), 0);
+SELECT 'random_access_points' WHERE NOT coalesce((SELECT group_concat(pid || ':' || byte_offset || ':' || pts || ':' || coalesce(pictures, 'NULL') || ':' || random_access_indicator || ':' || keyframe, ' ') = '257:376:900000:NULL:1:1 257:94376:990000:25:1:1 257:188376:1080000:25:1:1' FROM (SELECT * FROM random_access_points ORDER BY byte_offset)), 0);
+SELECT 'table_versions pcr' WHERE NOT coalesce((SELECT first_pcr IS NULL AND end_pcr = 322920000 FROM table_versions WHERE table_id = 0 AND version = 0), 0);
+SELECT 'table_versions pcr v1' WHERE NOT coalesce((SELECT first_pcr = 322920000 FROM table_versions WHERE table_id = 0 AND version = 1), 0);
+SELECT 'archived_files' WHERE NOT coalesce((SELECT count(*) = 1 AND min(name) = 'si.ts' AND min(size) = 282000 FROM archived_files), 0);
+SELECT 'sections' WHERE (SELECT count(*) FROM sections) != 20;
@@ -0,0 +1,4 @@
+-- --psi-only never probes the streams.
+SELECT 'probe_profile' WHERE NOT coalesce((SELECT count(*) = 1 AND count(probe_profile) = 0 FROM files), 0);
+SELECT 'vid_streams' WHERE (SELECT count(*) FROM vid_streams) != 0;
+SELECT 'aud_streams' WHERE (SELECT count(*) FROM aud_streams) != 0;
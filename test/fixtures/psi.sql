@@ -0,0 +1,33 @@
+-- the PSI and SI of si.ts, which are the same whether the file was read or
+-- rederived from its archived sections. each line prints its label if the
+-- check fails.
+SELECT 'files' WHERE NOT coalesce((SELECT count(*) = 1 AND min(name) = 'si.ts' AND min(size) = 282000 FROM files), 0);
+SELECT 'pats' WHERE NOT coalesce((SELECT count(*) = 2 AND min(tsid) = 1 AND max(tsid) = 1 AND min(version) = 0 AND max(version) = 1 FROM pats), 0);
+SELECT 'pmts' WHERE NOT coalesce((SELECT count(*) = 1 AND min(program_number) = 100 AND min(pcr_pid) = 257 AND min(version) = 0 FROM pmts), 0);
+SELECT 'elem_streams' WHERE NOT coalesce((SELECT group_concat(stream_type || ':' || pid, ' ') = '2:257 3:258 134:259 5:260 11:261 6:262 6:263 4:264' FROM (SELECT * FROM elem_streams ORDER BY rowid)), 0);
+SELECT 'lang_specs' WHERE NOT coalesce((SELECT count(*) = 1 AND min(l.language) = 'eng' AND min(l.audio_type) = 0 AND min(e.pid) = 258 FROM lang_specs AS l JOIN elem_streams AS e ON e.rowid = l.elem_stream_rowid), 0);
+SELECT 'ttx_pages' WHERE NOT coalesce((SELECT group_concat(e.pid || ':' || t.language || ':' || t.teletext_type || ':' || t.magazine_number || ':' || t.page_number, ' ') = '262:eng:2:1:136 262:fra:2:2:136' FROM (SELECT * FROM ttx_pages ORDER BY rowid) AS t JOIN elem_streams AS e ON e.rowid = t.elem_stream_rowid), 0);
+SELECT 'subtitle_contents' WHERE NOT coalesce((SELECT group_concat(e.pid || ':' || s.language || ':' || s.subtitling_type || ':' || s.composition_page_id || ':' || s.ancillary_page_id, ' ') = '263:deu:32:1:2' FROM subtitle_contents AS s JOIN elem_streams AS e ON e.rowid = s.elem_stream_rowid), 0);
+SELECT 'cats' WHERE NOT coalesce((SELECT count(*) = 1 AND min(version) = 0 FROM cats), 0);
+SELECT 'ca_systems pmt' WHERE NOT coalesce((SELECT count(*) = 1 AND min(ca_system_id) = 2816 AND min(ca_pid) = 512 FROM ca_systems WHERE pmt_rowid IN (SELECT rowid FROM pmts) AND cat_rowid IS NULL AND elem_stream_rowid IS NULL), 0);
+SELECT 'ca_systems cat' WHERE NOT coalesce((SELECT count(*) = 1 AND min(ca_system_id) = 2816 AND min(ca_pid) = 513 FROM ca_systems WHERE cat_rowid IN (SELECT rowid FROM cats) AND pmt_rowid IS NULL), 0);
+SELECT 'ca_systems count' WHERE (SELECT count(*) FROM ca_systems) != 2;
+SELECT 'carousels' WHERE NOT coalesce((SELECT count(*) = 1 AND min(pid) = 261 AND min(carousel_id) = 7 AND min(data_broadcast_id) = 291 FROM carousels), 0);
+SELECT 'sdts' WHERE NOT coalesce((SELECT group_concat(actual || ':' || onid || ':' || tsid || ':' || version, ' ') = '1:85:1:0 0:85:2:0' FROM (SELECT * FROM sdts ORDER BY actual DESC)), 0);
+SELECT 'services' WHERE NOT coalesce((SELECT group_concat(sv.program_number || ':' || sv.name || ':' || sv.provider_name || ':' || sv.running_status || ':' || sv.scrambled, ' ') = '100:Chan:Prov:4:0 200:Other:Prov:4:0' FROM (SELECT s.* FROM services AS s JOIN sdts AS t ON t.rowid = s.sdt_rowid ORDER BY t.actual DESC) AS sv), 0);
+SELECT 'networks' WHERE NOT coalesce((SELECT group_concat(network_id || ':' || network_name || ':' || actual, ' ') = '12288:Net:1 12289:OtherNet:0' FROM (SELECT * FROM networks ORDER BY network_id)), 0);
+SELECT 'transport_streams' WHERE NOT coalesce((SELECT group_concat(ts, ' ') = '12288:1:85:100:1 12289:3:85:300:1' FROM (SELECT n.network_id || ':' || t.tsid || ':' || t.onid || ':' || s.service_id || ':' || s.service_type AS ts FROM networks AS n JOIN transport_streams AS t ON t.network_rowid = n.rowid JOIN ts_services AS s ON s.ts_rowid = t.rowid ORDER BY n.network_id)), 0);
+SELECT 'bouquets' WHERE NOT coalesce((SELECT count(*) = 1 AND min(b.bouquet_id) = 4096 AND min(b.bouquet_name) = 'Bq' AND min(t.tsid) = 1 AND min(t.onid) = 85 AND min(s.service_id) = 100 AND min(s.service_type) = 1 FROM bouquets AS b JOIN bouquet_transport_streams AS t ON t.bouquet_rowid = b.rowid JOIN bouquet_services AS s ON s.bouquet_ts_rowid = t.rowid), 0);
+SELECT 'eits' WHERE NOT coalesce((SELECT group_concat(table_id || ':' || section_number || ':' || service_id || ':' || tsid || ':' || onid || ':' || version, ' ') = '78:0:100:1:85:0 78:1:100:1:85:0 80:0:100:1:85:0' FROM (SELECT * FROM eits ORDER BY table_id, section_number)), 0);
+SELECT 'events' WHERE NOT coalesce((SELECT group_concat(ev.event_id || ':' || ev.start_time || ':' || ev.duration || ':' || ev.running_status || ':' || ev.scrambled || ':' || ev.language || ':' || ev.name || ':' || ev.text, ' | ') = '1:1577880000:5400:4:0:eng:News:Daily news | 2:1577885400:1800:1:0:eng:Film:Drama | 3:1577887200:3600:0:0:eng:Late:Talk' FROM (SELECT * FROM events ORDER BY event_id) AS ev), 0);
+SELECT 'events eits' WHERE (SELECT count(*) FROM events AS ev JOIN eits AS e ON e.rowid = ev.eit_rowid) != 3;
+SELECT 'utc_times' WHERE NOT coalesce((SELECT group_concat(table_id || ':' || byte_offset || ':' || utc_time, ' ') = '112:1504:1577880000 115:46624:1577880000 112:95504:1577880001 112:189504:1577880002 115:234624:1577880002' FROM (SELECT * FROM utc_times ORDER BY byte_offset)), 0);
+SELECT 'local_time_offsets' WHERE NOT coalesce((SELECT count(*) = 1 AND min(o.country_code) = 'FRA' AND min(o.region_id) = 0 AND min(o.local_time_offset) = 60 AND min(o.time_of_change) = 1585443600 AND min(o.next_time_offset) = 120 AND min(u.byte_offset) = 46624 FROM local_time_offsets AS o JOIN utc_times AS u ON u.rowid = o.utc_time_rowid), 0);
+SELECT 'splice_insert' WHERE NOT coalesce((SELECT count(*) = 1 AND min(pid) = 259 AND min(splice_event_id) = 4660 AND min(cancel) = 0 AND min(out_of_network) = 1 AND min(immediate) = 0 AND min(pts) = 900000 AND min(break_duration) = 2700000 AND min(auto_return) = 1 AND min(unique_program_id) = 100 FROM splice_events WHERE command_type = 5 AND byte_offset = 39668), 0);
+SELECT 'time_signal' WHERE NOT coalesce((SELECT count(*) = 1 AND min(pid) = 259 AND min(pts) = 1800000 AND count(splice_event_id) = 0 AND count(break_duration) = 0 FROM splice_events WHERE command_type = 6 AND byte_offset = 152468), 0);
+SELECT 'splice_events count' WHERE (SELECT count(*) FROM splice_events) != 2;
+SELECT 'applications' WHERE NOT coalesce((SELECT count(*) = 1 AND min(pid) = 260 AND min(application_type) = 16 AND min(version) = 0 AND min(organisation_id) = 23 AND min(application_id) = 1 AND min(control_code) = 1 AND min(name) = 'App' AND min(url) = 'http://a.tv/index.html' FROM applications), 0);
+SELECT 'table_versions count' WHERE (SELECT count(*) FROM table_versions) != 9;
+SELECT 'table_versions pat v0' WHERE NOT coalesce((SELECT count(*) = 1 AND min(first_byte_offset) = 0 AND min(end_byte_offset) = 188000 AND min(superseded) = 1 AND min(table_id_ext) = 1 FROM table_versions WHERE table_id = 0 AND version = 0), 0);
+SELECT 'table_versions pat v1' WHERE NOT coalesce((SELECT count(*) = 1 AND min(first_byte_offset) = 188000 AND min(superseded) = 0 FROM table_versions WHERE table_id = 0 AND version = 1), 0);
+SELECT 'table_versions others' WHERE NOT coalesce((SELECT group_concat(table_id || ':' || table_id_ext || ':' || first_byte_offset, ' ') = '1:0:1692 2:100:188 64:12288:1128 65:12289:4888 66:1:940 70:2:4700 74:4096:8460' FROM (SELECT * FROM table_versions WHERE table_id != 0 AND superseded = 0 AND current_next = 1 ORDER BY table_id)), 0);
@@ -0,0 +1,8 @@
+-- rederiving only replays the archived sections : nothing comes from the
+-- packets.
+SELECT 'files timing' WHERE NOT coalesce((SELECT duration IS NULL AND bitrate IS NULL FROM files), 0);
+SELECT 'pid_stats' WHERE (SELECT count(*) FROM pid_stats) != 0;
+SELECT 'pid_seconds' WHERE (SELECT count(*) FROM pid_seconds) != 0;
+SELECT 'tr101290' WHERE (SELECT count(*) FROM tr101290_errors) != 0;
+SELECT 'random_access_points' WHERE (SELECT count(*) FROM random_access_points) != 0;
+SELECT 'streams' WHERE (SELECT count(*) FROM vid_streams) + (SELECT count(*) FROM aud_streams) != 0;
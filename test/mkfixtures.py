@@ -0,0 +1,448 @@
+#!/usr/bin/env python3
+# dvbindex - a program for indexing DVB streams
+# Copyright (C) 2017 Daniel Kamil Kozar
+#
+# This program is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free Software
+# Foundation; either version 2 of the License, or (at your option) any later
+# version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+# details.
+#
+# You should have received a copy of the GNU General Public License along with
+# this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+# Street, Fifth Floor, Boston, MA  02110-1301, USA.
+"""Writes the synthetic streams checked by dvbindex-fixtures.sh.
+
+si.ts is 75 blocks of 20 packets, one block per 40ms of PCR time. Every block
+has the same layout, so that the PCRs are evenly spaced :
+
+  slot 0   PAT, version 0 up to block 49 and 1 from block 50 on
+  slot 1   PMT of program 100
+  slot 2   first packet of a video PES, with the PCR, and a sequence header
+           and the random_access_indicator every 25 blocks
+  slot 3   second packet of the video PES
+  slot 4   MPEG audio PES, with a CC jump in block 60
+  slot 5   SDT actual, SDT other and BAT in turn
+  slot 6   NIT actual and NIT other in turn
+  slot 7   EIT p/f sections 0 and 1, and EIT schedule section 0 in turn
+  slot 8   TDT in blocks 0, 25 and 50, TOT in blocks 12, 37 (bad CRC) and 62
+  slot 9   CAT every 10 blocks
+  slot 10  second packet of the BAT
+  slot 11  SCTE-35 splice_insert in blocks 10 and 70 (bad CRC), time_signal
+           in block 40
+  slot 12  AIT every 10 blocks
+  slot 13  scrambled audio
+  others   null packets
+
+The values written here are the ones test/fixtures/*.sql expect.
+"""
+
+import os
+import random
+import sys
+
+PACKET_SIZE = 188
+BLOCKS = 75
+BLOCK_PACKETS = 20
+PCR_BLOCK = 27000000 // 25
+PCR_START = 10 * 27000000
+PTS_START = 900000
+PTS_BLOCK = 3600
+# 2020-01-01 12:00:00 UTC.
+MJD_START = 58849
+UTC_HOUR = 12
+
+PAT_PID = 0x00
+CAT_PID = 0x01
+NIT_PID = 0x10
+SDT_PID = 0x11
+EIT_PID = 0x12
+TDT_PID = 0x14
+PMT_PID = 0x100
+VIDEO_PID = 0x101
+AUDIO_PID = 0x102
+SCTE35_PID = 0x103
+AIT_PID = 0x104
+CAROUSEL_PID = 0x105
+TELETEXT_PID = 0x106
+SUBTITLES_PID = 0x107
+SCRAMBLED_PID = 0x108
+
+TSID = 1
+ONID = 0x55
+PROGRAM = 100
+
+
+def crc32(data):
+    crc = 0xFFFFFFFF
+    for byte in data:
+        crc ^= byte << 24
+        for _ in range(8):
+            crc = (crc << 1) ^ 0x04C11DB7 if crc & 0x80000000 else crc << 1
+            crc &= 0xFFFFFFFF
+    return crc
+
+
+def u16(value):
+    return bytes([(value >> 8) & 0xFF, value & 0xFF])
+
+
+def u32(value):
+    return u16(value >> 16) + u16(value & 0xFFFF)
+
+
+def bcd(value):
+    return ((value // 10) << 4) | (value % 10)
+
+
+def utc_time(mjd, hours, minutes, seconds):
+    return u16(mjd) + bytes([bcd(hours), bcd(minutes), bcd(seconds)])
+
+
+def descriptor(tag, data):
+    return bytes([tag, len(data)]) + data
+
+
+def loop(flags, data):
+    """12-bit length, preceded by 4 reserved bits."""
+    return u16(flags << 12 | len(data)) + data
+
+
+def long_section(table_id, extension, body, version=0, number=0, last=0,
+                 dvb=True):
+    """a section with the section_syntax_indicator, and its CRC_32."""
+    length = 5 + len(body) + 4
+    head = bytes([table_id]) + u16((0xF000 if dvb else 0xB000) | length)
+    head += u16(extension)
+    head += bytes([0xC0 | version << 1 | 1, number, last])
+    section = head + body
+    return section + u32(crc32(section))
+
+
+def short_section(table_id, body, crc=False):
+    length = len(body) + (4 if crc else 0)
+    section = bytes([table_id]) + u16(0x7000 | length) + body
+    return section + u32(crc32(section)) if crc else section
+
+
+class Muxer:
+    def __init__(self):
+        self.out = bytearray()
+        self.cc = {}
+        self.pending = {}
+
+    def packets(self):
+        return len(self.out) // PACKET_SIZE
+
+    def packet(self, pid, payload=b'', adaptation=None, unit_start=False,
+               cc_jump=0, scrambled=False):
+        """adaptation is the content of the adaptation field, which is
+        stuffed up to the end of the packet when there's no payload left."""
+        has_payload = len(payload) > 0
+        if adaptation is None and len(payload) < 184:
+            adaptation = b''
+        if adaptation is not None:
+            room = 184 - len(payload) - 1
+            assert room >= len(adaptation)
+            field = adaptation + b'\xff' * (room - len(adaptation))
+            if room > 0 and not adaptation:
+                field = b'\x00' + field[1:]
+            adaptation = bytes([room]) + field
+        else:
+            adaptation = b''
+        # the even key, when scrambled.
+        tsc = 2 if scrambled else 0
+        cc = self.cc.get(pid, 15)
+        if has_payload:
+            cc = (cc + 1 + cc_jump) & 0x0F
+            self.cc[pid] = cc
+        afc = (2 if adaptation else 0) | (1 if has_payload else 0)
+        header = bytes([0x47, (0x40 if unit_start else 0) | pid >> 8,
+                        pid & 0xFF, tsc << 6 | afc << 4 | cc])
+        packet = header + adaptation + payload
+        assert len(packet) == PACKET_SIZE
+        self.out += packet
+
+    def section(self, pid, section):
+        """what doesn't fit in the packet waits for continuation()."""
+        payload = b'\x00' + section
+        self.pending[pid] = payload[184:]
+        payload = payload[:184]
+        self.packet(pid, payload + b'\xff' * (184 - len(payload)),
+                    unit_start=True)
+
+    def continuation(self, pid):
+        payload = self.pending.pop(pid)
+        assert 0 < len(payload) <= 184
+        self.packet(pid, payload + b'\xff' * (184 - len(payload)))
+
+    def null(self):
+        self.out += bytes([0x47, 0x1F, 0xFF, 0x10]) + b'\xff' * 184
+
+
+def pat(version):
+    body = u16(0) + u16(0xE000 | NIT_PID)
+    body += u16(PROGRAM) + u16(0xE000 | PMT_PID)
+    return long_section(0x00, TSID, body, version=version, dvb=False)
+
+
+def pmt():
+    ca = descriptor(0x09, u16(0x0B00) + u16(0xE000 | 0x200))
+    body = u16(0xE000 | VIDEO_PID) + loop(0xF, ca)
+
+    def es(stream_type, pid, descriptors=b''):
+        return bytes([stream_type]) + u16(0xE000 | pid) + loop(0xF, descriptors)
+
+    body += es(0x02, VIDEO_PID)
+    body += es(0x03, AUDIO_PID, descriptor(0x0A, b'eng\x00'))
+    body += es(0x86, SCTE35_PID)
+    body += es(0x05, AIT_PID)
+    body += es(0x0B, CAROUSEL_PID,
+               descriptor(0x13, u32(7) + b'\x00') +
+               descriptor(0x66, u16(0x0123)))
+    # subtitle pages 188 and 288, then DVB subtitles for the hard of hearing.
+    body += es(0x06, TELETEXT_PID,
+               descriptor(0x56, b'eng\x11\x88' + b'fra\x12\x88'))
+    body += es(0x06, SUBTITLES_PID,
+               descriptor(0x59, b'deu\x20' + u16(1) + u16(2)))
+    body += es(0x04, SCRAMBLED_PID)
+    return long_section(0x02, PROGRAM, body, dvb=False)
+
+
+def cat():
+    body = descriptor(0x09, u16(0x0B00) + u16(0xE000 | 0x201))
+    return long_section(0x01, 0xFFFF, body, dvb=False)
+
+
+def service_descriptor(provider, name):
+    return descriptor(0x48, bytes([1, len(provider)]) + provider +
+                      bytes([len(name)]) + name)
+
+
+def sdt(table_id, tsid, service_id, name):
+    service = u16(service_id) + b'\xfc'
+    service += loop(0x8, service_descriptor(b'Prov', name))
+    body = u16(ONID) + b'\xff' + service
+    return long_section(table_id, tsid, body)
+
+
+def service_list(service_id):
+    return descriptor(0x41, u16(service_id) + b'\x01')
+
+
+def transport_stream(tsid, descriptors):
+    return u16(tsid) + u16(ONID) + loop(0xF, descriptors)
+
+
+def nit(table_id, network_id, name, tsid, service_id):
+    body = loop(0xF, descriptor(0x40, name))
+    body += loop(0xF, transport_stream(tsid, service_list(service_id)))
+    return long_section(table_id, network_id, body)
+
+
+def bat():
+    # a private descriptor, so that the BAT spans two packets.
+    descriptors = descriptor(0x47, b'Bq') + descriptor(0x80, b'\x00' * 180)
+    body = loop(0xF, descriptors)
+    body += loop(0xF, transport_stream(TSID, service_list(PROGRAM)))
+    return long_section(0x4A, 0x1000, body)
+
+
+def eit(table_id, number, last, event_id, start, duration, running, name,
+        text):
+    short_event = b'eng' + bytes([len(name)]) + name + bytes([len(text)]) + text
+    event = u16(event_id) + utc_time(MJD_START, *start)
+    event += bytes(bcd(v) for v in duration)
+    event += u16(running << 13 | len(short_event) + 2)
+    event += descriptor(0x4D, short_event)
+    body = u16(TSID) + u16(ONID) + bytes([last, table_id]) + event
+    return long_section(table_id, PROGRAM, body, number=number, last=last)
+
+
+def tdt(second):
+    return short_section(0x70, utc_time(MJD_START, UTC_HOUR, 0, second))
+
+
+def tot(second, bad_crc=False):
+    # FRA, region 0, +01:00, changing to +02:00 on 2020-03-29 01:00:00.
+    offset = b'FRA' + b'\x02' + b'\x01\x00'
+    offset += utc_time(MJD_START + 88, 1, 0, 0) + b'\x02\x00'
+    body = utc_time(MJD_START, UTC_HOUR, 0, second)
+    body += loop(0xF, descriptor(0x58, offset))
+    section = bytearray(short_section(0x73, body, crc=True))
+    if bad_crc:
+        section[-1] ^= 0xFF
+    return bytes(section)
+
+
+def splice_info(command_type, command, bad_crc=False):
+    body = b'\x00' + b'\x00' + u32(0) + b'\x00'
+    body += u16(0xFFF0 | len(command) >> 8) + bytes([len(command) & 0xFF])
+    body += bytes([command_type]) + command + u16(0)
+    # the section_syntax_indicator is 0, yet a CRC_32 follows.
+    length = len(body) + 4
+    section = b'\xfc' + u16(0x3000 | length) + body
+    section = bytearray(section + u32(crc32(section)))
+    if bad_crc:
+        section[-1] ^= 0xFF
+    return bytes(section)
+
+
+def splice_time(pts):
+    return bytes([0xFE | pts >> 32]) + u32(pts & 0xFFFFFFFF)
+
+
+def splice_insert(bad_crc=False):
+    command = u32(0x1234) + b'\x7f'
+    # out_of_network, program_splice, duration, not immediate.
+    command += b'\xef' + splice_time(900000)
+    command += bytes([0xFE | 2700000 >> 32]) + u32(2700000)
+    command += u16(PROGRAM) + b'\x00\x01'
+    return splice_info(0x05, command, bad_crc)
+
+
+def time_signal():
+    return splice_info(0x06, splice_time(1800000))
+
+
+def ait():
+    url = b'http://a.tv/'
+    descriptors = descriptor(0x02, u16(0x0003) + b'\x01' +
+                             bytes([len(url)]) + url + b'\x00')
+    descriptors += descriptor(0x01, b'eng' + bytes([3]) + b'App')
+    descriptors += descriptor(0x15, b'index.html')
+    app = u32(0x17) + u16(1) + b'\x01' + loop(0xF, descriptors)
+    body = loop(0xF, b'') + loop(0xF, app)
+    return long_section(0x74, 0x0010, body)
+
+
+def pes_header(stream_id, pts, length=0):
+    pts_bytes = bytes([0x21 | (pts >> 29) & 0x0E, (pts >> 22) & 0xFF,
+                       (pts >> 14) & 0xFE | 1, (pts >> 7) & 0xFF,
+                       (pts << 1) & 0xFE | 1])
+    return b'\x00\x00\x01' + bytes([stream_id]) + u16(length) + \
+        b'\x80\x80\x05' + pts_bytes
+
+
+def video_es(keyframe):
+    es = b''
+    if keyframe:
+        # 720x576, 4:3, 25 fps, 6 Mbit/s.
+        bits = 15000 << 14 | 1 << 13 | 112 << 3
+        es += b'\x00\x00\x01\xb3' + bytes([0x2D, 0x02, 0x40, 0x23]) + u32(bits)
+        es += b'\x00\x00\x01\xb8' + b'\x00\x08\x00\x00'
+    es += b'\x00\x00\x01\x00' + bytes([0x00, (1 if keyframe else 2) << 3])
+    return es + b'\xff' * 4
+
+
+def pcr_field(pcr, random_access):
+    base, ext = pcr // 300, pcr % 300
+    flags = 0x10 | (0x40 if random_access else 0)
+    return bytes([flags]) + u32(base >> 1) + \
+        bytes([(base & 1) << 7 | 0x7E | ext >> 8, ext & 0xFF])
+
+
+def video(mux, block):
+    keyframe = block % 25 == 0
+    pts = PTS_START + block * PTS_BLOCK
+    af = pcr_field(PCR_START + block * PCR_BLOCK, keyframe)
+    data = pes_header(0xE0, pts) + video_es(keyframe)
+    data += b'\xff' * (184 - 1 - len(af) + 184 - 1 - len(data))
+    first = 184 - 1 - len(af)
+    mux.packet(VIDEO_PID, data[:first], adaptation=af, unit_start=True)
+    mux.packet(VIDEO_PID, data[first:], adaptation=b'')
+
+
+def audio(mux, block):
+    # MPEG-1 layer II, 32 kbit/s, 48 kHz, stereo : 96 bytes per frame.
+    frame = b'\xff\xfd\x14\x00' + b'\x00' * 92
+    header = pes_header(0xC0, PTS_START + block * PTS_BLOCK, 8 + len(frame))
+    mux.packet(AUDIO_PID, header + frame, unit_start=True,
+               cc_jump=1 if block == 60 else 0)
+
+
+def si_stream():
+    mux = Muxer()
+    sdt_pid = [sdt(0x42, TSID, PROGRAM, b'Chan'),
+               sdt(0x46, 2, 200, b'Other'), bat()]
+    nit_pid = [nit(0x40, 0x3000, b'Net', TSID, PROGRAM),
+               nit(0x41, 0x3001, b'OtherNet', 3, 300)]
+    eit_pid = [eit(0x4E, 0, 1, 1, (12, 0, 0), (1, 30, 0), 4, b'News',
+                   b'Daily news'),
+               eit(0x4E, 1, 1, 2, (13, 30, 0), (0, 30, 0), 1, b'Film',
+                   b'Drama'),
+               eit(0x50, 0, 0, 3, (14, 0, 0), (1, 0, 0), 0, b'Late', b'Talk')]
+    for block in range(BLOCKS):
+        start = mux.packets()
+        mux.section(PAT_PID, pat(0 if block < 50 else 1))
+        mux.section(PMT_PID, pmt())
+        video(mux, block)
+        audio(mux, block)
+        mux.section(SDT_PID, sdt_pid[block % 3])
+        mux.section(NIT_PID, nit_pid[block % 2])
+        mux.section(EIT_PID, eit_pid[block % 3])
+        if block in (0, 25, 50):
+            mux.section(TDT_PID, tdt(block // 25))
+        elif block in (12, 37, 62):
+            mux.section(TDT_PID, tot(block // 25, bad_crc=block == 37))
+        else:
+            mux.null()
+        if block % 10 == 0:
+            mux.section(CAT_PID, cat())
+        else:
+            mux.null()
+        if block % 3 == 2:
+            mux.continuation(SDT_PID)
+        else:
+            mux.null()
+        if block in (10, 70):
+            mux.section(SCTE35_PID, splice_insert(bad_crc=block == 70))
+        elif block == 40:
+            mux.section(SCTE35_PID, time_signal())
+        else:
+            mux.null()
+        if block % 10 == 0:
+            mux.section(AIT_PID, ait())
+        else:
+            mux.null()
+        mux.packet(SCRAMBLED_PID, bytes(range(184)), unit_start=True,
+                   scrambled=True)
+        while mux.packets() - start < BLOCK_PACKETS:
+            mux.null()
+        assert mux.packets() - start == BLOCK_PACKETS
+    return bytes(mux.out)
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit('usage: %s directory' % sys.argv[0])
+    out = sys.argv[1]
+    stream = si_stream()
+    # the directory walker must go down the subdirectories of many.
+    many = ['a.ts', 'b.ts', 'c.ts', 'x/d.ts', 'x/e.ts', 'x/y/f.ts', 'x/y/g.ts',
+            'z/h.ts']
+    for directory, names in (('si', ['si.ts']), ('many', many)):
+        for name in names:
+            path = os.path.join(out, directory, name)
+            os.makedirs(os.path.dirname(path), exist_ok=True)
+            with open(path, 'wb') as f:
+                f.write(stream)
+
+    # a TS without any PSI, and a file which isn't a TS at all.
+    os.makedirs(os.path.join(out, 'edge'), exist_ok=True)
+    mux = Muxer()
+    for _ in range(10):
+        mux.null()
+    with open(os.path.join(out, 'edge', 'nopsi.ts'), 'wb') as f:
+        f.write(mux.out)
+    noise = random.Random(0)
+    with open(os.path.join(out, 'edge', 'notts.bin'), 'wb') as f:
+        f.write(bytes(noise.randrange(0x48, 0x100) for _ in range(4096)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,100 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "tr101290.h"
+#include <assert.h>
+
+/* sync is acquired after 5 consecutive sync bytes, and lost after 2
+ * consecutive corrupted ones. */
+#define SYNC_ACQUIRE_PACKETS 5
+#define SYNC_LOSS_PACKETS 2
+
+void tr101290_init(tr101290_state *tr) {
+  for (int i = 0; i < TR101290__LAST; ++i) {
+    tr->counters[i].count = 0;
+    tr->counters[i].first_offset = 0;
+  }
+  tr->good_sync_bytes = 0;
+  tr->bad_sync_bytes = 0;
+  tr->in_sync = 0;
+  tr->was_in_sync = 0;
+}
+
+void tr101290_report(tr101290_state *tr, tr101290_error err, off_t offset) {
+  tr101290_counter *c = &tr->counters[err];
+  if (c->count++ == 0) {
+    c->first_offset = offset;
+  }
+}
+
+int tr101290_check_sync(tr101290_state *tr, const uint8_t *packet,
+                        off_t offset) {
+  if (packet[0] != 0x47) {
+    tr->good_sync_bytes = 0;
+    if (tr->in_sync) {
+      tr101290_report(tr, TR101290_SYNC_BYTE_ERROR, offset);
+      if (++tr->bad_sync_bytes >= SYNC_LOSS_PACKETS) {
+        tr101290_report(tr, TR101290_TS_SYNC_LOSS, offset);
+        tr->in_sync = 0;
+      }
+    }
+    return 0;
+  }
+
+  tr->bad_sync_bytes = 0;
+  if (!tr->in_sync && ++tr->good_sync_bytes >= SYNC_ACQUIRE_PACKETS) {
+    tr->in_sync = 1;
+    tr->was_in_sync = 1;
+  }
+  if (packet[1] & 0x80) {
+    tr101290_report(tr, TR101290_TRANSPORT_ERROR, offset);
+  }
+  return 1;
+}
+
+const char *tr101290_error_name(tr101290_error err) {
+  switch (err) {
+  case TR101290_TS_SYNC_LOSS:
+    return "TS_sync_loss";
+  case TR101290_SYNC_BYTE_ERROR:
+    return "Sync_byte_error";
+  case TR101290_PAT_ERROR:
+    return "PAT_error_2";
+  case TR101290_CONTINUITY_COUNT_ERROR:
+    return "Continuity_count_error";
+  case TR101290_PMT_ERROR:
+    return "PMT_error_2";
+  case TR101290_TRANSPORT_ERROR:
+    return "Transport_error";
+  case TR101290_CRC_ERROR:
+    return "CRC_error";
+  case TR101290_PCR_REPETITION_ERROR:
+    return "PCR_repetition_error";
+  case TR101290_PCR_DISCONTINUITY_INDICATOR_ERROR:
+    return "PCR_discontinuity_indicator_error";
+  case TR101290_PCR_ACCURACY_ERROR:
+    return "PCR_accuracy_error";
+  case TR101290__LAST:
+    break;
+  }
+  assert(0 && "invalid tr101290_error");
+  return 0;
+}
+
+int tr101290_error_priority(tr101290_error err) {
+  return err <= TR101290_PMT_ERROR ? 1 : 2;
+}
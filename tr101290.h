@@ -0,0 +1,63 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef DVBINDEX_TR101290_H
+#define DVBINDEX_TR101290_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/* the subset of the ETSI TR 101 290 priority 1 and 2 indicators which can be
+ * checked while reading the file once. */
+typedef enum tr101290_error_ {
+  TR101290_TS_SYNC_LOSS,
+  TR101290_SYNC_BYTE_ERROR,
+  TR101290_PAT_ERROR,
+  TR101290_CONTINUITY_COUNT_ERROR,
+  TR101290_PMT_ERROR,
+  TR101290_TRANSPORT_ERROR,
+  TR101290_CRC_ERROR,
+  TR101290_PCR_REPETITION_ERROR,
+  TR101290_PCR_DISCONTINUITY_INDICATOR_ERROR,
+  TR101290_PCR_ACCURACY_ERROR,
+  TR101290__LAST
+} tr101290_error;
+
+typedef struct tr101290_counter_ {
+  uint64_t count;
+  off_t first_offset;
+} tr101290_counter;
+
+typedef struct tr101290_state_ {
+  tr101290_counter counters[TR101290__LAST];
+  unsigned int good_sync_bytes;
+  unsigned int bad_sync_bytes;
+  int in_sync;
+  /* set once the sync was acquired, even if it was lost later : the file is a
+   * TS. */
+  int was_in_sync;
+} tr101290_state;
+
+void tr101290_init(tr101290_state *tr);
+void tr101290_report(tr101290_state *tr, tr101290_error err, off_t offset);
+/* returns 0 if the packet can't be used any further. */
+int tr101290_check_sync(tr101290_state *tr, const uint8_t *packet,
+                        off_t offset);
+const char *tr101290_error_name(tr101290_error err);
+int tr101290_error_priority(tr101290_error err);
+
+#endif
@@ -18,6 +18,8 @@ Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #ifndef DVBINDEX_UTIL_H
 #define DVBINDEX_UTIL_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
 #define STATIC_ASSERT(COND,MSG) typedef char static_assertion_##MSG[(COND)?1:-1]
@@ -29,4 +31,20 @@ static inline const char *file_name_from_path(const char *path) {
   return namestart ? namestart + 1 : path;
 }
 
+#define FNV1A64_INIT 0xcbf29ce484222325ULL
+
+static inline uint64_t fnv1a64(uint64_t hash, const void *data, size_t size) {
+  const unsigned char *p = data;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ p[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/* files are only told apart by their name and size. */
+static inline uint64_t file_key(const char *name, int64_t size) {
+  const uint64_t hash = fnv1a64(FNV1A64_INIT, name, strlen(name));
+  return fnv1a64(hash, &size, sizeof(size));
+}
+
 #endif
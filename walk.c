@@ -0,0 +1,243 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+/* for statx() and syscall(). */
+#define _GNU_SOURCE
+
+#include "walk.h"
+#include "vec.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <dirent.h> /* DT_* */
+
+/* the directories are read with getdents64() into this much memory per thread,
+ * and the type of each entry comes with it on most filesystems. */
+#define WALK_DENTS_BUF_SIZE (64 * 1024)
+
+/* older glibc versions have no wrapper for getdents64(). */
+struct linux_dirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+typedef char *walk_dir;
+VEC_DEFINE(walk_dir)
+
+typedef struct walk_state_ {
+  walk_file_cbk cbk;
+  void *opaque;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  /* the directories not read yet. the last one found is read first, which
+   * keeps the queue about as long as the tree is deep. */
+  vec_walk_dir dirs;
+  /* the threads reading a directory, which might add more to the queue. the
+   * walk is over once both are empty. */
+  unsigned int busy;
+  int result;
+} walk_state;
+
+static char *walk_join(const char *dir, const char *name) {
+  size_t dir_len = strlen(dir);
+  const size_t name_len = strlen(name);
+  if (dir_len > 0 && dir[dir_len - 1] == '/') {
+    --dir_len;
+  }
+  char *path = malloc(dir_len + name_len + 2);
+  if (path) {
+    memcpy(path, dir, dir_len);
+    path[dir_len] = '/';
+    memcpy(path + dir_len + 1, name, name_len + 1);
+  }
+  return path;
+}
+
+static void walk_set_result(walk_state *s, int result) {
+  pthread_mutex_lock(&s->lock);
+  if (s->result == 0) {
+    s->result = result;
+  }
+  pthread_cond_broadcast(&s->changed);
+  pthread_mutex_unlock(&s->lock);
+}
+
+static int walk_push_dir(walk_state *s, char *path) {
+  pthread_mutex_lock(&s->lock);
+  const int rv = vec_walk_dir_push(&s->dirs, path);
+  pthread_cond_signal(&s->changed);
+  pthread_mutex_unlock(&s->lock);
+  if (!rv) {
+    free(path);
+  }
+  return rv;
+}
+
+/* waits for a directory to read, and returns 0 once the walk is over. */
+static char *walk_next_dir(walk_state *s, int was_busy) {
+  char *dir = 0;
+  pthread_mutex_lock(&s->lock);
+  s->busy -= was_busy;
+  while (s->result == 0 && s->dirs.size == 0 && s->busy > 0) {
+    pthread_cond_wait(&s->changed, &s->lock);
+  }
+  if (s->result == 0 && s->dirs.size > 0) {
+    dir = s->dirs.data[--s->dirs.size];
+    ++s->busy;
+  }
+  pthread_cond_broadcast(&s->changed);
+  pthread_mutex_unlock(&s->lock);
+  return dir;
+}
+
+static int walk_entry(walk_state *s, int dirfd, const char *dir,
+                      const char *name, unsigned char type) {
+  if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+    return 0;
+  }
+  struct statx stx;
+  if (type == DT_REG || type == DT_UNKNOWN) {
+    /* the size is needed for regular files anyway. */
+    if (statx(dirfd, name, AT_SYMLINK_NOFOLLOW, STATX_TYPE | STATX_SIZE,
+              &stx) != 0) {
+      return 0;
+    }
+    type = S_ISREG(stx.stx_mode) ? DT_REG
+                                 : S_ISDIR(stx.stx_mode) ? DT_DIR : DT_UNKNOWN;
+  }
+  if (type != DT_REG && type != DT_DIR) {
+    return 0;
+  }
+
+  char *path = walk_join(dir, name);
+  if (!path) {
+    return ENOMEM;
+  }
+  if (type == DT_DIR) {
+    return walk_push_dir(s, path) ? 0 : ENOMEM;
+  }
+  const int rv = s->cbk(s->opaque, path, (int64_t)stx.stx_size);
+  free(path);
+  return rv;
+}
+
+static int walk_read_dir(walk_state *s, const char *dir, char *buf) {
+  const int fd = openat(AT_FDCWD, dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    /* unreadable directories are left out. */
+    return 0;
+  }
+  int rv = 0;
+  long size;
+  while (rv == 0 &&
+         (size = syscall(SYS_getdents64, fd, buf, WALK_DENTS_BUF_SIZE)) > 0) {
+    for (long offset = 0; offset < size && rv == 0;) {
+      const struct linux_dirent64 *d =
+          (const struct linux_dirent64 *)(buf + offset);
+      rv = walk_entry(s, fd, dir, d->d_name, d->d_type);
+      offset += d->d_reclen;
+    }
+  }
+  close(fd);
+  return rv;
+}
+
+static void *walk_thread_main(void *opaque) {
+  walk_state *s = opaque;
+  char *buf = malloc(WALK_DENTS_BUF_SIZE);
+  if (!buf) {
+    walk_set_result(s, ENOMEM);
+    return 0;
+  }
+  int was_busy = 0;
+  char *dir;
+  while ((dir = walk_next_dir(s, was_busy))) {
+    const int rv = walk_read_dir(s, dir, buf);
+    free(dir);
+    if (rv != 0) {
+      walk_set_result(s, rv);
+    }
+    was_busy = 1;
+  }
+  free(buf);
+  return 0;
+}
+
+int walk_tree(const char *path, unsigned int threads, walk_file_cbk cbk,
+              void *opaque) {
+  struct statx stx;
+  if (statx(AT_FDCWD, path, AT_SYMLINK_NOFOLLOW, STATX_TYPE | STATX_SIZE,
+            &stx) != 0) {
+    return errno;
+  }
+  if (S_ISREG(stx.stx_mode)) {
+    return cbk(opaque, path, (int64_t)stx.stx_size);
+  }
+  if (!S_ISDIR(stx.stx_mode)) {
+    return 0;
+  }
+
+  walk_state s;
+  s.cbk = cbk;
+  s.opaque = opaque;
+  s.busy = 0;
+  s.result = 0;
+  if (!vec_walk_dir_init(&s.dirs)) {
+    return ENOMEM;
+  }
+  char *root = strdup(path);
+  if (!root || !vec_walk_dir_push(&s.dirs, root)) {
+    free(root);
+    vec_walk_dir_destroy(&s.dirs);
+    return ENOMEM;
+  }
+  pthread_mutex_init(&s.lock, 0);
+  pthread_cond_init(&s.changed, 0);
+
+  /* the calling thread is one of the walkers. */
+  const unsigned int extra = threads > 1 ? threads - 1 : 0;
+  pthread_t *workers = extra ? calloc(extra, sizeof(*workers)) : 0;
+  unsigned int started = 0;
+  while (workers && started < extra &&
+         pthread_create(workers + started, 0, walk_thread_main, &s) == 0) {
+    ++started;
+  }
+  walk_thread_main(&s);
+  for (unsigned int i = 0; i < started; ++i) {
+    pthread_join(workers[i], 0);
+  }
+
+  /* only left over when the walk was stopped. */
+  for (size_t i = 0; i < s.dirs.size; ++i) {
+    free(s.dirs.data[i]);
+  }
+  free(workers);
+  pthread_cond_destroy(&s.changed);
+  pthread_mutex_destroy(&s.lock);
+  vec_walk_dir_destroy(&s.dirs);
+  return s.result;
+}
@@ -0,0 +1,35 @@
+/* dvbindex - a program for indexing DVB streams
+Copyright (C) 2017 Daniel Kamil Kozar
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 51 Franklin
+Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef DVBINDEX_WALK_H
+#define DVBINDEX_WALK_H
+
+#include <stdint.h>
+
+/* called for each regular file found, possibly from several threads at once.
+ * a nonzero return value stops the walk, and is returned by walk_tree. */
+typedef int (*walk_file_cbk)(void *opaque, const char *path, int64_t size);
+
+/* walks the tree rooted at path with the given number of threads, the calling
+ * one included, each having at most one directory open. symbolic links are not
+ * followed, and directories which can't be read are skipped. path may also be
+ * a regular file. returns 0, an errno value, or the first nonzero value
+ * returned by the callback. */
+int walk_tree(const char *path, unsigned int threads, walk_file_cbk cbk,
+              void *opaque);
+
+#endif